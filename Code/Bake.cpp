@@ -0,0 +1,2292 @@
+#include "Bake.h"
+#include "TSCompression.h"
+
+
+using namespace Framework;
+
+
+namespace
+{
+	List<HorizonOffsetTable>	horizonOffsetTableList;
+	Mutex						horizonOffsetTableMutex;
+}
+
+
+HorizonOffsetTable::HorizonOffsetTable(int32 radius, int32 count)
+{
+	horizonRadius = radius;
+	angleCount = count;
+
+	const float angleIndex = float(count) / float(2*3.14519);
+
+	// Count the offsets inside the search disk, excluding the center texel.
+
+	int32 r2max = radius * radius;
+	offsetCount = 0;
+
+	for (int32 j = -radius + 1; j < radius; j++)
+	{
+		for (int32 i = -radius + 1; i < radius; i++)
+		{
+			int32 r2 = i * i + j * j;
+			if ((r2 < r2max) && (r2 != 0))
+			{
+				offsetCount++;
+			}
+		}
+	}
+
+	offsetArray = new HorizonOffset[offsetCount];
+	HorizonOffset *offset = offsetArray;
+
+	// Calculate the angular index range and inverse squared distance for each offset
+	// in the same order that the brute-force search visits them.
+
+	for (int32 j = -radius + 1; j < radius; j++)
+	{
+		for (int32 i = -radius + 1; i < radius; i++)
+		{
+			int32 r2 = i * i + j * j;
+			if ((r2 < r2max) && (r2 != 0))
+			{
+				float direction = atan2(float(j), float(i));
+				float delta = atan(0.7071F / sqrt(float(r2)));
+
+				offset->dx = int16(i);
+				offset->dy = int16(j);
+				offset->minIndex = int16(floor((direction - delta) * angleIndex));
+				offset->maxIndex = int16(ceil((direction + delta) * angleIndex));
+				offset->inverseRadius2 = 1.0F / float(r2);
+				offset++;
+			}
+		}
+	}
+}
+
+HorizonOffsetTable::~HorizonOffsetTable()
+{
+	delete[] offsetArray;
+}
+
+const HorizonOffsetTable *HorizonOffsetTable::Get(int32 radius, int32 count)
+{
+	// Bakes can run on several pipeline workers at once, so the search and the insertion of a
+	// new table happen under one lock. Tables are never removed, so a returned table remains
+	// valid after the lock is released.
+
+	horizonOffsetTableMutex.Acquire();
+
+	for (const HorizonOffsetTable *table : horizonOffsetTableList)
+	{
+		if ((table->horizonRadius == radius) && (table->angleCount == count))
+		{
+			horizonOffsetTableMutex.Release();
+			return (table);
+		}
+	}
+
+	HorizonOffsetTable *table = new HorizonOffsetTable(radius, count);
+	horizonOffsetTableList.AppendListElement(table);
+
+	horizonOffsetTableMutex.Release();
+	return (table);
+}
+
+
+HeightWindow::HeightWindow(const Color4U *map, int32 width, int32 height, int32 apron)
+{
+	heightMap = map;
+	mapWidth = width;
+	mapHeight = height;
+
+	apronSize = apron;
+	rowCount = apron * 2 + 1;
+	rowStride = width + apron * 2;
+
+	windowStorage = new uint8[rowCount * rowStride];
+}
+
+HeightWindow::~HeightWindow()
+{
+	delete[] windowStorage;
+}
+
+void HeightWindow::LoadRow(int32 y)
+{
+	// Copy one wrapped row of heights into its slot in the ring and extend it
+	// on both sides with the texels that wrap around horizontally.
+
+	int32 width = mapWidth;
+	const Color4U *source = heightMap + ((y % mapHeight + mapHeight) % mapHeight) * width;
+	uint8 *row = windowStorage + ((y + rowCount) % rowCount) * rowStride + apronSize;
+
+	for (int32 x = 0; x < width; x++)
+	{
+		row[x] = source[x].red;
+	}
+
+	for (int32 x = 1; x <= apronSize; x++)
+	{
+		row[-x] = source[(width - x % width) % width].red;
+		row[width - 1 + x] = source[(x - 1) % width].red;
+	}
+}
+
+void HeightWindow::BeginBand(int32 y)
+{
+	for (int32 j = y - apronSize; j <= y + apronSize; j++)
+	{
+		LoadRow(j);
+	}
+}
+
+void HeightWindow::AdvanceRow(int32 y)
+{
+	// The window already contains rows up to y + apronSize - 1, and the row leaving
+	// the window occupies the slot needed by the row entering it.
+
+	LoadRow(y + apronSize);
+}
+
+
+HeightPyramid::HeightPyramid(const Color4U *heightMap, int32 width, int32 height)
+{
+	// Each level halves the size of the previous one in both directions until both
+	// are reduced to a single texel. Sizes are powers of two, as for the height map.
+
+	int32 storageSize = 0;
+	levelCount = 0;
+	for (;;)
+	{
+		int32 w = Max(width >> levelCount, 1);
+		int32 h = Max(height >> levelCount, 1);
+		levelWidth[levelCount] = w;
+		levelHeight[levelCount] = h;
+		storageSize += w * h;
+
+		levelCount++;
+		if ((w == 1) && (h == 1))
+		{
+			break;
+		}
+	}
+
+	pyramidStorage = new uint8[storageSize];
+	uint8 *data = pyramidStorage;
+
+	for (int32 k = 0; k < width * height; k++)
+	{
+		data[k] = heightMap[k].red;
+	}
+
+	levelData[0] = data;
+	for (int32 level = 1; level < levelCount; level++)
+	{
+		const uint8 *previous = levelData[level - 1];
+		int32 previousWidth = levelWidth[level - 1];
+		int32 previousHeight = levelHeight[level - 1];
+
+		data += previousWidth * previousHeight;
+		levelData[level] = data;
+
+		int32 w = levelWidth[level];
+		int32 h = levelHeight[level];
+		for (int32 j = 0; j < h; j++)
+		{
+			const uint8 *row1 = previous + Min(j * 2, previousHeight - 1) * previousWidth;
+			const uint8 *row2 = previous + Min(j * 2 + 1, previousHeight - 1) * previousWidth;
+
+			for (int32 i = 0; i < w; i++)
+			{
+				int32 i1 = Min(i * 2, previousWidth - 1);
+				int32 i2 = Min(i * 2 + 1, previousWidth - 1);
+				data[j * w + i] = uint8(Max(Max(row1[i1], row1[i2]), Max(row2[i1], row2[i2])));
+			}
+		}
+	}
+}
+
+HeightPyramid::~HeightPyramid()
+{
+	delete[] pyramidStorage;
+}
+
+
+namespace
+{
+	struct BakeBandData
+	{
+		BakeBandFunction	*bandFunction;
+		void				*bandCookie;
+
+		int32				bandCount;
+		int32				lastRow;
+		volatile int32		nextBand;
+	};
+
+
+	void BakeBandThread(void *cookie)
+	{
+		BakeBandData *data = static_cast<BakeBandData *>(cookie);
+
+		// Bands are claimed one at a time so that threads finishing early keep working.
+
+		for (;;)
+		{
+			int32 band = AtomicIncrement(&data->nextBand) - 1;
+			if (band >= data->bandCount)
+			{
+				break;
+			}
+
+			int32 firstRow = band * kBakeBandHeight;
+			(*data->bandFunction)(firstRow, Min(kBakeBandHeight, data->lastRow - firstRow), data->bandCookie);
+		}
+	}
+
+
+	struct BakeMapData
+	{
+		const Color4U		*heightMap;
+		void				*outputMap;
+		int32				mapWidth;
+		int32				mapHeight;
+		float				bakeScale;
+	};
+
+
+	#if defined(TERATHON_SSE)
+
+		enum
+		{
+			kNormalGroupSize = 8
+		};
+
+
+		inline __m128i LoadHeightDifference(const uint8 *positive, const uint8 *negative)
+		{
+			// Return the differences between two runs of eight heights as 16-bit integers.
+
+			const __m128i zero = _mm_setzero_si128();
+
+			__m128i p = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(positive)), zero);
+			__m128i n = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(negative)), zero);
+			return (_mm_sub_epi16(p, n));
+		}
+
+		inline vec_float ConvertLowDifference(const __m128i& d)
+		{
+			return (_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(d, d), 16)));
+		}
+
+		inline vec_float ConvertHighDifference(const __m128i& d)
+		{
+			return (_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(d, d), 16)));
+		}
+
+		inline void StoreNormalGroup(const __m128i& xlo, const __m128i& xhi, const __m128i& ylo, const __m128i& yhi, Color2S *normal)
+		{
+			// Interleave the x and y components of eight normals and narrow them to bytes.
+			// All values are already in [-127,127], so saturation never changes them.
+
+			__m128i x = _mm_packs_epi32(xlo, xhi);
+			__m128i y = _mm_packs_epi32(ylo, yhi);
+			__m128i n = _mm_packs_epi16(_mm_unpacklo_epi16(x, y), _mm_unpackhi_epi16(x, y));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(normal), n);
+		}
+
+		#if defined(TERATHON_AVX)
+
+			inline void CalculateNormalGroup(const uint8 *centerRow, const uint8 *upperRow, const uint8 *lowerRow, const vec_float& slopeScale, Color2S *normal)
+			{
+				const __m256 k = _mm256_set1_ps(_mm_cvtss_f32(slopeScale));
+				const __m256 one = _mm256_set1_ps(1.0F);
+				const __m256 minusOne = _mm256_set1_ps(-1.0F);
+				const __m256 three = _mm256_set1_ps(3.0F);
+				const __m256 half = _mm256_castsi256_ps(_mm256_set1_epi32(0x3F000001));
+				const __m256 normalScale = _mm256_set1_ps(127.0F);
+
+				__m128i ddx = LoadHeightDifference(centerRow + 1, centerRow - 1);
+				__m128i ddy = LoadHeightDifference(lowerRow, upperRow);
+
+				__m256 dx = _mm256_insertf128_ps(_mm256_castps128_ps256(ConvertLowDifference(ddx)), ConvertHighDifference(ddx), 1);
+				__m256 dy = _mm256_insertf128_ps(_mm256_castps128_ps256(ConvertLowDifference(ddy)), ConvertHighDifference(ddy), 1);
+				dx = _mm256_mul_ps(_mm256_mul_ps(dx, _mm256_set1_ps(0.5F / 255.0F)), k);
+				dy = _mm256_mul_ps(_mm256_mul_ps(dy, _mm256_set1_ps(0.5F / 255.0F)), k);
+
+				// The square root is refined exactly as Sqrt() does it so that the vector and
+				// scalar paths produce identical normals.
+
+				__m256 s = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), one);
+				__m256 r = _mm256_rsqrt_ps(s);
+				r = _mm256_mul_ps(_mm256_sub_ps(three, _mm256_mul_ps(s, _mm256_mul_ps(r, r))), _mm256_mul_ps(r, half));
+				__m256 nz = _mm256_div_ps(one, _mm256_mul_ps(r, s));
+
+				__m256 nx = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_setzero_ps(), dx), nz), minusOne), one);
+				__m256 ny = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_setzero_ps(), dy), nz), minusOne), one);
+
+				__m256i ix = _mm256_cvttps_epi32(_mm256_mul_ps(nx, normalScale));
+				__m256i iy = _mm256_cvttps_epi32(_mm256_mul_ps(ny, normalScale));
+
+				StoreNormalGroup(_mm256_castsi256_si128(ix), _mm256_extractf128_si256(ix, 1), _mm256_castsi256_si128(iy), _mm256_extractf128_si256(iy, 1), normal);
+			}
+
+		#else
+
+			inline void CalculateNormalHalf(const vec_float& difx, const vec_float& dify, const vec_float& slopeScale, __m128i *nx, __m128i *ny)
+			{
+				const vec_float one = VecLoadVectorConstant<0x3F800000>();
+				const vec_float minusOne = VecLoadVectorConstant<0xBF800000>();
+				const vec_float three = VecLoadVectorConstant<0x40400000>();
+				const vec_float half = VecLoadVectorConstant<0x3F000001>();
+				const vec_float differenceScale = VecLoadVectorConstant<0x3B008081>();
+				const vec_float normalScale = VecLoadVectorConstant<0x42FE0000>();
+
+				vec_float dx = VecMul(VecMul(difx, differenceScale), slopeScale);
+				vec_float dy = VecMul(VecMul(dify, differenceScale), slopeScale);
+
+				// The square root is refined exactly as Sqrt() does it so that the vector and
+				// scalar paths produce identical normals.
+
+				vec_float s = VecAdd(VecAdd(VecMul(dx, dx), VecMul(dy, dy)), one);
+				vec_float r = _mm_rsqrt_ps(s);
+				r = VecMul(VecSub(three, VecMul(s, VecMul(r, r))), VecMul(r, half));
+				vec_float nz = VecDiv(one, VecMul(r, s));
+
+				*nx = _mm_cvttps_epi32(VecMul(VecMin(VecMax(VecMul(VecNegate(dx), nz), minusOne), one), normalScale));
+				*ny = _mm_cvttps_epi32(VecMul(VecMin(VecMax(VecMul(VecNegate(dy), nz), minusOne), one), normalScale));
+			}
+
+			inline void CalculateNormalGroup(const uint8 *centerRow, const uint8 *upperRow, const uint8 *lowerRow, const vec_float& slopeScale, Color2S *normal)
+			{
+				__m128i		xlo, xhi, ylo, yhi;
+
+				__m128i ddx = LoadHeightDifference(centerRow + 1, centerRow - 1);
+				__m128i ddy = LoadHeightDifference(lowerRow, upperRow);
+
+				CalculateNormalHalf(ConvertLowDifference(ddx), ConvertLowDifference(ddy), slopeScale, &xlo, &ylo);
+				CalculateNormalHalf(ConvertHighDifference(ddx), ConvertHighDifference(ddy), slopeScale, &xhi, &yhi);
+				StoreNormalGroup(xlo, xhi, ylo, yhi, normal);
+			}
+
+		#endif
+
+	#endif
+
+
+	void BakeNormalBand(int32 firstRow, int32 rowCount, void *cookie)
+	{
+		const BakeMapData *data = static_cast<BakeMapData *>(cookie);
+		int32 width = data->mapWidth;
+
+		HeightWindow window(data->heightMap, width, data->mapHeight, 1);
+		window.BeginBand(firstRow);
+
+		const float scale = data->bakeScale;
+		Color2S *normalMap = static_cast<Color2S *>(data->outputMap) + firstRow * width;
+
+		// The window extends each row by one wrapped texel on both sides, so groups of texels
+		// are processed without regard to the edges, and the texels remaining at the end of a
+		// row when the width is not a multiple of the group size are processed one at a time.
+
+		#if defined(TERATHON_SSE)
+
+			const vec_float slopeScale = VecLoadSmearScalar(&scale);
+			int32 groupWidth = width & ~(kNormalGroupSize - 1);
+
+		#else
+
+			int32 groupWidth = 0;
+
+		#endif
+
+		for (int32 y = firstRow; y < firstRow + rowCount; y++)
+		{
+			if (y != firstRow)
+			{
+				window.AdvanceRow(y);
+			}
+
+			const uint8 *centerRow = window.GetRow(y);
+			const uint8 *upperRow = window.GetRow(y - 1);
+			const uint8 *lowerRow = window.GetRow(y + 1);
+
+			#if defined(TERATHON_SSE)
+
+				for (int32 x = 0; x < groupWidth; x += kNormalGroupSize)
+				{
+					CalculateNormalGroup(centerRow + x, upperRow + x, lowerRow + x, slopeScale, normalMap + x);
+				}
+
+			#endif
+
+			for (int32 x = groupWidth; x < width; x++)
+			{
+				// Calculate slopes.
+				float dx = float(centerRow[x + 1] - centerRow[x - 1]) * (0.5F / 255.0F) * scale;
+				float dy = float(lowerRow[x] - upperRow[x]) * (0.5F / 255.0F) * scale;
+
+				// Normalize and clamp.
+				float nz = 1.0F / Sqrt(dx * dx + dy * dy + 1.0F);
+				float nx = Clamp(-dx * nz, -1.0F, 1.0F);
+				float ny = Clamp(-dy * nz, -1.0F, 1.0F);
+
+				normalMap[x].red = int8(nx * 127.0F);
+				normalMap[x].green = int8(ny * 127.0F);
+			}
+
+			normalMap += width;
+		}
+	}
+
+
+	struct HorizonFarSample
+	{
+		int16		dx;
+		int16		dy;
+		int16		level;
+		int16		minIndex;
+		int16		maxIndex;
+		float		inverseDistance2;
+	};
+
+
+	struct SurfaceBakeData : BakeMapData
+	{
+		Color2S						*normalMap;
+		Color1S						*parallaxMap;
+		Color1U						*ambientMap;
+		float						parallaxScale;
+		float						ambientPower;
+
+		int32						horizonRadius;
+		Rect						bakeRect;
+
+		const HeightPyramid			*heightPyramid;
+		const HorizonFarSample		*farSampleArray;
+		int32						farSampleCount;
+	};
+
+
+	inline void StoreHorizonTexel(const float *maxTan2, Color4U *layerData, int32 layerSize)
+	{
+		constexpr int32 kAngleCount = kHorizonAngleCount;
+
+		// Generate eight channels of horizon map.
+
+		for (int32 layer = 0; layer < 2; layer++)
+		{
+			ColorRgba color(0.0F, 0.0F, 0.0F, 0.0F);
+			int32 firstIndex = kAngleCount / 16 + layer * (kAngleCount / 2);
+			int32 lastIndex = firstIndex + kAngleCount / 8;
+			for (int32 index = firstIndex; index <= lastIndex; index++)
+			{
+				float tr = maxTan2[(index - kAngleCount / 8) & (kAngleCount - 1)];
+				float tg = maxTan2[index];
+				float tb = maxTan2[index + kAngleCount / 8];
+				float ta = maxTan2[(index + kAngleCount / 4) & (kAngleCount - 1)];
+				color.red += sqrt(tr / (tr + 1.0F));
+				color.green += sqrt(tg / (tg + 1.0F));
+				color.blue += sqrt(tb / (tb + 1.0F));
+				color.alpha += sqrt(ta / (ta + 1.0F));
+			}
+
+			*layerData = color / float(kAngleCount / 8 + 1);
+			layerData += layerSize;
+		}
+	}
+
+
+	inline Color1S StoreParallaxTexel(int32 h, float parallaxScale)
+	{
+		// Heights are remapped from [0,255] to signed values in [-1,1], scaled about the
+		// middle of the range, and clamped.
+
+		return (Color1S(Clamp((float(h) * (2.0F / 255.0F) - 1.0F) * parallaxScale, -1.0F, 1.0F) * 127.0F));
+	}
+
+
+	inline Color1U StoreAmbientTexel(const float *maxTan2, float ambientPower)
+	{
+		constexpr int32 kAngleCount = kHorizonAngleCount;
+
+		// Generate ambient light factor from the average cosine of the horizon angle.
+
+		float sum = 0.0F;
+		for (int32 k = 0; k < kAngleCount; k++)
+		{
+			sum += 1.0F / sqrt(maxTan2[k] + 1.0F);
+		}
+
+		float ambient = pow(Fmin(sum * (1.0F / float(kAngleCount)), 1.0F), ambientPower);
+		return (Color1U(ambient * 255.0F + 0.5F));
+	}
+
+
+	void BakeSurfaceBand(int32 firstRow, int32 rowCount, void *cookie)
+	{
+		constexpr int32 kAngleCount = kHorizonAngleCount;
+
+		const SurfaceBakeData *data = static_cast<SurfaceBakeData *>(cookie);
+		int32 width = data->mapWidth;
+		int32 height = data->mapHeight;
+		int32 radius = data->horizonRadius;
+
+		// Bands are numbered from the top of the rectangle being baked, but everything
+		// else is addressed by absolute position in the full map.
+
+		const Rect& bakeRect = data->bakeRect;
+		firstRow += bakeRect.min.y;
+
+		const HorizonOffsetTable *offsetTable = HorizonOffsetTable::Get(radius, kAngleCount);
+		int32 offsetCount = offsetTable->GetOffsetCount();
+		const HorizonOffset *offsetArray = offsetTable->GetOffsetArray();
+
+		HeightWindow window(data->heightMap, width, height, radius - 1);
+		window.BeginBand(firstRow);
+
+		// Any of the output maps may be absent. The neighborhood search is skipped when
+		// neither the horizon map nor the ambient map is needed.
+
+		int32 rowOffset = firstRow * width;
+		Color4U *horizonMap = static_cast<Color4U *>(data->outputMap);
+		Color2S *normalMap = data->normalMap;
+		Color1S *parallaxMap = data->parallaxMap;
+		Color1U *ambientMap = data->ambientMap;
+
+		horizonMap = (horizonMap) ? horizonMap + rowOffset : nullptr;
+		normalMap = (normalMap) ? normalMap + rowOffset : nullptr;
+		parallaxMap = (parallaxMap) ? parallaxMap + rowOffset : nullptr;
+		ambientMap = (ambientMap) ? ambientMap + rowOffset : nullptr;
+		bool horizonFlag = ((horizonMap) || (ambientMap));
+
+		const float scale = data->bakeScale;
+		const float parallaxScale = data->parallaxScale;
+		const float ambientPower = data->ambientPower;
+		const uint8 **rowTable = new const uint8 *[radius * 2 - 1];
+
+		const HeightPyramid *pyramid = data->heightPyramid;
+		const HorizonFarSample *farSampleArray = data->farSampleArray;
+		int32 farSampleCount = data->farSampleCount;
+
+		for (int32 y = firstRow; y < firstRow + rowCount; y++)
+		{
+			if (y != firstRow)
+			{
+				window.AdvanceRow(y);
+			}
+
+			for (int32 j = 0; j < radius * 2 - 1; j++)
+			{
+				rowTable[j] = window.GetRow(y + j - (radius - 1));
+			}
+
+			const uint8 *centerRow = rowTable[radius - 1];
+
+			for (int32 x = bakeRect.min.x; x < bakeRect.max.x; x++)
+			{
+				// Get central height. Initialize max squared tangent array to all zeros.
+				int32 h0 = centerRow[x];
+
+				if (normalMap)
+				{
+					// Calculate slopes.
+					float dx = float(centerRow[x + 1] - centerRow[x - 1]) * (0.5F / 255.0F) * scale;
+					float dy = float(rowTable[radius][x] - rowTable[radius - 2][x]) * (0.5F / 255.0F) * scale;
+
+					// Normalize and clamp.
+					float nz = 1.0F / Sqrt(dx * dx + dy * dy + 1.0F);
+					float nx = Clamp(-dx * nz, -1.0F, 1.0F);
+					float ny = Clamp(-dy * nz, -1.0F, 1.0F);
+
+					normalMap[x].red = int8(nx * 127.0F);
+					normalMap[x].green = int8(ny * 127.0F);
+				}
+
+				if (parallaxMap)
+				{
+					parallaxMap[x] = StoreParallaxTexel(h0, parallaxScale);
+				}
+
+				if (!horizonFlag)
+				{
+					continue;
+				}
+
+				float maxTan2[kAngleCount] = {};
+
+				// Search neighborhood for larger heights.
+				for (int32 k = 0; k < offsetCount; k++)
+				{
+					const HorizonOffset *offset = &offsetArray[k];
+					int32 dh = rowTable[offset->dy + (radius - 1)][x + offset->dx] - h0;
+					if (dh > 0)
+					{
+						// Larger height found. Apply to array entries.
+						// Calculate squared tangent with Equation (7.53).
+						float t = float(dh * dh) * offset->inverseRadius2;
+						for (int32 n = offset->minIndex; n <= offset->maxIndex; n++)
+						{
+							float& m = maxTan2[n & (kAngleCount - 1)];
+							m = Fmax(m, t);
+						}
+					}
+				}
+
+				// Beyond the neighborhood, compare against the maximum heights of pyramid cells.
+				// A far sample gives the offset of a cell from the cell containing this texel,
+				// and it is applied at the distance of the nearest texel the cell could contain
+				// to every angle that any texel in it could cover.
+
+				for (int32 k = 0; k < farSampleCount; k++)
+				{
+					const HorizonFarSample *sample = &farSampleArray[k];
+					int32 level = sample->level;
+					int32 levelWidth = pyramid->GetLevelWidth(level);
+					int32 cx = ((x >> level) + sample->dx) & (levelWidth - 1);
+					int32 cy = ((y >> level) + sample->dy) & (pyramid->GetLevelHeight(level) - 1);
+
+					int32 dh = pyramid->GetLevelData(level)[cy * levelWidth + cx] - h0;
+					if (dh > 0)
+					{
+						float t = float(dh * dh) * sample->inverseDistance2;
+						for (int32 n = sample->minIndex; n <= sample->maxIndex; n++)
+						{
+							float& m = maxTan2[n & (kAngleCount - 1)];
+							m = Fmax(m, t);
+						}
+					}
+				}
+
+				if (horizonMap)
+				{
+					StoreHorizonTexel(maxTan2, &horizonMap[x], width * height);
+				}
+
+				if (ambientMap)
+				{
+					ambientMap[x] = StoreAmbientTexel(maxTan2, ambientPower);
+				}
+			}
+
+			horizonMap = (horizonMap) ? horizonMap + width : nullptr;
+			normalMap = (normalMap) ? normalMap + width : nullptr;
+			parallaxMap = (parallaxMap) ? parallaxMap + width : nullptr;
+			ambientMap = (ambientMap) ? ambientMap + width : nullptr;
+		}
+
+		delete[] rowTable;
+	}
+}
+
+
+void Framework::ExecuteBakeBands(int32 height, BakeBandFunction *function, void *cookie, int32 threadCount)
+{
+	BakeBandData	data;
+
+	data.bandFunction = function;
+	data.bandCookie = cookie;
+	data.bandCount = (height + (kBakeBandHeight - 1)) / kBakeBandHeight;
+	data.lastRow = height;
+	data.nextBand = 0;
+
+	if (threadCount <= 0)
+	{
+		threadCount = GetProcessorCount();
+	}
+
+	// The calling thread processes bands alongside the helper threads, so no
+	// threads are created at all when only one is requested.
+
+	threadCount = Min(threadCount, data.bandCount);
+	int32 helperCount = threadCount - 1;
+
+	Thread **helperThread = (helperCount > 0) ? new Thread *[helperCount] : nullptr;
+	for (int32 a = 0; a < helperCount; a++)
+	{
+		helperThread[a] = new Thread(&BakeBandThread, &data);
+	}
+
+	BakeBandThread(&data);
+
+	for (int32 a = 0; a < helperCount; a++)
+	{
+		delete helperThread[a];
+	}
+
+	delete[] helperThread;
+}
+
+void Framework::BakeNormalMap(const Color4U *heightMap, Color2S *normalMap, int32 width, int32 height, float scale, int32 threadCount)
+{
+	BakeMapData		data;
+
+	data.heightMap = heightMap;
+	data.outputMap = normalMap;
+	data.mapWidth = width;
+	data.mapHeight = height;
+	data.bakeScale = scale;
+
+	ExecuteBakeBands(height, &BakeNormalBand, &data, threadCount);
+}
+
+void Framework::BakeHorizonMap(const Color4U *heightMap, Color4U *horizonMap, int32 width, int32 height, float scale, int32 threadCount, int32 radius)
+{
+	SurfaceBakeData		data;
+
+	data.heightMap = heightMap;
+	data.outputMap = horizonMap;
+	data.mapWidth = width;
+	data.mapHeight = height;
+	data.bakeScale = scale;
+	data.normalMap = nullptr;
+	data.parallaxMap = nullptr;
+	data.ambientMap = nullptr;
+	data.parallaxScale = 1.0F;
+	data.ambientPower = 1.0F;
+	data.horizonRadius = radius;
+	data.bakeRect.Set(0, 0, width, height);
+	data.heightPyramid = nullptr;
+	data.farSampleArray = nullptr;
+	data.farSampleCount = 0;
+
+	// Build the shared offset table before any helper threads could race to create it.
+
+	HorizonOffsetTable::Get(radius, kHorizonAngleCount);
+
+	ExecuteBakeBands(height, &BakeSurfaceBand, &data, threadCount);
+}
+
+void Framework::BakeSurfaceMaps(const Color4U *heightMap, const SurfaceMapSet *mapSet, int32 width, int32 height, float scale, int32 threadCount)
+{
+	SurfaceBakeData		data;
+
+	// A normal map requested by itself is baked with the vectorized normal kernel.
+
+	if ((!mapSet->parallaxMap) && (!mapSet->horizonMap) && (!mapSet->ambientMap))
+	{
+		if (mapSet->normalMap)
+		{
+			BakeNormalMap(heightMap, mapSet->normalMap, width, height, scale, threadCount);
+		}
+
+		return;
+	}
+
+	data.heightMap = heightMap;
+	data.outputMap = mapSet->horizonMap;
+	data.mapWidth = width;
+	data.mapHeight = height;
+	data.bakeScale = scale;
+	data.normalMap = mapSet->normalMap;
+	data.parallaxMap = mapSet->parallaxMap;
+	data.ambientMap = mapSet->ambientMap;
+	data.parallaxScale = mapSet->parallaxScale;
+	data.ambientPower = mapSet->ambientPower;
+	data.heightPyramid = nullptr;
+	data.farSampleArray = nullptr;
+	data.farSampleCount = 0;
+
+	// The height window only needs to cover the horizon search when one of the maps
+	// depending on it is requested. Otherwise, the normal map needs one row on each side.
+
+	int32 radius = ((mapSet->horizonMap) || (mapSet->ambientMap)) ? kHorizonRadius : 2;
+	data.horizonRadius = radius;
+	data.bakeRect.Set(0, 0, width, height);
+
+	HorizonOffsetTable::Get(radius, kHorizonAngleCount);
+
+	ExecuteBakeBands(height, &BakeSurfaceBand, &data, threadCount);
+}
+
+void Framework::RebakeSurfaceMaps(const Color4U *heightMap, const SurfaceMapSet *mapSet, int32 width, int32 height, float scale, const Rect& rect, int32 threadCount)
+{
+	SurfaceBakeData		data;
+
+	data.heightMap = heightMap;
+	data.outputMap = mapSet->horizonMap;
+	data.mapWidth = width;
+	data.mapHeight = height;
+	data.bakeScale = scale;
+	data.normalMap = mapSet->normalMap;
+	data.parallaxMap = mapSet->parallaxMap;
+	data.ambientMap = mapSet->ambientMap;
+	data.parallaxScale = mapSet->parallaxScale;
+	data.ambientPower = mapSet->ambientPower;
+	data.heightPyramid = nullptr;
+	data.farSampleArray = nullptr;
+	data.farSampleCount = 0;
+
+	int32 radius = ((mapSet->horizonMap) || (mapSet->ambientMap)) ? kHorizonRadius : 2;
+	data.horizonRadius = radius;
+	data.bakeRect = rect;
+
+	HorizonOffsetTable::Get(radius, kHorizonAngleCount);
+
+	ExecuteBakeBands(rect.max.y - rect.min.y, &BakeSurfaceBand, &data, threadCount);
+}
+
+Rect Framework::GetSurfaceBakeFootprint(const SurfaceMapSet *mapSet, const Rect& dirtyRect)
+{
+	// A baked texel depends on every height within the search radius of the horizon and
+	// ambient maps, on its four direct neighbors for the normal map, and only on itself
+	// for the parallax map.
+
+	int32 border = 0;
+	if ((mapSet->horizonMap) || (mapSet->ambientMap))
+	{
+		border = kHorizonRadius - 1;
+	}
+	else if (mapSet->normalMap)
+	{
+		border = 1;
+	}
+
+	return (Rect(dirtyRect.min.x - border, dirtyRect.min.y - border, dirtyRect.max.x + border, dirtyRect.max.y + border));
+}
+
+int32 Framework::GetWrappedRects(const Rect& rect, int32 width, int32 height, Rect *wrappedRect)
+{
+	// The rectangle may extend past any edge of the map, and the parts that do are
+	// wrapped around to the opposite side. The result is at most four rectangles that
+	// lie inside the map and do not overlap.
+
+	int32	spanMin[2][2], spanMax[2][2];
+	int32	spanCount[2];
+
+	const int32 size[2] = {width, height};
+	const int32 rectMin[2] = {rect.min.x, rect.min.y};
+	const int32 rectMax[2] = {rect.max.x, rect.max.y};
+
+	for (int32 axis = 0; axis < 2; axis++)
+	{
+		int32 n = size[axis];
+		if (rectMax[axis] - rectMin[axis] >= n)
+		{
+			spanMin[axis][0] = 0;
+			spanMax[axis][0] = n;
+			spanCount[axis] = 1;
+			continue;
+		}
+
+		int32 lo = rectMin[axis] % n;
+		lo = (lo < 0) ? lo + n : lo;
+		int32 hi = lo + (rectMax[axis] - rectMin[axis]);
+
+		spanMin[axis][0] = lo;
+		spanMax[axis][0] = Min(hi, n);
+		spanCount[axis] = 1;
+
+		if (hi > n)
+		{
+			spanMin[axis][1] = 0;
+			spanMax[axis][1] = hi - n;
+			spanCount[axis] = 2;
+		}
+	}
+
+	int32 count = 0;
+	for (int32 j = 0; j < spanCount[1]; j++)
+	{
+		for (int32 i = 0; i < spanCount[0]; i++)
+		{
+			wrappedRect[count++].Set(spanMin[0][i], spanMin[1][j], spanMax[0][i], spanMax[1][j]);
+		}
+	}
+
+	return (count);
+}
+
+void Framework::BakeHorizonMapPyramid(const Color4U *heightMap, Color4U *horizonMap, int32 width, int32 height, float scale, int32 radius, float errorBound, int32 threadCount)
+{
+	constexpr int32 kAngleCount = kHorizonAngleCount;
+
+	const float angleIndex = float(kAngleCount) / float(2*3.14519);
+
+	HeightPyramid pyramid(heightMap, width, height);
+	int32 maxLevel = pyramid.GetLevelCount() - 1;
+
+	// Cells at each level are used for the texels whose distance d satisfies
+	// 2^level <= errorBound * d, and the coarsest level is used for the rest of the radius.
+	// The bound is limited to one half so that the cell containing a texel never reaches
+	// the distances sampled at its level.
+
+	errorBound = Fmin(errorBound, 0.5F);
+
+	// The cell offsets, angle ranges, and distances are the same for every texel. Relative to
+	// a texel, the cell at offset (a,b) from its own cell at a level with cell size s contains
+	// texels at offsets within s - 1 of (a * s, b * s) in each coordinate, depending on where the
+	// texel lies in its own cell. Every cell whose square of possible offsets reaches the
+	// distances sampled at its level is included, so each texel in the search radius falls in
+	// one of the cells for every texel position, and the squares of neighboring cells overlap.
+
+	Array<HorizonFarSample>		farSampleArray;
+
+	float innerRadius = float(kHorizonRadius);
+	for (int32 level = 0; (level <= maxLevel) && (innerRadius < float(radius)); level++)
+	{
+		float outerRadius = float(radius);
+		if ((level < maxLevel) && (errorBound > 0.0F))
+		{
+			outerRadius = Fmin(float(2 << level) / errorBound, outerRadius);
+		}
+
+		if (outerRadius <= innerRadius)
+		{
+			continue;
+		}
+
+		int32 cellSize = 1 << level;
+		int32 extent = cellSize - 1;
+		int32 cellRadius = (int32(outerRadius) + extent) / cellSize + 1;
+
+		for (int32 b = -cellRadius; b <= cellRadius; b++)
+		{
+			for (int32 a = -cellRadius; a <= cellRadius; a++)
+			{
+				int32 cx = a * cellSize;
+				int32 cy = b * cellSize;
+
+				int32 nearX = Max(Abs(cx) - extent, 0);
+				int32 nearY = Max(Abs(cy) - extent, 0);
+				int32 farX = Abs(cx) + extent;
+				int32 farY = Abs(cy) + extent;
+
+				float near2 = float(nearX * nearX + nearY * nearY);
+				float far2 = float(farX * farX + farY * farY);
+				if ((near2 == 0.0F) || (near2 >= outerRadius * outerRadius) || (far2 < innerRadius * innerRadius))
+				{
+					continue;
+				}
+
+				// The angles covered by the cell are bounded by the directions to the corners of
+				// its square, widened by the angle that the brute-force search gives a texel at
+				// the nearest distance.
+
+				float direction = atan2(float(cy), float(cx));
+				float minAngle = 0.0F;
+				float maxAngle = 0.0F;
+				for (int32 corner = 0; corner < 4; corner++)
+				{
+					float px = float(cx + ((corner & 1) ? extent : -extent));
+					float py = float(cy + ((corner & 2) ? extent : -extent));
+					float angle = atan2(py, px) - direction;
+					angle -= floor(angle * (0.5F / 3.14159265F) + 0.5F) * (2.0F * 3.14159265F);
+					minAngle = Fmin(minAngle, angle);
+					maxAngle = Fmax(maxAngle, angle);
+				}
+
+				float delta = atan(0.7071F / sqrt(near2));
+				int32 minIndex = int32(floor((direction + minAngle - delta) * angleIndex));
+				int32 maxIndex = int32(ceil((direction + maxAngle + delta) * angleIndex));
+
+				HorizonFarSample *sample = farSampleArray.AppendArrayElement();
+				sample->dx = int16(a);
+				sample->dy = int16(b);
+				sample->level = int16(level);
+				sample->minIndex = int16(minIndex);
+				sample->maxIndex = int16(Min(maxIndex, minIndex + kAngleCount - 1));
+				sample->inverseDistance2 = 1.0F / near2;
+			}
+		}
+
+		innerRadius = outerRadius;
+	}
+
+	SurfaceBakeData		data;
+
+	data.heightMap = heightMap;
+	data.outputMap = horizonMap;
+	data.mapWidth = width;
+	data.mapHeight = height;
+	data.bakeScale = scale;
+	data.normalMap = nullptr;
+	data.parallaxMap = nullptr;
+	data.ambientMap = nullptr;
+	data.parallaxScale = 1.0F;
+	data.ambientPower = 1.0F;
+	data.horizonRadius = kHorizonRadius;
+	data.bakeRect.Set(0, 0, width, height);
+	data.heightPyramid = &pyramid;
+	data.farSampleArray = farSampleArray;
+	data.farSampleCount = farSampleArray.GetArrayElementCount();
+
+	HorizonOffsetTable::Get(kHorizonRadius, kAngleCount);
+
+	ExecuteBakeBands(height, &BakeSurfaceBand, &data, threadCount);
+}
+
+void Framework::CompareHorizonMaps(const Color4U *exactMap, const Color4U *horizonMap, int32 width, int32 height, HorizonErrorReport *report)
+{
+	// Both layers are compared channel by channel.
+
+	int32 channelCount = width * height * 8;
+	const uint8 *exact = &exactMap->red;
+	const uint8 *approximate = &horizonMap->red;
+
+	float errorSum = 0.0F;
+	float squaredErrorSum = 0.0F;
+	int32 maxError = 0;
+	int32 overCount = 0;
+	int32 underCount = 0;
+
+	for (int32 k = 0; k < channelCount; k++)
+	{
+		int32 error = int32(approximate[k]) - int32(exact[k]);
+		overCount += (error > 0);
+		underCount += (error < 0);
+
+		error = Abs(error);
+		errorSum += float(error);
+		squaredErrorSum += float(error * error);
+		maxError = Max(maxError, error);
+	}
+
+	float inverseCount = 1.0F / float(channelCount);
+	report->meanError = errorSum * inverseCount;
+	report->rmsError = Sqrt(squaredErrorSum * inverseCount);
+	report->maxError = maxError;
+	report->overFraction = float(overCount) * inverseCount;
+	report->underFraction = float(underCount) * inverseCount;
+}
+
+void Framework::OutputHorizonErrorReport(const char *name, const HorizonErrorReport *report)
+{
+	String<> string(name);
+	string += ": mean error ";
+	string += String<>(report->meanError);
+	string += ", rms error ";
+	string += String<>(report->rmsError);
+	string += ", max error ";
+	string += report->maxError;
+	string += ", over ";
+	string += String<>(report->overFraction);
+	string += ", under ";
+	string += String<>(report->underFraction);
+	string += "\n";
+
+	OutputDebugText(string);
+}
+
+
+namespace
+{
+	enum
+	{
+		kHorizonSweepNearRadius			= 4,
+		kHorizonSweepSubdivisionCount	= 2
+	};
+
+
+	struct HorizonSweepData
+	{
+		const Color4U		*heightMap;
+		float				*tangentMap;
+		int32				mapWidth;
+		int32				mapHeight;
+
+		bool				transposed;
+		int32				majorStep;
+		float				minorStep;
+		int32				windowSize;
+	};
+
+
+	struct HorizonAccumulateData
+	{
+		const Color4U			*heightMap;
+		float					*tangentMap;
+		ColorRgba				*layerSum;
+		int32					mapWidth;
+		int32					mapHeight;
+
+		const HorizonOffset		*nearOffsetArray;
+		int32					nearOffsetCount;
+
+		float					channelWeight[2][4];
+	};
+
+
+	struct SweepStep
+	{
+		int32		majorOffset;
+		int32		minorDelta;
+		int32		wrappedMinorDelta;
+	};
+
+
+	struct SweepPoint
+	{
+		int32		height;
+		int32		minor;
+		int32		texelIndex;
+	};
+
+
+	inline int32 WrapCoordinate(int32 k, int32 size)
+	{
+		k %= size;
+		return ((k < 0) ? k + size : k);
+	}
+
+	inline bool SweepAngleLess(const SweepPoint *point, int32 a, int32 b, int32 p)
+	{
+		// Return true if point a is seen from point p at a lower angle than point b.
+		// Both a and b precede p on the line, and positions are measured in steps.
+
+		int32 h = point[p].height;
+		return ((point[a].height - h) * (p - b) < (point[b].height - h) * (p - a));
+	}
+
+	inline float CalculateSweepTangent2(const SweepPoint *point, int32 q, int32 p)
+	{
+		// Calculate the squared tangent from point p to point q with Equation (7.53),
+		// using the actual distance between the two texels.
+
+		int32 dh = point[q].height - point[p].height;
+		if (dh <= 0)
+		{
+			return (0.0F);
+		}
+
+		int32 dx = p - q;
+		int32 dy = point[p].minor - point[q].minor;
+		return (float(dh * dh) / float(dx * dx + dy * dy));
+	}
+
+
+	void SweepHorizonBand(int32 firstLine, int32 lineCount, void *cookie)
+	{
+		const HorizonSweepData *data = static_cast<HorizonSweepData *>(cookie);
+		const Color4U *heightMap = data->heightMap;
+		int32 width = data->mapWidth;
+		int32 height = data->mapHeight;
+
+		// Lines advance one texel at a time along the major axis, which is x unless the
+		// direction is closer to vertical. The position on the minor axis is rounded to the
+		// nearest texel, so every texel lies on exactly one line and is evaluated with its
+		// own height.
+
+		bool transposed = data->transposed;
+		int32 majorSize = (transposed) ? height : width;
+		int32 minorSize = (transposed) ? width : height;
+		int32 majorStride = (transposed) ? width : 1;
+		int32 minorStride = (transposed) ? 1 : width;
+
+		int32 majorStep = data->majorStep;
+		float minorStep = data->minorStep;
+
+		// Each point is occluded by the windowSize points preceding it. The line begins that
+		// many points early so that the window of the first texel evaluated is full.
+
+		int32 windowSize = data->windowSize;
+		int32 pointCount = windowSize + majorSize;
+
+		// The steps taken along the major and minor axes are the same for every line.
+
+		SweepStep *step = new SweepStep[pointCount];
+		for (int32 a = 0; a < pointCount; a++)
+		{
+			int32 k = a - windowSize;
+			int32 minor = int32(floor(float(k) * minorStep + 0.5F));
+
+			step[a].majorOffset = WrapCoordinate(k * majorStep, majorSize) * majorStride;
+			step[a].minorDelta = minor;
+			step[a].wrappedMinorDelta = WrapCoordinate(minor, minorSize);
+		}
+
+		SweepPoint *point = new SweepPoint[pointCount];
+		float *pointTan2 = new float[pointCount];
+		int32 *hull = new int32[windowSize + 1];
+
+		for (int32 line = firstLine; line < firstLine + lineCount; line++)
+		{
+			for (int32 a = 0; a < pointCount; a++)
+			{
+				int32 minor = line + step[a].wrappedMinorDelta;
+				minor -= (minor >= minorSize) ? minorSize : 0;
+
+				int32 texelIndex = step[a].majorOffset + minor * minorStride;
+				point[a].height = heightMap[texelIndex].red;
+				point[a].minor = step[a].minorDelta;
+				point[a].texelIndex = texelIndex;
+			}
+
+			// The line is divided into blocks of windowSize points, and the window of a point
+			// covers the part of its own block before it and the part of the previous block
+			// after the point windowSize steps back. Points never leave the window while the
+			// upper convex hull of either part is built, so the hull is always exact.
+			//
+			// The first part is handled by building the hull of each block from the front.
+			// Points that are not visible from the current point are under the segment joining
+			// their predecessor to the current point, so they are removed for good, and the
+			// point at the back is then the one on the horizon.
+
+			int32 hullSize = 0;
+			for (int32 p = 0; p < pointCount; p++)
+			{
+				if (p % windowSize == 0)
+				{
+					hullSize = 0;
+				}
+
+				while ((hullSize >= 2) && (!SweepAngleLess(point, hull[hullSize - 2], hull[hullSize - 1], p)))
+				{
+					hullSize--;
+				}
+
+				pointTan2[p] = (hullSize > 0) ? CalculateSweepTangent2(point, hull[hullSize - 1], p) : 0.0F;
+				hull[hullSize++] = p;
+			}
+
+			// The second part is handled by building the hull of each block from the back and
+			// visiting the points of the next block in reverse order, so the hull always holds
+			// exactly the part of the window in the previous block. The hull is concave, so the
+			// angle at which its points are seen rises to a single maximum that is found with a
+			// binary search. The first entry in the hull is the point at the end of the block.
+
+			for (int32 blockStart = windowSize; blockStart < pointCount; blockStart += windowSize)
+			{
+				hullSize = 0;
+				for (int32 j = windowSize - 1; j >= 0; j--)
+				{
+					int32 s = blockStart - windowSize + j;
+					while (hullSize >= 2)
+					{
+						int32 b = hull[hullSize - 1];
+						int32 c = hull[hullSize - 2];
+						if ((point[b].height - point[s].height) * (c - s) > (point[c].height - point[s].height) * (b - s))
+						{
+							break;
+						}
+
+						hullSize--;
+					}
+
+					hull[hullSize++] = s;
+
+					int32 p = blockStart + j;
+					if (p < pointCount)
+					{
+						int32 lo = 0;
+						int32 hi = hullSize - 1;
+						while (lo < hi)
+						{
+							int32 mid = (lo + hi) >> 1;
+							if (SweepAngleLess(point, hull[mid], hull[mid + 1], p))
+							{
+								lo = mid + 1;
+							}
+							else
+							{
+								hi = mid;
+							}
+						}
+
+						pointTan2[p] = Fmax(pointTan2[p], CalculateSweepTangent2(point, hull[lo], p));
+					}
+				}
+			}
+
+			for (int32 p = windowSize; p < pointCount; p++)
+			{
+				float& m = data->tangentMap[point[p].texelIndex];
+				m = Fmax(m, pointTan2[p]);
+			}
+		}
+
+		delete[] hull;
+		delete[] pointTan2;
+		delete[] point;
+		delete[] step;
+	}
+
+
+	void AccumulateHorizonBand(int32 firstRow, int32 rowCount, void *cookie)
+	{
+		const HorizonAccumulateData *data = static_cast<HorizonAccumulateData *>(cookie);
+		int32 width = data->mapWidth;
+		int32 height = data->mapHeight;
+		int32 layerSize = width * height;
+
+		// Texels close to the center subtend angles much wider than the spacing of the lines,
+		// so they are searched exactly with the offsets that the brute-force baker applies to
+		// the current direction. The tangent map is cleared for the next direction as it is read.
+
+		const HorizonOffset *nearOffsetArray = data->nearOffsetArray;
+		int32 nearOffsetCount = data->nearOffsetCount;
+
+		HeightWindow window(data->heightMap, width, height, kHorizonSweepNearRadius - 1);
+		window.BeginBand(firstRow);
+
+		const uint8		*rowTable[kHorizonSweepNearRadius * 2 - 1];
+
+		for (int32 y = firstRow; y < firstRow + rowCount; y++)
+		{
+			if (y != firstRow)
+			{
+				window.AdvanceRow(y);
+			}
+
+			for (int32 j = 0; j < kHorizonSweepNearRadius * 2 - 1; j++)
+			{
+				rowTable[j] = window.GetRow(y + j - (kHorizonSweepNearRadius - 1));
+			}
+
+			const uint8 *centerRow = rowTable[kHorizonSweepNearRadius - 1];
+			float *tangentMap = data->tangentMap + y * width;
+			ColorRgba *layerSum = data->layerSum + y * width;
+
+			for (int32 x = 0; x < width; x++)
+			{
+				int32 h0 = centerRow[x];
+				float t = tangentMap[x];
+				tangentMap[x] = 0.0F;
+
+				for (int32 k = 0; k < nearOffsetCount; k++)
+				{
+					const HorizonOffset *offset = &nearOffsetArray[k];
+					int32 dh = rowTable[offset->dy + (kHorizonSweepNearRadius - 1)][x + offset->dx] - h0;
+					if (dh > 0)
+					{
+						t = Fmax(t, float(dh * dh) * offset->inverseRadius2);
+					}
+				}
+
+				float sine = sqrt(t / (t + 1.0F));
+				for (int32 layer = 0; layer < 2; layer++)
+				{
+					ColorRgba& sum = layerSum[layer * layerSize + x];
+					const float *weight = data->channelWeight[layer];
+					sum.red += sine * weight[0];
+					sum.green += sine * weight[1];
+					sum.blue += sine * weight[2];
+					sum.alpha += sine * weight[3];
+				}
+			}
+		}
+	}
+}
+
+
+void Framework::BakeHorizonMapSweep(const Color4U *heightMap, Color4U *horizonMap, int32 width, int32 height, float scale, int32 radius, int32 threadCount)
+{
+	constexpr int32 kAngleCount = kHorizonAngleCount;
+
+	const float angleStep = float(2*3.14519) / float(kAngleCount);
+
+	int32 layerSize = width * height;
+	float *tangentMap = new float[layerSize];
+	ColorRgba *layerSum = new ColorRgba[layerSize * 2];
+
+	for (int32 k = 0; k < layerSize; k++)
+	{
+		tangentMap[k] = 0.0F;
+	}
+
+	for (int32 k = 0; k < layerSize * 2; k++)
+	{
+		layerSum[k].Set(0.0F, 0.0F, 0.0F, 0.0F);
+	}
+
+	HorizonSweepData		sweepData;
+	HorizonAccumulateData	accumulateData;
+
+	sweepData.heightMap = heightMap;
+	sweepData.tangentMap = tangentMap;
+	sweepData.mapWidth = width;
+	sweepData.mapHeight = height;
+
+	accumulateData.heightMap = heightMap;
+	accumulateData.tangentMap = tangentMap;
+	accumulateData.layerSum = layerSum;
+	accumulateData.mapWidth = width;
+	accumulateData.mapHeight = height;
+
+	const HorizonOffsetTable *offsetTable = HorizonOffsetTable::Get(kHorizonSweepNearRadius, kAngleCount);
+	const HorizonOffset *nearOffsetTable = offsetTable->GetOffsetArray();
+	int32 nearOffsetCount = offsetTable->GetOffsetCount();
+
+	Array<HorizonOffset>	nearOffsetArray;
+
+	for (int32 direction = 0; direction < kAngleCount; direction++)
+	{
+		// The brute-force baker applies every texel to all directions within one angle step
+		// of the directions it subtends, so lines are swept at several angles across that range
+		// and the largest tangent is kept for each texel.
+
+		for (int32 subdivision = 1 - kHorizonSweepSubdivisionCount; subdivision < kHorizonSweepSubdivisionCount; subdivision++)
+		{
+			// Walk each line against the direction being evaluated so that the occluders
+			// for a point have already been passed when the point is reached.
+
+			float angle = (float(direction) + float(subdivision) / float(kHorizonSweepSubdivisionCount)) * angleStep;
+			float dx = cos(angle);
+			float dy = sin(angle);
+			float ax = Fabs(dx);
+			float ay = Fabs(dy);
+
+			sweepData.transposed = (ay > ax);
+			if (!sweepData.transposed)
+			{
+				sweepData.majorStep = (dx > 0.0F) ? -1 : 1;
+				sweepData.minorStep = -dy / ax;
+				sweepData.windowSize = Max(int32(ceil(float(radius) * ax)) - 1, 1);
+			}
+			else
+			{
+				sweepData.majorStep = (dy > 0.0F) ? -1 : 1;
+				sweepData.minorStep = -dx / ay;
+				sweepData.windowSize = Max(int32(ceil(float(radius) * ay)) - 1, 1);
+			}
+
+			ExecuteBakeBands((sweepData.transposed) ? width : height, &SweepHorizonBand, &sweepData, threadCount);
+		}
+
+		// Collect the offsets inside the near radius whose angular range covers this direction.
+
+		nearOffsetArray.SetArrayElementCount(0);
+		for (int32 k = 0; k < nearOffsetCount; k++)
+		{
+			const HorizonOffset *offset = &nearOffsetTable[k];
+			for (int32 n = offset->minIndex; n <= offset->maxIndex; n++)
+			{
+				if ((n & (kAngleCount - 1)) == direction)
+				{
+					nearOffsetArray.AppendArrayElement(*offset);
+					break;
+				}
+			}
+		}
+
+		accumulateData.nearOffsetArray = nearOffsetArray;
+		accumulateData.nearOffsetCount = nearOffsetArray.GetArrayElementCount();
+
+		// Add the sine of the horizon angle to every channel that samples this direction,
+		// using the same index ranges as the brute-force baker.
+
+		for (int32 layer = 0; layer < 2; layer++)
+		{
+			float *weight = accumulateData.channelWeight[layer];
+			weight[0] = weight[1] = weight[2] = weight[3] = 0.0F;
+
+			int32 firstIndex = kAngleCount / 16 + layer * (kAngleCount / 2);
+			int32 lastIndex = firstIndex + kAngleCount / 8;
+			for (int32 index = firstIndex; index <= lastIndex; index++)
+			{
+				weight[0] += float(((index - kAngleCount / 8) & (kAngleCount - 1)) == direction);
+				weight[1] += float(index == direction);
+				weight[2] += float(index + kAngleCount / 8 == direction);
+				weight[3] += float(((index + kAngleCount / 4) & (kAngleCount - 1)) == direction);
+			}
+		}
+
+		ExecuteBakeBands(height, &AccumulateHorizonBand, &accumulateData, threadCount);
+	}
+
+	for (int32 k = 0; k < layerSize * 2; k++)
+	{
+		horizonMap[k] = layerSum[k] / float(kAngleCount / 8 + 1);
+	}
+
+	delete[] layerSum;
+	delete[] tangentMap;
+}
+
+
+namespace
+{
+	struct ConeBakeData
+	{
+		const HeightPyramid		*heightPyramid;
+		Color1U					*coneMap;
+		float					inverseWidth2;
+		float					inverseHeight2;
+	};
+
+
+	struct ConeCell
+	{
+		int32		level;
+		int32		x;
+		int32		y;
+		float		bound;
+	};
+
+
+	inline int32 GetWrappedDistance(int32 p, int32 cellMin, int32 cellSize, int32 size)
+	{
+		// Return the smallest distance from p to any texel in a cell when the map wraps.
+
+		int32 offset = cellMin - p;
+		offset += size & (offset >> 31);
+
+		int32 end = offset + cellSize - 1;
+		if (end >= size)
+		{
+			return (0);
+		}
+
+		return (Min(offset, size - end));
+	}
+
+
+	void BakeConeBand(int32 firstRow, int32 rowCount, void *cookie)
+	{
+		const ConeBakeData *data = static_cast<ConeBakeData *>(cookie);
+		const HeightPyramid *pyramid = data->heightPyramid;
+
+		int32 width = pyramid->GetLevelWidth(0);
+		int32 height = pyramid->GetLevelHeight(0);
+		int32 topLevel = pyramid->GetLevelCount() - 1;
+
+		const uint8 *heightData = pyramid->GetLevelData(0);
+		Color1U *coneMap = data->coneMap + firstRow * width;
+
+		// A depth-first search descends at most three cells per level below the top.
+
+		ConeCell	cellStack[HeightPyramid::kMaxLevelCount * 3 + 1];
+
+		for (int32 y = firstRow; y < firstRow + rowCount; y++)
+		{
+			int32 nearestX = -1;
+			int32 nearestY = 0;
+
+			for (int32 x = 0; x < width; x++)
+			{
+				int32 h = heightData[y * width + x];
+
+				// The cone ratio is the smallest horizontal distance divided by height gain to any
+				// texel higher than this one, in texture coordinates with heights in [0,1]. It is
+				// found by descending the pyramid and discarding every cell that is not higher or
+				// cannot lower the ratio already found. Squared ratios are compared throughout.
+
+				float ratio2 = 1.0F;
+
+				// The texel that limited the previous cone usually limits this one as well, and
+				// starting with its ratio allows most cells to be discarded right away.
+
+				if (nearestX >= 0)
+				{
+					int32 dh = heightData[nearestY * width + nearestX] - h;
+					if (dh > 0)
+					{
+						float dx = float(GetWrappedDistance(x, nearestX, 1, width));
+						float dy = float(GetWrappedDistance(y, nearestY, 1, height));
+						float d2 = (dx * dx * data->inverseWidth2 + dy * dy * data->inverseHeight2) * (255.0F * 255.0F);
+						ratio2 = Fmin(d2 / float(dh * dh), 1.0F);
+					}
+				}
+
+				int32 stackSize = 1;
+				cellStack[0].level = topLevel;
+				cellStack[0].x = 0;
+				cellStack[0].y = 0;
+				cellStack[0].bound = 0.0F;
+
+				do
+				{
+					const ConeCell *cell = &cellStack[--stackSize];
+					if (cell->bound >= ratio2)
+					{
+						continue;
+					}
+
+					int32 level = cell->level;
+					if (level == 0)
+					{
+						ratio2 = cell->bound;
+						nearestX = cell->x;
+						nearestY = cell->y;
+						continue;
+					}
+
+					level--;
+					int32 levelWidth = pyramid->GetLevelWidth(level);
+					int32 levelHeight = pyramid->GetLevelHeight(level);
+					const uint8 *levelData = pyramid->GetLevelData(level);
+					int32 cellSize = 1 << level;
+
+					ConeCell	child[4];
+					int32		childCount = 0;
+
+					int32 cx = cell->x * 2;
+					int32 cy = cell->y * 2;
+					int32 ymax = Min(cy + 2, levelHeight);
+					int32 xmax = Min(cx + 2, levelWidth);
+
+					for (int32 j = cy; j < ymax; j++)
+					{
+						for (int32 i = cx; i < xmax; i++)
+						{
+							int32 dh = levelData[j * levelWidth + i] - h;
+							if (dh > 0)
+							{
+								float dx = float(GetWrappedDistance(x, i << level, cellSize, width));
+								float dy = float(GetWrappedDistance(y, j << level, cellSize, height));
+								float d2 = (dx * dx * data->inverseWidth2 + dy * dy * data->inverseHeight2) * (255.0F * 255.0F);
+								float bound = d2 / float(dh * dh);
+
+								if (bound < ratio2)
+								{
+									// Insert children in order of decreasing bound so that the
+									// most promising one is popped first.
+
+									int32 k = childCount++;
+									while ((k > 0) && (child[k - 1].bound < bound))
+									{
+										child[k] = child[k - 1];
+										k--;
+									}
+
+									child[k].level = level;
+									child[k].x = i;
+									child[k].y = j;
+									child[k].bound = bound;
+								}
+							}
+						}
+					}
+
+					for (int32 k = 0; k < childCount; k++)
+					{
+						cellStack[stackSize++] = child[k];
+					}
+				} while (stackSize != 0);
+
+				// The square root of the ratio is stored for better precision with narrow cones.
+				// It is biased slightly and rounded down so that the cone never passes through the
+				// surface, and the smallest possible ratio keeps the result positive.
+
+				coneMap[x] = Color1U(Sqrt(Sqrt(ratio2)) * 255.0F - 0.01F);
+			}
+
+			coneMap += width;
+		}
+	}
+}
+
+
+void Framework::BakeConeMap(const Color4U *heightMap, Color1U *coneMap, int32 width, int32 height, int32 threadCount)
+{
+	HeightPyramid pyramid(heightMap, width, height);
+
+	ConeBakeData	data;
+
+	data.heightPyramid = &pyramid;
+	data.coneMap = coneMap;
+	data.inverseWidth2 = 1.0F / float(width * width);
+	data.inverseHeight2 = 1.0F / float(height * height);
+
+	ExecuteBakeBands(height, &BakeConeBand, &data, threadCount);
+}
+
+
+namespace
+{
+	enum
+	{
+		kGammaEncodeTableSize	= 4096,
+		kMipmapFilterRadius		= 3,
+		kMipmapFilterTapCount	= kMipmapFilterRadius * 4
+	};
+
+
+	float			gammaDecodeTable[256];
+	float			linearDecodeTable[256];
+	float			gammaEncodeThreshold[256];
+	uint8			gammaEncodeTable[kGammaEncodeTableSize];
+	volatile int32	gammaTableState = 0;
+
+
+	float DecodeGamma(float c)
+	{
+		return ((c <= 0.04045F) ? c * (1.0F / 12.92F) : pow((c + 0.055F) * (1.0F / 1.055F), 2.4F));
+	}
+
+	void InitializeGammaTables(void)
+	{
+		// The encode threshold for each sRGB value is the linear intensity halfway between it and the
+		// next value in the encoded space. A linear intensity is encoded by looking up the value
+		// at the start of its interval in the encode table and then comparing with the threshold
+		// for that value. The intervals are narrower than the distance between any two thresholds,
+		// so a single comparison always produces the correctly rounded result.
+
+		// Textures may be prepared on several threads at once, so the first thread to arrive
+		// builds the tables while any others wait for it to finish.
+
+		if (gammaTableState == 2)
+		{
+			return;
+		}
+
+		if (AtomicCompareExchange(&gammaTableState, 1, 0) == 0)
+		{
+			for (int32 c = 0; c < 256; c++)
+			{
+				gammaDecodeTable[c] = DecodeGamma(float(c) * (1.0F / 255.0F));
+				linearDecodeTable[c] = float(c) * (1.0F / 255.0F);
+				gammaEncodeThreshold[c] = (c < 255) ? DecodeGamma((float(c) + 0.5F) * (1.0F / 255.0F)) : 2.0F;
+			}
+
+			int32 c = 0;
+			for (int32 k = 0; k < kGammaEncodeTableSize; k++)
+			{
+				float f = float(k) * (1.0F / float(kGammaEncodeTableSize));
+				while (f >= gammaEncodeThreshold[c])
+				{
+					c++;
+				}
+
+				gammaEncodeTable[k] = uint8(c);
+			}
+
+			AtomicCompareExchange(&gammaTableState, 2, 1);
+		}
+		else
+		{
+			while (gammaTableState != 2)
+			{
+				YieldThread();
+			}
+		}
+	}
+
+	inline uint32 EncodeGamma(float f)
+	{
+		int32 c = gammaEncodeTable[Min(int32(f * float(kGammaEncodeTableSize)), kGammaEncodeTableSize - 1)];
+		return (c + (f >= gammaEncodeThreshold[c]));
+	}
+
+	inline vec_float LoadGammaTexel(const Color4U& texel)
+	{
+		#if defined(TERATHON_SSE)
+
+			return (_mm_setr_ps(gammaDecodeTable[texel.red], gammaDecodeTable[texel.green], gammaDecodeTable[texel.blue], linearDecodeTable[texel.alpha]));
+
+		#else
+
+			alignas(16) float	f[4];
+
+			f[0] = gammaDecodeTable[texel.red];
+			f[1] = gammaDecodeTable[texel.green];
+			f[2] = gammaDecodeTable[texel.blue];
+			f[3] = linearDecodeTable[texel.alpha];
+			return (VecLoad(f));
+
+		#endif
+	}
+
+	inline void StoreGammaTexel(const vec_float& color, Color4U *texel)
+	{
+		alignas(16) float	f[4];
+
+		VecStore(VecMin(VecMax(color, VecFloatGetZero()), VecLoadVectorConstant<0x3F800000>()), f);
+		texel->Set(EncodeGamma(f[0]), EncodeGamma(f[1]), EncodeGamma(f[2]), uint32(f[3] * 255.0F + 0.5F));
+	}
+
+
+	float CalculateSinc(float x)
+	{
+		if (Fabs(x) < 1.0e-5F)
+		{
+			return (1.0F);
+		}
+
+		x *= Math::tau_over_2;
+		return (sin(x) / x);
+	}
+
+	float CalculateBessel(float x)
+	{
+		// Sum the power series for the zeroth-order modified Bessel function of the first kind.
+
+		float sum = 1.0F;
+		float term = 1.0F;
+		float y = x * x * 0.25F;
+
+		for (int32 k = 1; k < 32; k++)
+		{
+			term *= y / float(k * k);
+			sum += term;
+			if (term < sum * 1.0e-7F)
+			{
+				break;
+			}
+		}
+
+		return (sum);
+	}
+
+	float EvaluateMipmapFilter(int32 filter, float x)
+	{
+		// The filters are windowed sinc functions extending kMipmapFilterRadius texels of the
+		// destination level on each side. The Kaiser window uses an alpha of four.
+
+		constexpr float kRadius = float(kMipmapFilterRadius);
+
+		if (Fabs(x) >= kRadius)
+		{
+			return (0.0F);
+		}
+
+		if (filter == kMipmapFilterLanczos)
+		{
+			return (CalculateSinc(x) * CalculateSinc(x * (1.0F / kRadius)));
+		}
+
+		constexpr float kAlpha = 4.0F;
+
+		float t = x * (1.0F / kRadius);
+		return (CalculateSinc(x) * CalculateBessel(kAlpha * Sqrt(1.0F - t * t)) / CalculateBessel(kAlpha));
+	}
+
+
+	struct MipmapFilterAxis
+	{
+		int32		tapOffset;
+		int32		tapCount;
+		float		tapWeight[kMipmapFilterTapCount];
+	};
+
+
+	void CalculateMipmapFilterAxis(int32 filter, int32 inputSize, MipmapFilterAxis *axis)
+	{
+		// Destination texel i is centered on the boundary between source texels 2i and 2i + 1.
+		// The tap offsets are relative to source texel 2i, and the weights are normalized so
+		// that a constant image is unchanged.
+
+		if (inputSize == 1)
+		{
+			axis->tapOffset = 0;
+			axis->tapCount = 1;
+			axis->tapWeight[0] = 1.0F;
+		}
+		else if (filter == kMipmapFilterBox)
+		{
+			axis->tapOffset = 0;
+			axis->tapCount = 2;
+			axis->tapWeight[0] = 0.5F;
+			axis->tapWeight[1] = 0.5F;
+		}
+		else
+		{
+			axis->tapOffset = 1 - kMipmapFilterTapCount / 2;
+			axis->tapCount = kMipmapFilterTapCount;
+
+			float sum = 0.0F;
+			for (int32 k = 0; k < kMipmapFilterTapCount; k++)
+			{
+				float w = EvaluateMipmapFilter(filter, (float(k + axis->tapOffset) - 0.5F) * 0.5F);
+				axis->tapWeight[k] = w;
+				sum += w;
+			}
+
+			float inverseSum = 1.0F / sum;
+			for (int32 k = 0; k < kMipmapFilterTapCount; k++)
+			{
+				axis->tapWeight[k] *= inverseSum;
+			}
+		}
+	}
+
+
+	struct GammaMipmapData
+	{
+		const Color4U			*inputLevel;
+		Integer2D				inputSize;
+		Color4U					*outputLevel;
+		Integer2D				outputSize;
+
+		MipmapFilterAxis		filterAxis[2];
+	};
+
+
+	void GenerateGammaMipmapBand(int32 firstRow, int32 rowCount, void *cookie)
+	{
+		const GammaMipmapData *data = static_cast<GammaMipmapData *>(cookie);
+		const MipmapFilterAxis *xaxis = &data->filterAxis[0];
+		const MipmapFilterAxis *yaxis = &data->filterAxis[1];
+
+		int32 inputWidth = data->inputSize.x;
+		int32 inputHeight = data->inputSize.y;
+		int32 outputWidth = data->outputSize.x;
+
+		// Each destination row is filtered vertically into a row of linear colors, which is then
+		// extended on both sides with wrapped colors and filtered horizontally.
+
+		constexpr int32 kApronSize = kMipmapFilterTapCount;
+
+		vec_float *columnStorage = new vec_float[inputWidth + kApronSize * 2];
+		vec_float *column = columnStorage + kApronSize;
+
+		for (int32 y = firstRow; y < firstRow + rowCount; y++)
+		{
+			for (int32 i = 0; i < inputWidth; i++)
+			{
+				column[i] = VecFloatGetZero();
+			}
+
+			for (int32 k = 0; k < yaxis->tapCount; k++)
+			{
+				int32 j = y * 2 + yaxis->tapOffset + k;
+				j = (j % inputHeight + inputHeight) % inputHeight;
+
+				const Color4U *input = data->inputLevel + j * inputWidth;
+				vec_float w = VecLoadSmearScalar(&yaxis->tapWeight[k]);
+
+				for (int32 i = 0; i < inputWidth; i++)
+				{
+					column[i] = VecMadd(LoadGammaTexel(input[i]), w, column[i]);
+				}
+			}
+
+			for (int32 i = 1; i <= kApronSize; i++)
+			{
+				column[-i] = column[(inputWidth - i % inputWidth) % inputWidth];
+				column[inputWidth - 1 + i] = column[(i - 1) % inputWidth];
+			}
+
+			Color4U *output = data->outputLevel + y * outputWidth;
+			for (int32 x = 0; x < outputWidth; x++)
+			{
+				const vec_float *c = column + x * 2 + xaxis->tapOffset;
+
+				vec_float color = VecFloatGetZero();
+				for (int32 k = 0; k < xaxis->tapCount; k++)
+				{
+					color = VecMadd(c[k], VecLoadSmearScalar(&xaxis->tapWeight[k]), color);
+				}
+
+				StoreGammaTexel(color, &output[x]);
+			}
+		}
+
+		delete[] columnStorage;
+	}
+}
+
+
+int32 Framework::GenerateGammaMipmapImages(const Integer3D& size, const Color4U *source, Color4U **image, int32 filter, int32 threadCount)
+{
+	Color4U *pixelData = new Color4U[CalculateMipmapImageSize(size, 1)];
+	Terathon::CopyMemory(source, pixelData, size.x * size.y * size.z * sizeof(Color4U));
+
+	*image = pixelData;
+	return (BuildGammaMipmapImages(size, pixelData, filter, threadCount));
+}
+
+int32 Framework::BuildGammaMipmapImages(const Integer3D& size, Color4U *image, int32 filter, int32 threadCount)
+{
+	InitializeGammaTables();
+
+	// Each level is filtered from the previous level, and the rows of each level are
+	// distributed among the bake threads.
+
+	GammaMipmapData		data;
+
+	int32 mipmapCount = 1;
+	Color4U *inputLevel = image;
+	data.inputSize.Set(size.x, size.y);
+
+	while ((data.inputSize.x != 1) || (data.inputSize.y != 1))
+	{
+		data.outputSize.Set(Max(data.inputSize.x >> 1, 1), Max(data.inputSize.y >> 1, 1));
+		CalculateMipmapFilterAxis(filter, data.inputSize.x, &data.filterAxis[0]);
+		CalculateMipmapFilterAxis(filter, data.inputSize.y, &data.filterAxis[1]);
+
+		int32 inputLayerSize = data.inputSize.x * data.inputSize.y;
+		int32 outputLayerSize = data.outputSize.x * data.outputSize.y;
+		Color4U *outputLevel = inputLevel + inputLayerSize * size.z;
+
+		for (int32 layer = 0; layer < size.z; layer++)
+		{
+			data.inputLevel = inputLevel + layer * inputLayerSize;
+			data.outputLevel = outputLevel + layer * outputLayerSize;
+			ExecuteBakeBands(data.outputSize.y, &GenerateGammaMipmapBand, &data, threadCount);
+		}
+
+		inputLevel = outputLevel;
+		data.inputSize = data.outputSize;
+		mipmapCount++;
+	}
+
+	return (mipmapCount);
+}
+
+
+namespace
+{
+	enum
+	{
+		kBakeCacheIdentifier	= 'BAKE',
+		kBakeCacheVersion		= 3
+	};
+
+
+	// The BakeCacheParams structure holds everything besides the source pixels that
+	// determines the contents of a cached mipmap chain.
+
+	struct BakeCacheParams
+	{
+		uint32		version;
+		uint32		mapType;
+		int32		width;
+		int32		height;
+		float		scale;
+		int32		angleCount;
+		int32		horizonRadius;
+		int32		horizonBakeMode;
+		int32		horizonSearchRadius;
+		float		horizonPyramidError;
+	};
+
+
+	struct BakeCacheHeader
+	{
+		uint32		identifier;
+		uint32		version;
+		uint64		key;
+		int32		mipmapCount;
+		uint32		imageSize;
+		uint32		codeSize;
+		uint32		reserved;
+	};
+
+
+	inline uint64 HashBakeData(uint64 hash, const void *data, uint32 size)
+	{
+		// This is the 64-bit FNV-1a hash.
+
+		const uint8 *byte = static_cast<const uint8 *>(data);
+		for (uint32 k = 0; k < size; k++)
+		{
+			hash = (hash ^ byte[k]) * 0x00000100000001B3ULL;
+		}
+
+		return (hash);
+	}
+}
+
+
+uint64 Framework::CalculateBakeCacheKey(const Color4U *heightMap, int32 width, int32 height, uint32 mapType, float scale)
+{
+	BakeCacheParams		params;
+
+	params.version = kBakeCacheVersion;
+	params.mapType = mapType;
+	params.width = width;
+	params.height = height;
+	params.scale = scale;
+	params.angleCount = kHorizonAngleCount;
+	params.horizonRadius = kHorizonRadius;
+	params.horizonBakeMode = HORIZON_BAKE_MODE;
+	params.horizonSearchRadius = HORIZON_SEARCH_RADIUS;
+	params.horizonPyramidError = HORIZON_PYRAMID_ERROR;
+
+	uint64 hash = HashBakeData(0xCBF29CE484222325ULL, &params, sizeof(BakeCacheParams));
+	return (HashBakeData(hash, heightMap, width * height * sizeof(Color4U)));
+}
+
+uint64 Framework::CalculateBakeChecksum(const void *data, uint32 size)
+{
+	return (HashBakeData(0xCBF29CE484222325ULL, data, size));
+}
+
+#if defined(_WIN32)
+
+	namespace
+	{
+		void GetBakeCacheFileName(uint64 key, char *name)
+		{
+			static const char hexDigit[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+
+			const char *directory = BAKE_CACHE_DIRECTORY;
+			while (*directory != 0)
+			{
+				*name++ = *directory++;
+			}
+
+			*name++ = '/';
+			for (int32 k = 60; k >= 0; k -= 4)
+			{
+				*name++ = hexDigit[(key >> k) & 15];
+			}
+
+			name[0] = '.';
+			name[1] = 'b';
+			name[2] = 'a';
+			name[3] = 'k';
+			name[4] = 'e';
+			name[5] = 0;
+		}
+	}
+
+
+	void *Framework::LoadBakeCache(uint64 key, const Integer3D& size, uint32 pixelSize, int32 *mipmapCount)
+	{
+		char				name[64];
+		BakeCacheHeader		header;
+		DWORD				actual;
+
+		GetBakeCacheFileName(key, name);
+		HANDLE fileHandle = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+		{
+			return (nullptr);
+		}
+
+		// The image size and mipmap count are determined by the dimensions of the map, and they are
+		// checked before anything is allocated. The code is always smaller than the image because
+		// an image that doesn't compress is stored uncompressed.
+
+		uint32 imageSize = CalculateMipmapImageSize(size, pixelSize);
+
+		int32 levelCount = 1;
+		for (int32 s = Max(size.x, size.y); s > 1; s >>= 1)
+		{
+			levelCount++;
+		}
+
+		char *image = nullptr;
+
+		// A file that is truncated, belongs to another key or version, or doesn't decode to
+		// exactly the expected size is treated as a miss.
+
+		if ((ReadFile(fileHandle, &header, sizeof(BakeCacheHeader), &actual, nullptr)) && (actual == sizeof(BakeCacheHeader)) && (header.identifier == kBakeCacheIdentifier) && (header.version == kBakeCacheVersion) && (header.key == key)
+			&& (header.mipmapCount == levelCount) && (header.imageSize == imageSize) && (header.codeSize < imageSize))
+		{
+			uint32 codeSize = header.codeSize;
+
+			image = new char[imageSize];
+			if (codeSize != 0)
+			{
+				uint8 *code = new uint8[codeSize];
+				if ((!ReadFile(fileHandle, code, codeSize, &actual, nullptr)) || (actual != codeSize) || (Compression::DecompressData(code, codeSize, image, imageSize) != imageSize))
+				{
+					delete[] image;
+					image = nullptr;
+				}
+
+				delete[] code;
+			}
+			else if ((!ReadFile(fileHandle, image, imageSize, &actual, nullptr)) || (actual != imageSize))
+			{
+				delete[] image;
+				image = nullptr;
+			}
+
+			*mipmapCount = levelCount;
+		}
+
+		CloseHandle(fileHandle);
+		return (image);
+	}
+
+	void Framework::StoreBakeCache(uint64 key, int32 mipmapCount, const void *image, uint32 imageSize)
+	{
+		char				name[64];
+		BakeCacheHeader		header;
+		DWORD				actual;
+
+		CreateDirectoryA(BAKE_CACHE_DIRECTORY, nullptr);
+
+		GetBakeCacheFileName(key, name);
+		HANDLE fileHandle = CreateFileA(name, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+
+		// The compressor pads its code to a multiple of four bytes, so the code buffer needs three
+		// bytes beyond the image size. The image is stored uncompressed if compression fails or
+		// doesn't make it smaller.
+
+		uint8 *code = new uint8[imageSize + 4];
+		uint32 codeSize = Compression::CompressData(image, imageSize, code);
+		if (codeSize >= imageSize)
+		{
+			codeSize = 0;
+		}
+
+		header.identifier = kBakeCacheIdentifier;
+		header.version = kBakeCacheVersion;
+		header.key = key;
+		header.mipmapCount = mipmapCount;
+		header.imageSize = imageSize;
+		header.codeSize = codeSize;
+		header.reserved = 0;
+
+		bool success = ((WriteFile(fileHandle, &header, sizeof(BakeCacheHeader), &actual, nullptr)) && (actual == sizeof(BakeCacheHeader)));
+		if (success)
+		{
+			const void *data = (codeSize != 0) ? static_cast<const void *>(code) : image;
+			uint32 size = (codeSize != 0) ? codeSize : imageSize;
+			success = ((WriteFile(fileHandle, data, size, &actual, nullptr)) && (actual == size));
+		}
+
+		delete[] code;
+		CloseHandle(fileHandle);
+
+		if (!success)
+		{
+			DeleteFileA(name);
+		}
+	}
+
+#else
+
+	void *Framework::LoadBakeCache(uint64, const Integer3D&, uint32, int32 *)
+	{
+		return (nullptr);
+	}
+
+	void Framework::StoreBakeCache(uint64, int32, const void *, uint32)
+	{
+	}
+
+#endif
+
+
+void Framework::GenerateHorizonCube(Color4U *texel)
+{
+	for (int32 face = 0; face < 6; face++)
+	{
+		for (float y = -0.9375F; y < 1.0F; y += 0.125F)
+		{
+			for (float x = -0.9375F; x < 1.0F; x += 0.125F)
+			{
+				Vector2D	v;
+
+				float r = 1.0F / sqrt(1.0F + x * x + y * y);
+				switch (face)
+				{
+					case 0: v.Set(r, -y * r); break;
+					case 1: v.Set(-r, -y * r); break;
+					case 2: v.Set(x * r, r); break;
+					case 3: v.Set(x * r, -r); break;
+					case 4: v.Set(x * r, -y * r); break;
+					case 5: v.Set(-x * r, -y * r); break;
+				}
+
+				float t = atan2(v.y, v.x) / (3.14519 / 4);
+				float red = 0.0F;
+				float green = 0.0F;
+				float blue = 0.0F;
+				float alpha = 0.0F;
+
+				if (t < -3.0F) {red = t + 3.0F; green = -4.0F - t;}
+				else if (t < -2.0F) {green = t + 2.0F; blue = -3.0F - t;}
+				else if (t < -1.0F) {blue = t + 1.0F; alpha = -2.0F - t;}
+				else if (t < 0.0F) {alpha = t; red = t + 1.0F;}
+				else if (t < 1.0F) {red = 1.0F - t; green = t;}
+				else if (t < 2.0F) {green = 2.0F - t; blue = t - 1.0F;}
+				else if (t < 3.0F) {blue = 3.0F - t; alpha = t - 2.0F;}
+				else {alpha = 4.0F - t; red = 3.0F - t;}
+
+				texel->Set(red, green, blue, alpha);
+				texel++;
+			}
+		}
+	}
+}
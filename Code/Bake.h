@@ -0,0 +1,291 @@
+#ifndef Bake_h
+#define Bake_h
+
+
+#include "Base.h"
+
+
+namespace Framework
+{
+	enum
+	{
+		kHorizonAngleCount		= 32,		// Must be at least 16 and a power of 2.
+		kHorizonRadius			= 16,
+		kBakeBandHeight			= 32
+	};
+
+
+	enum
+	{
+		kMipmapFilterBox,
+		kMipmapFilterKaiser,
+		kMipmapFilterLanczos
+	};
+
+
+	enum
+	{
+		kBakeMapNormal			= 'NRML',
+		kBakeMapParallax		= 'PLAX',
+		kBakeMapHorizon			= 'HRZN',
+		kBakeMapAmbient			= 'AMBT'
+	};
+
+
+	// A HorizonOffset holds everything about one (i, j) offset inside the horizon search disk
+	// that does not depend on the texel being processed. The angular index range covers all
+	// directions subtended by the neighbor texel and may extend below zero or beyond the
+	// angle count, so it must be wrapped when it is applied.
+
+	struct HorizonOffset
+	{
+		int16		dx;
+		int16		dy;
+		int16		minIndex;
+		int16		maxIndex;
+		float		inverseRadius2;
+	};
+
+
+	// The HorizonOffsetTable class contains the list of offsets that are examined for each texel
+	// by the horizon map baker. A table is built once for each combination of search radius and
+	// angle count, and it is shared by all subsequent bakes using the same configuration. Get() can
+	// be called from several threads at once.
+
+	class HorizonOffsetTable : public ListElement<HorizonOffsetTable>
+	{
+		private:
+
+			int32				horizonRadius;
+			int32				angleCount;
+
+			int32				offsetCount;
+			HorizonOffset		*offsetArray;
+
+			HorizonOffsetTable(int32 radius, int32 count);
+
+		public:
+
+			~HorizonOffsetTable();
+
+			int32 GetHorizonRadius(void) const
+			{
+				return (horizonRadius);
+			}
+
+			int32 GetAngleCount(void) const
+			{
+				return (angleCount);
+			}
+
+			int32 GetOffsetCount(void) const
+			{
+				return (offsetCount);
+			}
+
+			const HorizonOffset *GetOffsetArray(void) const
+			{
+				return (offsetArray);
+			}
+
+			static const HorizonOffsetTable *Get(int32 radius, int32 count);
+	};
+
+
+	// The HeightWindow class holds a ring of wrapped rows from the red channel of a height map.
+	// Each row is extended on both sides by the apron width so that neighbors can be addressed
+	// without wrapping, and the window stays small enough to remain in cache while a band of
+	// rows is processed.
+
+	class HeightWindow
+	{
+		private:
+
+			const Color4U		*heightMap;
+			int32				mapWidth;
+			int32				mapHeight;
+
+			int32				apronSize;
+			int32				rowCount;
+			int32				rowStride;
+
+			uint8				*windowStorage;
+
+			void LoadRow(int32 y);
+
+		public:
+
+			HeightWindow(const Color4U *map, int32 width, int32 height, int32 apron);
+			~HeightWindow();
+
+			int32 GetApronSize(void) const
+			{
+				return (apronSize);
+			}
+
+			const uint8 *GetRow(int32 y) const
+			{
+				return (windowStorage + ((y + rowCount) % rowCount) * rowStride + apronSize);
+			}
+
+			void BeginBand(int32 y);
+			void AdvanceRow(int32 y);
+	};
+
+
+	// The HeightPyramid class holds a chain of images in which each texel contains the maximum
+	// of the red channel over the corresponding 2x2 block of the next larger image.
+
+	class HeightPyramid
+	{
+		public:
+
+			enum
+			{
+				kMaxLevelCount = 32
+			};
+
+		private:
+
+			int32				levelCount;
+			int32				levelWidth[kMaxLevelCount];
+			int32				levelHeight[kMaxLevelCount];
+			const uint8			*levelData[kMaxLevelCount];
+
+			uint8				*pyramidStorage;
+
+		public:
+
+			HeightPyramid(const Color4U *heightMap, int32 width, int32 height);
+			~HeightPyramid();
+
+			int32 GetLevelCount(void) const
+			{
+				return (levelCount);
+			}
+
+			int32 GetLevelWidth(int32 level) const
+			{
+				return (levelWidth[level]);
+			}
+
+			int32 GetLevelHeight(int32 level) const
+			{
+				return (levelHeight[level]);
+			}
+
+			const uint8 *GetLevelData(int32 level) const
+			{
+				return (levelData[level]);
+			}
+	};
+
+
+	// The HorizonErrorReport structure summarizes the per-channel differences between an
+	// approximate horizon map and an exact one, measured in 8-bit units.
+
+	struct HorizonErrorReport
+	{
+		float		meanError;
+		float		rmsError;
+		int32		maxError;
+		float		overFraction;
+		float		underFraction;
+	};
+
+
+	// The SurfaceMapSet structure lists the maps produced by a single pass over a height map.
+	// Any map pointer may be nullptr if that map is not needed. The parallax scale multiplies
+	// the signed heights stored in the parallax map before they are clamped to [-1,1].
+
+	struct SurfaceMapSet
+	{
+		Color2S		*normalMap;
+		Color1S		*parallaxMap;
+		Color4U		*horizonMap;
+		Color1U		*ambientMap;
+		float		parallaxScale;
+		float		ambientPower;
+	};
+
+
+	// Bands of rows are distributed among threadCount threads. A thread count of zero uses one
+	// thread per processor. The output does not depend on the number of threads.
+
+	typedef void BakeBandFunction(int32 firstRow, int32 rowCount, void *cookie);
+
+	void ExecuteBakeBands(int32 height, BakeBandFunction *function, void *cookie, int32 threadCount);
+
+	void BakeNormalMap(const Color4U *heightMap, Color2S *normalMap, int32 width, int32 height, float scale, int32 threadCount = 0);
+	void BakeHorizonMap(const Color4U *heightMap, Color4U *horizonMap, int32 width, int32 height, float scale, int32 threadCount = 0, int32 radius = kHorizonRadius);
+
+	// The surface baker reads each row of the height map once and produces any combination of
+	// the normal, parallax, horizon, and ambient maps. The horizon is searched over kHorizonRadius.
+
+	void BakeSurfaceMaps(const Color4U *heightMap, const SurfaceMapSet *mapSet, int32 width, int32 height, float scale, int32 threadCount = 0);
+
+	// A rectangle of the surface maps can be rebaked after the height map changes. The footprint
+	// of a dirty rectangle includes every texel whose bake reads a height inside it, and it may
+	// extend past the edges of the map. GetWrappedRects() splits such a rectangle into at most
+	// four rectangles inside the map, which are the ones passed to RebakeSurfaceMaps().
+
+	void RebakeSurfaceMaps(const Color4U *heightMap, const SurfaceMapSet *mapSet, int32 width, int32 height, float scale, const Rect& rect, int32 threadCount = 0);
+	Rect GetSurfaceBakeFootprint(const SurfaceMapSet *mapSet, const Rect& dirtyRect);
+	int32 GetWrappedRects(const Rect& rect, int32 width, int32 height, Rect *wrappedRect);
+
+	// The sweep baker finds the horizon in each direction by walking parallel lines of texels
+	// across the height map while keeping the convex hulls of the heights already passed, so its
+	// cost grows only with the logarithm of the search radius. Lines are swept at several angles
+	// around each direction, and texels near the center are searched exactly, to approximate the
+	// angular coverage of the brute-force baker above, which remains the reference.
+
+	void BakeHorizonMapSweep(const Color4U *heightMap, Color4U *horizonMap, int32 width, int32 height, float scale, int32 radius, int32 threadCount = 0);
+
+	// The pyramid baker searches the kHorizonRadius neighborhood exactly and covers the rest of
+	// the radius with cells from a max-height pyramid. Each cell is applied at the distance of
+	// the nearest texel it could contain to every angle that texel could cover, so no channel of
+	// the result is lower than the brute-force baker would produce with the same radius. Cells
+	// are no larger than errorBound times their distance, and the bound is limited to one half.
+	// Smaller bounds overestimate less and are slower, and a bound of zero gives exact results.
+
+	void BakeHorizonMapPyramid(const Color4U *heightMap, Color4U *horizonMap, int32 width, int32 height, float scale, int32 radius, float errorBound, int32 threadCount = 0);
+
+	// The cone map holds the ratio of radius to height of the widest cone standing on each texel
+	// that contains no higher part of the height map, encoded as the square root of the ratio
+	// clamped to one. A parallax shader may step along a ray by the distance to the cone. The
+	// map is searched through a height pyramid, so its dimensions must be powers of two.
+
+	void BakeConeMap(const Color4U *heightMap, Color1U *coneMap, int32 width, int32 height, int32 threadCount = 0);
+
+	// Gamma mipmaps are generated for images in the sRGB color space. Colors are converted to linear
+	// intensities, filtered with one of the kMipmapFilter kernels, and converted back to sRGB, while
+	// alpha is filtered without conversion. Images are treated as repeating at the edges.
+
+	int32 GenerateGammaMipmapImages(const Integer3D& size, const Color4U *source, Color4U **image, int32 filter, int32 threadCount = 0);
+	int32 BuildGammaMipmapImages(const Integer3D& size, Color4U *image, int32 filter, int32 threadCount = 0);
+
+	void CompareHorizonMaps(const Color4U *exactMap, const Color4U *horizonMap, int32 width, int32 height, HorizonErrorReport *report);
+	void OutputHorizonErrorReport(const char *name, const HorizonErrorReport *report);
+
+	// The horizon cube holds 16x16 texels on each of its six faces, stored one face after another.
+	// Each texel holds the weights with which the channels of a horizon map are blended for the
+	// tangent-space direction passing through it.
+
+	void GenerateHorizonCube(Color4U *texel);
+
+
+	// Finished mipmap chains are cached on disk under a key calculated from the source pixels,
+	// the map type, and every parameter that affects the baked result. A cached chain is returned
+	// only if it has exactly the size of a full chain for the given dimensions and pixel size, and
+	// it must be released with ReleaseMipmapImages(). The cache is only kept on Windows, and
+	// LoadBakeCache() always returns nullptr elsewhere.
+
+	uint64 CalculateBakeCacheKey(const Color4U *heightMap, int32 width, int32 height, uint32 mapType, float scale);
+	uint64 CalculateBakeChecksum(const void *data, uint32 size);
+
+	void *LoadBakeCache(uint64 key, const Integer3D& size, uint32 pixelSize, int32 *mipmapCount);
+	void StoreBakeCache(uint64 key, int32 mipmapCount, const void *image, uint32 imageSize);
+}
+
+
+#endif
@@ -1,49 +1,419 @@
-#include "OpenGEX.h"
+#include "Base.h"
+
+#if !defined(_WIN32)
+
+	#include <fcntl.h>
+	#include <sched.h>
+	#include <stdio.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <time.h>
+	#include <unistd.h>
+
+#endif
 
 
 using namespace Framework;
 
 
+FileSource *Framework::fileSource = nullptr;
+
+
 File::File()
 {
 	storage = nullptr;
 	data = nullptr;
 	size = 0;
+	mappedFlag = false;
 }
 
-File::File(const char *name)
+File::File(const char *name, uint32 flags)
 {
 	storage = nullptr;
-	Load(name);
+	data = nullptr;
+	mappedFlag = false;
+	Load(name, flags);
 }
 
 File::~File()
 {
-	delete[] storage;
+	Unload();
 }
 
-void File::Load(const char *name)
+void File::Unload(void)
 {
-	LARGE_INTEGER	fileSize;
+	if (mappedFlag)
+	{
+		#if defined(_WIN32)
+
+			UnmapViewOfFile(data);
+
+		#else
+
+			munmap(data, size);
+
+		#endif
+
+		mappedFlag = false;
+	}
+
+	delete[] storage;
+	storage = nullptr;
+	data = nullptr;
+}
+
+#if defined(_WIN32)
+
+	bool File::Load(const char *name, uint32 flags)
+	{
+		LARGE_INTEGER	fileSize;
+
+		Unload();
+
+		if (fileSource)
+		{
+			if (fileSource->LoadFile(name, this))
+			{
+				return (true);
+			}
+
+			Unload();
+		}
+
+		HANDLE fileHandle = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+		{
+			size = 0;
+			return (false);
+		}
+
+		GetFileSizeEx(fileHandle, &fileSize);
+		size = fileSize.QuadPart;
+
+		if ((flags & kFileMapped) && (size != 0))
+		{
+			SYSTEM_INFO		systemInfo;
+
+			// A view always begins on an allocation granularity boundary, which satisfies the
+			// 64-byte alignment, and the rest of its last page reads as zero. If the file ends
+			// exactly on a page boundary, there is no room for the terminator.
+
+			GetSystemInfo(&systemInfo);
+			if ((size & (systemInfo.dwPageSize - 1)) != 0)
+			{
+				HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mappingHandle)
+				{
+					data = static_cast<char *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+
+					// The view keeps the mapping and the file open after their handles are closed.
+
+					CloseHandle(mappingHandle);
+					if (data)
+					{
+						CloseHandle(fileHandle);
+						mappedFlag = true;
+						return (true);
+					}
+				}
+			}
+		}
+
+		DWORD	actual;
+
+		AllocateStorage(size);
+		ReadFile(fileHandle, data, DWORD(size), &actual, nullptr);
+		CloseHandle(fileHandle);
+
+		return (true);
+	}
+
+#else
+
+	bool File::Load(const char *name, uint32 flags)
+	{
+		struct stat		status;
+
+		Unload();
+
+		if (fileSource)
+		{
+			if (fileSource->LoadFile(name, this))
+			{
+				return (true);
+			}
+
+			Unload();
+		}
+
+		int fileDescriptor = open(name, O_RDONLY);
+		if (fileDescriptor < 0)
+		{
+			size = 0;
+			return (false);
+		}
+
+		fstat(fileDescriptor, &status);
+		size = status.st_size;
+
+		// A mapping begins on a page boundary, and the rest of its last page reads as zero,
+		// so the same rules apply as on Windows.
+
+		if ((flags & kFileMapped) && (size != 0) && ((size & (sysconf(_SC_PAGESIZE) - 1)) != 0))
+		{
+			void *view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+			if (view != MAP_FAILED)
+			{
+				close(fileDescriptor);
+				data = static_cast<char *>(view);
+				mappedFlag = true;
+				return (true);
+			}
+		}
+
+		AllocateStorage(size);
+
+		uint64 offset = 0;
+		while (offset < size)
+		{
+			ssize_t actual = read(fileDescriptor, data + offset, size - offset);
+			if (actual <= 0)
+			{
+				break;
+			}
 
-	HANDLE fileHandle = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-	GetFileSizeEx(fileHandle, &fileSize);
-	size = fileSize.QuadPart;
+			offset += actual;
+		}
+
+		close(fileDescriptor);
+		return (true);
+	}
+
+#endif
 
+char *File::AllocateStorage(uint64 fileSize)
+{
 	// Allocate enough space for the file contents plus another 63 bytes of padding
 	// that might be needed to align the data on a 64-byte boundary, plus one byte for a terminator.
 
+	size = fileSize;
 	storage = new char[size + 64];
 	data = storage + (-reinterpret_cast<int64>(storage) & 0x3F);
 
-	DWORD	actual;
-
-	ReadFile(fileHandle, data, DWORD(size), &actual, nullptr);
-	CloseHandle(fileHandle);
-
 	data[size] = 0;
+	return (data);
 }
 
+#if defined(_WIN32)
+
+	Thread::Thread(ThreadFunction *function, void *cookie)
+	{
+		threadFunction = function;
+		threadCookie = cookie;
+		threadHandle = CreateThread(nullptr, 0, &ThreadEntry, this, 0, nullptr);
+	}
+
+	Thread::~Thread()
+	{
+		WaitForSingleObject(threadHandle, INFINITE);
+		CloseHandle(threadHandle);
+	}
+
+	DWORD WINAPI Thread::ThreadEntry(void *thread)
+	{
+		const Thread *self = static_cast<Thread *>(thread);
+		(*self->threadFunction)(self->threadCookie);
+		return (0);
+	}
+
+	Mutex::Mutex()
+	{
+		InitializeCriticalSection(&criticalSection);
+	}
+
+	Mutex::~Mutex()
+	{
+		DeleteCriticalSection(&criticalSection);
+	}
+
+	void Mutex::Acquire(void)
+	{
+		EnterCriticalSection(&criticalSection);
+	}
+
+	void Mutex::Release(void)
+	{
+		LeaveCriticalSection(&criticalSection);
+	}
+
+	Condition::Condition()
+	{
+		InitializeConditionVariable(&conditionVariable);
+	}
+
+	Condition::~Condition()
+	{
+	}
+
+	void Condition::Wait(Mutex *mutex)
+	{
+		SleepConditionVariableCS(&conditionVariable, &mutex->criticalSection, INFINITE);
+	}
+
+	void Condition::Wake(void)
+	{
+		WakeConditionVariable(&conditionVariable);
+	}
+
+	void Condition::WakeAll(void)
+	{
+		WakeAllConditionVariable(&conditionVariable);
+	}
+
+	int32 Framework::GetProcessorCount(void)
+	{
+		SYSTEM_INFO		systemInfo;
+
+		GetSystemInfo(&systemInfo);
+		return (Max(int32(systemInfo.dwNumberOfProcessors), 1));
+	}
+
+	int64 Framework::GetMicrosecondTime(void)
+	{
+		LARGE_INTEGER	counter, frequency;
+
+		// The whole seconds and the remainder are converted separately so that the product
+		// cannot overflow.
+
+		QueryPerformanceCounter(&counter);
+		QueryPerformanceFrequency(&frequency);
+		int64 seconds = counter.QuadPart / frequency.QuadPart;
+		int64 remainder = counter.QuadPart - seconds * frequency.QuadPart;
+		return (seconds * 1000000 + remainder * 1000000 / frequency.QuadPart);
+	}
+
+	void Framework::YieldThread(void)
+	{
+		Sleep(0);
+	}
+
+	int32 Framework::AtomicIncrement(volatile int32 *value)
+	{
+		return (int32(InterlockedIncrement(reinterpret_cast<volatile long *>(value))));
+	}
+
+	int32 Framework::AtomicCompareExchange(volatile int32 *value, int32 exchange, int32 comparand)
+	{
+		return (int32(InterlockedCompareExchange(reinterpret_cast<volatile long *>(value), exchange, comparand)));
+	}
+
+	void Framework::OutputDebugText(const char *text)
+	{
+		OutputDebugStringA(text);
+	}
+
+#else
+
+	Thread::Thread(ThreadFunction *function, void *cookie)
+	{
+		threadFunction = function;
+		threadCookie = cookie;
+		pthread_create(&threadHandle, nullptr, &ThreadEntry, this);
+	}
+
+	Thread::~Thread()
+	{
+		pthread_join(threadHandle, nullptr);
+	}
+
+	void *Thread::ThreadEntry(void *thread)
+	{
+		const Thread *self = static_cast<Thread *>(thread);
+		(*self->threadFunction)(self->threadCookie);
+		return (nullptr);
+	}
+
+	Mutex::Mutex()
+	{
+		pthread_mutex_init(&mutex, nullptr);
+	}
+
+	Mutex::~Mutex()
+	{
+		pthread_mutex_destroy(&mutex);
+	}
+
+	void Mutex::Acquire(void)
+	{
+		pthread_mutex_lock(&mutex);
+	}
+
+	void Mutex::Release(void)
+	{
+		pthread_mutex_unlock(&mutex);
+	}
+
+	Condition::Condition()
+	{
+		pthread_cond_init(&condition, nullptr);
+	}
+
+	Condition::~Condition()
+	{
+		pthread_cond_destroy(&condition);
+	}
+
+	void Condition::Wait(Mutex *mutex)
+	{
+		pthread_cond_wait(&condition, &mutex->mutex);
+	}
+
+	void Condition::Wake(void)
+	{
+		pthread_cond_signal(&condition);
+	}
+
+	void Condition::WakeAll(void)
+	{
+		pthread_cond_broadcast(&condition);
+	}
+
+	int32 Framework::GetProcessorCount(void)
+	{
+		return (Max(int32(sysconf(_SC_NPROCESSORS_ONLN)), 1));
+	}
+
+	int64 Framework::GetMicrosecondTime(void)
+	{
+		timespec	time;
+
+		clock_gettime(CLOCK_MONOTONIC, &time);
+		return (int64(time.tv_sec) * 1000000 + time.tv_nsec / 1000);
+	}
+
+	void Framework::YieldThread(void)
+	{
+		sched_yield();
+	}
+
+	int32 Framework::AtomicIncrement(volatile int32 *value)
+	{
+		return (__atomic_add_fetch(value, 1, __ATOMIC_ACQ_REL));
+	}
+
+	int32 Framework::AtomicCompareExchange(volatile int32 *value, int32 exchange, int32 comparand)
+	{
+		__atomic_compare_exchange_n(value, &comparand, exchange, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+		return (comparand);
+	}
+
+	void Framework::OutputDebugText(const char *text)
+	{
+		fputs(text, stderr);
+	}
+
+#endif
+
 
 namespace
 {
@@ -71,21 +441,51 @@ namespace
 	};
 
 
-	void CopyTarga_L8(const uint8 *data, Color4U *image, int32 pixelCount)
+	typedef const uint8 *ConvertTargaFunction(const uint8 *data, Color4U *image, int32 count);
+
+
+	inline const uint8 *ConvertTarga_L8(const uint8 *data, Color4U *image, int32 count)
 	{
-		for (int32 a = 0; a < pixelCount; a++)
+		#if defined(TERATHON_SSE)
+
+			// Expand sixteen luminance values at a time into gray texels with full alpha.
+
+			const __m128i alpha = _mm_set1_epi32(int32(0xFF000000));
+
+			for (; count >= 16; count -= 16)
+			{
+				__m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+				__m128i l2lo = _mm_unpacklo_epi8(l, l);
+				__m128i l2hi = _mm_unpackhi_epi8(l, l);
+
+				__m128i *output = reinterpret_cast<__m128i *>(image);
+				_mm_storeu_si128(output, _mm_or_si128(_mm_unpacklo_epi16(l2lo, l2lo), alpha));
+				_mm_storeu_si128(output + 1, _mm_or_si128(_mm_unpackhi_epi16(l2lo, l2lo), alpha));
+				_mm_storeu_si128(output + 2, _mm_or_si128(_mm_unpacklo_epi16(l2hi, l2hi), alpha));
+				_mm_storeu_si128(output + 3, _mm_or_si128(_mm_unpackhi_epi16(l2hi, l2hi), alpha));
+
+				data += 16;
+				image += 16;
+			}
+
+		#endif
+
+		for (; count > 0; count--)
 		{
 			uint32 value = data[0];
-			image[a].Set(value, value, value, 255);
+			image->Set(value, value, value, 255);
 			data++;
+			image++;
 		}
+
+		return (data);
 	}
 
-	void CopyTarga_RGB16(const uint8 *data, Color4U *image, int32 pixelCount)
+	inline const uint8 *ConvertTarga_RGB16(const uint8 *data, Color4U *image, int32 count)
 	{
-		for (int32 a = 0; a < pixelCount; a++)
+		for (; count > 0; count--)
 		{
-			uint32 p = *reinterpret_cast<const uint16 *>(data);
+			uint32 p = data[0] | (data[1] << 8);
 			uint32 red = p >> 10;
 			uint32 green = (p >> 5) & 31;
 			uint32 blue = p & 31;
@@ -94,179 +494,249 @@ namespace
 			green = (green << 3) | (green >> 2);
 			blue = (blue << 3) | (blue >> 2);
 
-			image[a].Set(red, green, blue, 255);
+			image->Set(red, green, blue, 255);
 			data += 2;
+			image++;
 		}
+
+		return (data);
 	}
 
-	void CopyTarga_RGB24(const uint8 *data, Color4U *image, int32 pixelCount)
+	#if defined(TERATHON_SSE)
+
+		inline __m128i SwapTargaRedBlue(const __m128i& bgra)
+		{
+			// Exchange the first and third bytes of each 32-bit texel.
+
+			const __m128i greenAlpha = _mm_set1_epi32(int32(0xFF00FF00));
+			const __m128i redBlue = _mm_set1_epi32(0x000000FF);
+
+			__m128i blue = _mm_slli_epi32(_mm_and_si128(bgra, redBlue), 16);
+			__m128i red = _mm_and_si128(_mm_srli_epi32(bgra, 16), redBlue);
+			return (_mm_or_si128(_mm_and_si128(bgra, greenAlpha), _mm_or_si128(red, blue)));
+		}
+
+	#endif
+
+	inline const uint8 *ConvertTarga_RGB24(const uint8 *data, Color4U *image, int32 count)
 	{
-		for (int32 a = 0; a < pixelCount; a++)
+		#if defined(TERATHON_SSE)
+
+			// Gather four 3-byte texels into 32-bit lanes. Each load reads 16 bytes to convert
+			// 12, so the loop stops while at least six texels remain to stay inside the data.
+
+			const __m128i alpha = _mm_set1_epi32(int32(0xFF000000));
+
+			for (; count >= 6; count -= 4)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+				__m128i ab = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+				__m128i cd = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+				__m128i bgr = _mm_unpacklo_epi64(ab, cd);
+
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(image), _mm_or_si128(SwapTargaRedBlue(bgr), alpha));
+
+				data += 12;
+				image += 4;
+			}
+
+		#endif
+
+		for (; count > 0; count--)
 		{
-			image[a].Set(data[2], data[1], data[0], 255);
+			image->Set(data[2], data[1], data[0], 255);
 			data += 3;
+			image++;
 		}
+
+		return (data);
 	}
 
-	void CopyTarga_RGBA32(const uint8 *data, Color4U *image, int32 pixelCount)
+	inline const uint8 *ConvertTarga_RGBA32(const uint8 *data, Color4U *image, int32 count)
 	{
-		for (int32 a = 0; a < pixelCount; a++)
+		#if defined(TERATHON_SSE)
+
+			for (; count >= 4; count -= 4)
+			{
+				__m128i bgra = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(image), SwapTargaRedBlue(bgra));
+
+				data += 16;
+				image += 4;
+			}
+
+		#endif
+
+		for (; count > 0; count--)
 		{
-			image[a].Set(data[2], data[1], data[0], data[3]);
+			image->Set(data[2], data[1], data[0], data[3]);
 			data += 4;
+			image++;
 		}
+
+		return (data);
 	}
 
-	void DecompressTarga_L8(const uint8 *data, Color4U *image, int32 pixelCount)
+	inline void FillTargaRun(Color4U color, Color4U *image, int32 count)
 	{
-		for (int32 a = 0; a < pixelCount;)
-		{
-			uint8 d = *data++;
-			int32 count = (d & 0x7F) + 1;
+		#if defined(TERATHON_SSE)
 
-			if ((d & 0x80) != 0)
+			__m128i c = _mm_set1_epi32(*reinterpret_cast<const int32 *>(&color));
+			for (; count >= 4; count -= 4)
 			{
-				Color4U		c;
-
-				uint32 value = data[0];
-				c.Set(value, value, value, 255);
-				do
-				{
-					image[a++] = c;
-				} while (--count > 0);
-
-				data++;
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(image), c);
+				image += 4;
 			}
-			else
-			{
-				do
-				{
-					uint32 value = data[0];
-					image[a++].Set(value, value, value, 255);
-					data++;
 
-				} while (--count > 0);
-			}
+		#endif
+
+		for (; count > 0; count--)
+		{
+			*image++ = color;
 		}
 	}
 
-	void DecompressTarga_RGB16(const uint8 *data, Color4U *image, int32 pixelCount)
+
+	class TargaRowWriter
 	{
-		for (int32 a = 0; a < pixelCount;)
-		{
-			uint8 d = *data++;
-			int32 count = (d & 0x7F) + 1;
+		private:
 
-			if ((d & 0x80) != 0)
-			{
-				Color4U		c;
+			int32		imageWidth;
+			int32		rowStep;
+			int32		rowCount;
 
-				uint32 p = data[0] | (data[1] << 8);
-				data += 2;
+			Color4U		*spanData;
+			Color4U		*rowEnd;
 
-				uint32 red = p >> 10;
-				uint32 green = (p >> 5) & 31;
-				uint32 blue = p & 31;
+		public:
 
-				red = (red << 3) | (red >> 2);
-				green = (green << 3) | (green >> 2);
-				blue = (blue << 3) | (blue >> 2);
+			// Rows are stored from the bottom of the image to the top. Files with the origin in
+			// the upper-left corner are written from the last row backward, so they never need to
+			// be flipped after decoding.
 
-				c.Set(red, green, blue, 255);
-				do
-				{
-					image[a++] = c;
-				} while (--count > 0);
-			}
-			else
+			TargaRowWriter(Color4U *image, int32 width, int32 height, bool flip)
 			{
-				do
-				{
-					uint32 p = data[0] | (data[1] << 8);
-					data += 2;
-
-					uint32 red = p >> 10;
-					uint32 green = (p >> 5) & 31;
-					uint32 blue = p & 31;
+				imageWidth = width;
+				rowStep = (flip) ? -width * 2 : 0;
+				rowCount = height;
 
-					red = (red << 3) | (red >> 2);
-					green = (green << 3) | (green >> 2);
-					blue = (blue << 3) | (blue >> 2);
-
-					image[a++].Set(red, green, blue, 255);
-				} while (--count > 0);
+				spanData = (flip) ? image + (height - 1) * width : image;
+				rowEnd = spanData + width;
 			}
-		}
-	}
 
-	void DecompressTarga_RGB24(const uint8 *data, Color4U *image, int32 pixelCount)
-	{
-		for (int32 a = 0; a < pixelCount;)
-		{
-			uint8 d = *data++;
-			int32 count = (d & 0x7F) + 1;
-
-			if ((d & 0x80) != 0)
+			bool Finished(void) const
 			{
-				Color4U		c;
+				return (rowCount <= 0);
+			}
 
-				c.Set(data[2], data[1], data[0], 255);
-				do
-				{
-					image[a++] = c;
-				} while (--count > 0);
+			// GetSpan() returns the number of texels that can be written before the end of the
+			// current row, and Advance() moves past texels that have been written.
 
-				data += 3;
+			int32 GetSpan(Color4U **span) const
+			{
+				*span = spanData;
+				return (int32(rowEnd - spanData));
 			}
-			else
+
+			void Advance(int32 count)
 			{
-				do
+				spanData += count;
+				if (spanData == rowEnd)
 				{
-					image[a++].Set(data[2], data[1], data[0], 255);
-					data += 3;
-
-				} while (--count > 0);
+					spanData += rowStep;
+					rowEnd = spanData + imageWidth;
+					rowCount--;
+				}
 			}
+	};
+
+
+	template <ConvertTargaFunction *convert>
+	void CopyTarga(const uint8 *data, TargaRowWriter *writer)
+	{
+		while (!writer->Finished())
+		{
+			Color4U		*span;
+
+			int32 count = writer->GetSpan(&span);
+			data = (*convert)(data, span, count);
+			writer->Advance(count);
 		}
 	}
 
-	void DecompressTarga_RGBA32(const uint8 *data, Color4U *image, int32 pixelCount)
+	template <ConvertTargaFunction *convert>
+	void DecompressTarga(const uint8 *data, TargaRowWriter *writer)
 	{
-		for (int32 a = 0; a < pixelCount;)
+		// Run packets convert their single texel once and fill it, and raw packets convert all
+		// of their texels at once. A packet is split where it crosses the end of a row.
+
+		while (!writer->Finished())
 		{
+			Color4U		*span;
+
 			uint8 d = *data++;
 			int32 count = (d & 0x7F) + 1;
 
 			if ((d & 0x80) != 0)
 			{
-				Color4U		c;
+				Color4U		color;
 
-				c.Set(data[2], data[1], data[0], data[3]);
-				do
+				data = (*convert)(data, &color, 1);
+				for (;;)
 				{
-					image[a++] = c;
-				} while (--count > 0);
+					int32 n = writer->GetSpan(&span);
+					if (count <= n)
+					{
+						FillTargaRun(color, span, count);
+						writer->Advance(count);
+						break;
+					}
+
+					FillTargaRun(color, span, n);
+					writer->Advance(n);
+					count -= n;
 
-				data += 4;
+					if (writer->Finished())
+					{
+						break;
+					}
+				}
 			}
 			else
 			{
-				do
+				for (;;)
 				{
-					image[a++].Set(data[2], data[1], data[0], data[3]);
-					data += 4;
+					int32 n = writer->GetSpan(&span);
+					if (count <= n)
+					{
+						data = (*convert)(data, span, count);
+						writer->Advance(count);
+						break;
+					}
 
-				} while (--count > 0);
+					data = (*convert)(data, span, n);
+					writer->Advance(n);
+					count -= n;
+
+					if (writer->Finished())
+					{
+						break;
+					}
+				}
 			}
 		}
 	}
 }
 
-bool Framework::ImportTargaImageFile(const char *name, Color4U **image, Integer2D *size)
-{
-	File file(name);
 
+bool Framework::GetTargaImageSize(const File& file, Integer2D *size)
+{
 	const TargaHeader *header = reinterpret_cast<const TargaHeader *>(file.GetData());
+	if ((!header) || (file.GetSize() < sizeof(TargaHeader)))
+	{
+		return (false);
+	}
+
 	int32 pixelDepth = header->pixelDepth;
 	int32 imageType = header->imageType;
 
@@ -275,70 +745,71 @@ bool Framework::ImportTargaImageFile(const char *name, Color4U **image, Integer2
 		return (false);
 	}
 
-	int32 width = header->width;
-	int32 height = header->height;
-	size->Set(width, height);
+	size->Set(header->width, header->height);
+	return (true);
+}
 
-	int32 pixelCount = width * height;
-	Color4U *pixel = new Color4U[pixelCount];
-	*image = pixel;
+void Framework::DecodeTargaImage(const File& file, Color4U *image)
+{
+	const TargaHeader *header = reinterpret_cast<const TargaHeader *>(file.GetData());
+	int32 pixelDepth = header->pixelDepth;
+
+	TargaRowWriter writer(image, header->width, header->height, ((header->imageDescriptor & 0x20) != 0));
 
 	const uint8 *data = header->GetPixelData();
-	if ((imageType & 8) == 0)
+	if ((header->imageType & 8) == 0)
 	{
 		if (pixelDepth == 8)
 		{
-			CopyTarga_L8(data, pixel, pixelCount);
+			CopyTarga<&ConvertTarga_L8>(data, &writer);
 		}
 		else if (pixelDepth == 16)
 		{
-			CopyTarga_RGB16(data, pixel, pixelCount);
+			CopyTarga<&ConvertTarga_RGB16>(data, &writer);
 		}
 		else if (pixelDepth == 24)
 		{
-			CopyTarga_RGB24(data, pixel, pixelCount);
+			CopyTarga<&ConvertTarga_RGB24>(data, &writer);
 		}
 		else
 		{
-			CopyTarga_RGBA32(data, pixel, pixelCount);
+			CopyTarga<&ConvertTarga_RGBA32>(data, &writer);
 		}
 	}
 	else
 	{
 		if (pixelDepth == 8)
 		{
-			DecompressTarga_L8(data, pixel, pixelCount);
+			DecompressTarga<&ConvertTarga_L8>(data, &writer);
 		}
 		else if (pixelDepth == 16)
 		{
-			DecompressTarga_RGB16(data, pixel, pixelCount);
+			DecompressTarga<&ConvertTarga_RGB16>(data, &writer);
 		}
 		else if (pixelDepth == 24)
 		{
-			DecompressTarga_RGB24(data, pixel, pixelCount);
+			DecompressTarga<&ConvertTarga_RGB24>(data, &writer);
 		}
 		else
 		{
-			DecompressTarga_RGBA32(data, pixel, pixelCount);
+			DecompressTarga<&ConvertTarga_RGBA32>(data, &writer);
 		}
 	}
+}
+
+bool Framework::ImportTargaImageFile(const char *name, Color4U **image, Integer2D *size)
+{
+	File file(name);
 
-	if ((header->imageDescriptor & 0x20) != 0)
+	if (!GetTargaImageSize(file, size))
 	{
-		int32 h = height >> 1;
-		for (int32 j = 0; j < h; j++)
-		{
-			Color4U *top = pixel + j * width;
-			Color4U *bottom = pixel + (height - j - 1) * width;
-			for (int32 i = 0; i < width; i++)
-			{
-				Color4U c = top[i];
-				top[i] = bottom[i];
-				bottom[i] = c;
-			}
-		}
+		return (false);
 	}
 
+	Color4U *pixel = new Color4U[size->x * size->y];
+	DecodeTargaImage(file, pixel);
+
+	*image = pixel;
 	return (true);
 }
 
@@ -376,261 +847,275 @@ namespace
 	}
 }
 
-int32 Framework::GenerateMipmapImages(const Integer3D& size, const Color4U *source, Color4U **image)
+namespace
 {
-	int32	mipmapCount;
+	template <typename pixelType, typename componentType>
+	void ReduceMipmapRect(const pixelType *input, const Integer2D& inputSize, pixelType *output, const Integer2D& outputSize, const Rect& rect)
+	{
+		// Each texel inside the rectangle of the output level is the rounded average of the 2x2
+		// block of texels beneath it in the input level. Where the input level is only one texel
+		// wide or high, the same texels are read twice, which averages the two texels of the
+		// block with identical rounding.
 
-	int32 pixelCount = CalculateMipmapChainPixelCount(size, &mipmapCount);
-	ColorRgba *pixelData = new ColorRgba[pixelCount];
-	ColorRgba *outputData = pixelData;
+		constexpr int32 kComponentCount = sizeof(pixelType) / sizeof(componentType);
 
-	const Color4U *inputData = source;
-	int32 layerPixelCount = size.x * size.y;
+		machine dx = (inputSize.x > 1) ? kComponentCount : 0;
+		machine dy = (inputSize.y > 1) ? inputSize.x * kComponentCount : 0;
 
-	for (int32 layer = 0; layer < size.z; layer++)
-	{
-		for (int32 k = 0; k < layerPixelCount; k++)
+		for (machine y = rect.min.y; y < rect.max.y; y++)
 		{
-			const Color4U& pixel = inputData[k];
-			outputData[k].Set(float(pixel.red) * (1.0F / 255.0F), float(pixel.green) * (1.0F / 255.0F), float(pixel.blue) * (1.0F / 255.0F), float(pixel.alpha) * (1.0F / 255.0F));
+			const componentType *row1 = reinterpret_cast<const componentType *>(input + y * 2 * inputSize.x);
+			const componentType *row2 = row1 + dy;
+			componentType *result = reinterpret_cast<componentType *>(output + y * outputSize.x);
+
+			for (machine x = rect.min.x; x < rect.max.x; x++)
+			{
+				const componentType *p = row1 + x * 2 * kComponentCount;
+				const componentType *q = row2 + x * 2 * kComponentCount;
+				componentType *r = result + x * kComponentCount;
+
+				for (machine k = 0; k < kComponentCount; k++)
+				{
+					int32 sum = int32(p[k]) + int32(p[k + dx]) + int32(q[k]) + int32(q[k + dx]);
+					r[k] = componentType((sum + 2) >> 2);
+				}
+			}
 		}
+	}
 
-		const ColorRgba *inputMipmap = outputData;
-		ColorRgba *outputMipmap = outputData + size.x * size.y * (size.z - layer);
 
-		Integer2D sourceSize(1, 1);
-		float multiplier = 1.0F;
+	template <typename pixelType, typename componentType>
+	void ReduceMipmapChain(const Integer3D& size, const pixelType *source, pixelType *image, const Rect& rect)
+	{
+		// Level 0 is copied from the source unless the source is level 0 itself, and each following
+		// level is reduced from the one before it, so only the texels covering the rectangle at
+		// each level are calculated.
 
-		Integer2D mipmapSize(size.x, size.y);
-		while ((mipmapSize.x != 1) || (mipmapSize.y != 1))
+		if (source != image)
 		{
-			if (mipmapSize.x != 1)
+			int32 layerPixelCount = size.x * size.y;
+			for (machine layer = 0; layer < size.z; layer++)
 			{
-				mipmapSize.x >>= 1;
-				sourceSize.x <<= 1;
-				multiplier *= 0.5F;
-			}
+				const pixelType *input = source + layer * layerPixelCount;
+				pixelType *output = image + layer * layerPixelCount;
 
-			if (mipmapSize.y != 1)
-			{
-				mipmapSize.y >>= 1;
-				sourceSize.y <<= 1;
-				multiplier *= 0.5F;
+				int32 count = rect.max.x - rect.min.x;
+				for (machine y = rect.min.y; y < rect.max.y; y++)
+				{
+					Terathon::CopyMemory(input + y * size.x + rect.min.x, output + y * size.x + rect.min.x, count * sizeof(pixelType));
+				}
 			}
+		}
 
-			outputMipmap += mipmapSize.x * mipmapSize.y * layer;
+		Integer2D inputSize(size.x, size.y);
+		Rect levelRect = rect;
 
-			for (machine y = 0; y < mipmapSize.y; y++)
-			{
-				const ColorRgba *input = inputMipmap + y * sourceSize.y * size.x;
-				ColorRgba *output = outputMipmap + y * mipmapSize.x;
+		pixelType *inputLevel = image;
+		while ((inputSize.x != 1) || (inputSize.y != 1))
+		{
+			Integer2D outputSize(Max(inputSize.x >> 1, 1), Max(inputSize.y >> 1, 1));
+			pixelType *outputLevel = inputLevel + inputSize.x * inputSize.y * size.z;
 
-				for (machine x = 0; x < mipmapSize.x; x++)
-				{
-					ColorRgba color(0.0F, 0.0F, 0.0F, 0.0F);
-					for (machine j = 0; j < sourceSize.y; j++)
-					{
-						int32 k = j * size.x + x * sourceSize.x;
-						for (machine i = 0; i < sourceSize.x; i++)
-						{
-							color += input[k + i];
-						}
-					}
+			levelRect.min.x >>= 1;
+			levelRect.min.y >>= 1;
+			levelRect.max.x = Min((levelRect.max.x + 1) >> 1, outputSize.x);
+			levelRect.max.y = Min((levelRect.max.y + 1) >> 1, outputSize.y);
 
-					output[x] = color * multiplier;
-				}
+			int32 inputLayerSize = inputSize.x * inputSize.y;
+			int32 outputLayerSize = outputSize.x * outputSize.y;
+			for (machine layer = 0; layer < size.z; layer++)
+			{
+				ReduceMipmapRect<pixelType, componentType>(inputLevel + layer * inputLayerSize, inputSize, outputLevel + layer * outputLayerSize, outputSize, levelRect);
 			}
 
-			outputMipmap += mipmapSize.x * mipmapSize.y * (size.z - layer);
+			inputLevel = outputLevel;
+			inputSize = outputSize;
 		}
-
-		inputData += size.x * size.y;
-		outputData += size.x * size.y;
 	}
 
-	Color4U *colorData = new Color4U[pixelCount];
-	for (int32 k = 0; k < pixelCount; k++)
+
+	template <typename pixelType, typename componentType>
+	int32 GenerateMipmapChain(const Integer3D& size, const pixelType *source, pixelType **image)
 	{
-		colorData[k] = pixelData[k];
+		int32	mipmapCount;
+
+		int32 pixelCount = CalculateMipmapChainPixelCount(size, &mipmapCount);
+		pixelType *pixelData = new pixelType[pixelCount];
+
+		ReduceMipmapChain<pixelType, componentType>(size, source, pixelData, Rect(0, 0, size.x, size.y));
+
+		*image = pixelData;
+		return (mipmapCount);
 	}
+}
 
-	delete[] pixelData;
 
-	*image = colorData;
-	return (mipmapCount);
+int32 Framework::GenerateMipmapImages(const Integer3D& size, const Color4U *source, Color4U **image)
+{
+	return (GenerateMipmapChain<Color4U, uint8>(size, source, image));
 }
 
 int32 Framework::GenerateMipmapImages(const Integer3D& size, const Color2S *source, Color2S **image)
+{
+	return (GenerateMipmapChain<Color2S, int8>(size, source, image));
+}
+
+int32 Framework::GenerateMipmapImages(const Integer3D& size, const Color1S *source, Color1S **image)
+{
+	return (GenerateMipmapChain<Color1S, int8>(size, source, image));
+}
+
+int32 Framework::BuildMipmapImages(const Integer3D& size, Color4U *image)
 {
 	int32	mipmapCount;
 
-	int32 pixelCount = CalculateMipmapChainPixelCount(size, &mipmapCount);
-	Vector2D *pixelData = new Vector2D[pixelCount];
-	Vector2D *outputData = pixelData;
+	CalculateMipmapChainPixelCount(size, &mipmapCount);
+	ReduceMipmapChain<Color4U, uint8>(size, image, image, Rect(0, 0, size.x, size.y));
+	return (mipmapCount);
+}
 
-	const Color2S *inputData = source;
-	int32 layerPixelCount = size.x * size.y;
+void Framework::ReleaseMipmapImages(void *image)
+{
+	delete[] image;
+}
 
-	for (int32 layer = 0; layer < size.z; layer++)
-	{
-		for (int32 k = 0; k < layerPixelCount; k++)
-		{
-			const Color2S& pixel = inputData[k];
-			outputData[k].Set(float(pixel.red) * (1.0F / 127.0F), float(pixel.green) * (1.0F / 127.0F));
-		}
+void Framework::UpdateMipmapImages(const Integer3D& size, const Color4U *source, Color4U *image, const Rect& rect)
+{
+	ReduceMipmapChain<Color4U, uint8>(size, source, image, rect);
+}
 
-		const Vector2D *inputMipmap = outputData;
-		Vector2D *outputMipmap = outputData + size.x * size.y * (size.z - layer);
+void Framework::UpdateMipmapImages(const Integer3D& size, const Color2S *source, Color2S *image, const Rect& rect)
+{
+	ReduceMipmapChain<Color2S, int8>(size, source, image, rect);
+}
 
-		Integer2D sourceSize(1, 1);
-		float multiplier = 1.0F;
+void Framework::UpdateMipmapImages(const Integer3D& size, const Color1S *source, Color1S *image, const Rect& rect)
+{
+	ReduceMipmapChain<Color1S, int8>(size, source, image, rect);
+}
 
-		Integer2D mipmapSize(size.x, size.y);
-		while ((mipmapSize.x != 1) || (mipmapSize.y != 1))
-		{
-			if (mipmapSize.x != 1)
-			{
-				mipmapSize.x >>= 1;
-				sourceSize.x <<= 1;
-				multiplier *= 0.5F;
-			}
+uint32 Framework::CalculateMipmapImageSize(const Integer3D& size, uint32 pixelSize)
+{
+	int32	mipmapCount;
 
-			if (mipmapSize.y != 1)
-			{
-				mipmapSize.y >>= 1;
-				sourceSize.y <<= 1;
-				multiplier *= 0.5F;
-			}
+	return (CalculateMipmapChainPixelCount(size, &mipmapCount) * pixelSize);
+}
 
-			outputMipmap += mipmapSize.x * mipmapSize.y * layer;
 
-			for (machine y = 0; y < mipmapSize.y; y++)
-			{
-				const Vector2D *input = inputMipmap + y * sourceSize.y * size.x;
-				Vector2D *output = outputMipmap + y * mipmapSize.x;
+namespace
+{
+	// For the compressed formats, the size table holds the number of bytes in a 4x4 block.
 
-				for (machine x = 0; x < mipmapSize.x; x++)
-				{
-					Vector2D color(0.0F, 0.0F);
-					for (machine j = 0; j < sourceSize.y; j++)
-					{
-						int32 k = j * size.x + x * sourceSize.x;
-						for (machine i = 0; i < sourceSize.x; i++)
-						{
-							color += input[k + i];
-						}
-					}
+	const int8 sizeTable[TextureLayout::kFormatCount] =
+	{
+		4, 4, 4, 2, 2, 1, 1, 8, 8, 4,
+		8, 16, 8, 8, 16, 16
+	};
 
-					output[x] = color * multiplier;
-				}
-			}
 
-			outputMipmap += mipmapSize.x * mipmapSize.y * (size.z - layer);
+	uint64 CalculateLayerSize64(int32 format, int32 width, int32 height)
+	{
+		if (TextureLayout::CompressedFormat(format))
+		{
+			return (uint64((width + 3) >> 2) * uint64((height + 3) >> 2) * sizeTable[format]);
 		}
 
-		inputData += size.x * size.y;
-		outputData += size.x * size.y;
+		return (uint64(width) * uint64(height) * sizeTable[format]);
 	}
+}
 
-	Color2S *colorData = new Color2S[pixelCount];
-	for (int32 k = 0; k < pixelCount; k++)
-	{
-		colorData[k].Set(int32(pixelData[k].x * 127.0F), int32(pixelData[k].y * 127.0F));
-	}
 
-	delete[] pixelData;
+uint32 TextureLayout::GetFormatSize(int32 format)
+{
+	return (sizeTable[format]);
+}
 
-	*image = colorData;
-	return (mipmapCount);
+uint32 TextureLayout::CalculateLayerSize(int32 format, int32 width, int32 height)
+{
+	return (uint32(CalculateLayerSize64(format, width, height)));
 }
 
-int32 Framework::GenerateMipmapImages(const Integer3D& size, const Color1S *source, Color1S **image)
+uint32 TextureLayout::CalculateImageSize(int32 type, int32 format, int32 width, int32 height, int32 depth, int32 mipmapCount)
 {
-	int32	mipmapCount;
+	// Return the number of bytes occupied by an image passed to the Texture constructor, which
+	// holds the mipmaps in the order the constructor uploads them. Compressed mipmaps occupy
+	// whole blocks even when they are smaller than a block.
 
-	int32 pixelCount = CalculateMipmapChainPixelCount(size, &mipmapCount);
-	float *pixelData = new float[pixelCount];
-	float *outputData = pixelData;
+	// The size is accumulated in 64 bits so that dimensions read from a file can't wrap it
+	// around. Zero is returned if the dimensions, format, or mipmap count are invalid or if the
+	// image would not fit in 32 bits.
 
-	const Color1S *inputData = source;
-	int32 layerPixelCount = size.x * size.y;
+	if ((width <= 0) || (height <= 0) || (depth <= 0) || (mipmapCount <= 0) || (uint32(format) >= kFormatCount))
+	{
+		return (0);
+	}
 
-	for (int32 layer = 0; layer < size.z; layer++)
+	int32 levelCount = 1;
+	for (int32 s = Max(Max(width, height), (type == kType3D) ? depth : 1); s > 1; s >>= 1)
 	{
-		for (int32 k = 0; k < layerPixelCount; k++)
-		{
-			const Color1S& pixel = inputData[k];
-			outputData[k] = float(pixel) * (1.0F / 127.0F);
-		}
+		levelCount++;
+	}
+
+	if (mipmapCount > levelCount)
+	{
+		return (0);
+	}
 
-		const float *inputMipmap = outputData;
-		float *outputMipmap = outputData + size.x * size.y * (size.z - layer);
+	uint64 imageSize = 0;
 
-		Integer2D sourceSize(1, 1);
-		float multiplier = 1.0F;
+	switch (type)
+	{
+		case kType2D:
 
-		Integer2D mipmapSize(size.x, size.y);
-		while ((mipmapSize.x != 1) || (mipmapSize.y != 1))
-		{
-			if (mipmapSize.x != 1)
+			for (int32 mipmap = 0; mipmap < mipmapCount; mipmap++)
 			{
-				mipmapSize.x >>= 1;
-				sourceSize.x <<= 1;
-				multiplier *= 0.5F;
+				imageSize += CalculateLayerSize64(format, width, height);
+				width = Max(width >> 1, 1);
+				height = Max(height >> 1, 1);
 			}
 
-			if (mipmapSize.y != 1)
+			break;
+
+		case kType2DArray:
+
+			for (int32 mipmap = 0; mipmap < mipmapCount; mipmap++)
 			{
-				mipmapSize.y >>= 1;
-				sourceSize.y <<= 1;
-				multiplier *= 0.5F;
+				imageSize += CalculateLayerSize64(format, width, height) * depth;
+				width = Max(width >> 1, 1);
+				height = Max(height >> 1, 1);
 			}
 
-			outputMipmap += mipmapSize.x * mipmapSize.y * layer;
+			break;
+
+		case kType3D:
 
-			for (machine y = 0; y < mipmapSize.y; y++)
+			for (int32 mipmap = 0; mipmap < mipmapCount; mipmap++)
 			{
-				const float *input = inputMipmap + y * sourceSize.y * size.x;
-				float *output = outputMipmap + y * mipmapSize.x;
+				imageSize += CalculateLayerSize64(format, width, height) * depth;
+				width = Max(width >> 1, 1);
+				height = Max(height >> 1, 1);
+				depth = Max(depth >> 1, 1);
+			}
 
-				for (machine x = 0; x < mipmapSize.x; x++)
-				{
-					float color = 0.0F;
-					for (machine j = 0; j < sourceSize.y; j++)
-					{
-						int32 k = j * size.x + x * sourceSize.x;
-						for (machine i = 0; i < sourceSize.x; i++)
-						{
-							color += input[k + i];
-						}
-					}
+			break;
 
-					output[x] = color * multiplier;
-				}
+		case kTypeCube:
+
+			for (int32 mipmap = 0; mipmap < mipmapCount; mipmap++)
+			{
+				imageSize += CalculateLayerSize64(format, width, width) * 6;
+				width = Max(width >> 1, 1);
 			}
 
-			outputMipmap += mipmapSize.x * mipmapSize.y * (size.z - layer);
-		}
+			break;
 
-		inputData += size.x * size.y;
-		outputData += size.x * size.y;
-	}
+		case kTypeRectangle:
 
-	Color1S *colorData = new Color1S[pixelCount];
-	for (int32 k = 0; k < pixelCount; k++)
-	{
-		colorData[k] = int8(pixelData[k] * 127.0F);
+			imageSize = CalculateLayerSize64(format, width, height);
+			break;
 	}
 
-	delete[] pixelData;
-
-	*image = colorData;
-	return (mipmapCount);
-}
-
-void Framework::ReleaseMipmapImages(void *image)
-{
-	delete[] image;
+	return ((imageSize <= 0xFFFFFFFFULL) ? uint32(imageSize) : 0);
 }
 
 
@@ -649,11 +1134,20 @@ namespace
 
 RandomState::RandomState()
 {
-	SYSTEMTIME			time;
+	#if defined(_WIN32)
+
+		SYSTEMTIME			time;
+
+		uint32 a = GetTickCount();
+		GetSystemTime(&time);
+		uint32 b = (time.wMinute << 16) | time.wSecond;
+
+	#else
+
+		uint32 a = uint32(GetMicrosecondTime() / 1000);
+		uint32 b = uint32(time(nullptr));
 
-	uint32 a = GetTickCount();
-	GetSystemTime(&time);
-	uint32 b = (time.wMinute << 16) | time.wSecond;
+	#endif
 
 	n[0] = a;
 	n[1] = ~a;
@@ -4,6 +4,23 @@
 
 #define USE_FULL_SCREEN		0
 #define USE_RAW_INPUT		1
+#define HORIZON_BAKE_MODE		0		// 0 = brute-force reference, 1 = sweep, 2 = max-height pyramid.
+#define HORIZON_SEARCH_RADIUS	64		// Used by the sweep and pyramid modes. The brute-force mode always searches kHorizonRadius.
+#define HORIZON_PYRAMID_ERROR	0.25F
+#define REPORT_HORIZON_ERROR	0		// Nonzero compares other modes against the brute-force bake.
+#define BAKE_THREAD_COUNT	0		// Zero bakes textures with one thread per processor.
+#define USE_BAKE_CACHE		1
+#define BAKE_CACHE_DIRECTORY	"Cache"
+#define USE_GAMMA_MIPMAPS		1
+#define GAMMA_MIPMAP_FILTER		kMipmapFilterKaiser		// kMipmapFilterBox, kMipmapFilterKaiser, or kMipmapFilterLanczos.
+#define COOK_TEXTURES		0		// Nonzero writes a cooked file for every world texture and exits.
+#define COMPRESS_TEXTURES	1		// Nonzero stores world textures in the BC formats.
+#define UPLOAD_FRAME_BUDGET	0x400000		// Bytes of texture images uploaded per frame. Zero uploads textures when they are created.
+#define UPLOAD_RING_SIZE	0x1000000
+#define LOADER_THREAD_COUNT	2		// Number of threads reading files for the FileLoader.
+#define BUILD_ASSET_PACK	0		// Nonzero writes every asset into the pack file and exits.
+#define ASSET_PACK_MODE		2		// 0 = separate files, 1 = pack read through its file handle, 2 = pack mapped into memory.
+#define ASSET_PACK_NAME		"Assets.pack"
 
 
 #if defined(_MSC_VER)
@@ -13,24 +30,34 @@
 #endif
 
 
-#define WIN32_LEAN_AND_MEAN
+#if defined(_WIN32)
 
-#include <windows.h>
-#include <gl/gl.h>
-#include <math.h>
+	#define WIN32_LEAN_AND_MEAN
+
+	#include <windows.h>
+
+	#undef near
+	#undef far
+
+#else
 
-#undef near
-#undef far
+	#include <pthread.h>
+
+#endif
+
+#include <math.h>
 
 #include "TSString.h"
 #include "TSInteger.h"
 #include "TSColor.h"
 #include "TSArray.h"
 #include "TSList.h"
+#include "TSHash.h"
 #include "TSTree.h"
 #include "TSMatrix4D.h"
 #include "TSQuaternion.h"
 #include "TSTools.h"
+#include "TSRect.h"
 #include "TSOpenDDL.h"
 #include "SLSlug.h"
 
@@ -56,22 +83,48 @@ namespace Framework
 
 
 	// Define a really basic class for loading files.
+	//
+	// A file loaded with kFileMapped is mapped into memory read-only instead of being copied
+	// into storage on the heap, so large files are not duplicated and the pages are shared with
+	// other processes reading the same file. The data is still aligned on a 64-byte boundary and
+	// followed by a zero terminator. The terminator comes from the zero fill at the end of the
+	// last page, so a file whose size is a multiple of the page size is copied instead, as is a
+	// file that cannot be mapped. Load() returns false if the file cannot be opened, in which case
+	// GetData() returns nullptr. If a FileSource is installed and contains the name, the file is
+	// loaded from the source instead.
+
+	enum
+	{
+		kFileMapped		= 1 << 0
+	};
 
 	class File
 	{
+		friend class AssetPack;
+
 		private:
 
 			char		*storage;
 			char		*data;
 			uint64		size;
 
+			bool		mappedFlag;
+
+			void Unload(void);
+			char *AllocateStorage(uint64 fileSize);
+
 		public:
 
 			File();
-			File(const char *name);
+			File(const char *name, uint32 flags = 0);
 			~File();
 
-			void Load(const char *name);
+			bool Load(const char *name, uint32 flags = 0);
+
+			bool GetMappedFlag(void) const
+			{
+				return (mappedFlag);
+			}
 
 			const char *GetData(void) const
 			{
@@ -85,14 +138,224 @@ namespace Framework
 	};
 
 
+	// A FileSource supplies the contents of files by name in place of the file system. While a
+	// source is installed in the global fileSource pointer, File::Load() looks up every name in it
+	// before trying to open a separate file.
+
+	class FileSource
+	{
+		public:
+
+			virtual ~FileSource() {}
+
+			virtual bool LoadFile(const char *name, File *file) const = 0;
+	};
+
+
+	extern FileSource *fileSource;
+
+
+	// Define a minimal class for running a function on its own thread.
+	// The destructor waits for the function to return.
+
+	class Thread
+	{
+		public:
+
+			typedef void ThreadFunction(void *);
+
+		private:
+
+			#if defined(_WIN32)
+
+				HANDLE				threadHandle;
+
+			#else
+
+				pthread_t			threadHandle;
+
+			#endif
+
+			ThreadFunction		*threadFunction;
+			void				*threadCookie;
+
+			#if defined(_WIN32)
+
+				static DWORD WINAPI ThreadEntry(void *thread);
+
+			#else
+
+				static void *ThreadEntry(void *thread);
+
+			#endif
+
+		public:
+
+			Thread(ThreadFunction *function, void *cookie);
+			~Thread();
+	};
+
+
+	// The Mutex class provides mutual exclusion among threads, and the Condition class lets a
+	// thread holding a mutex wait until another thread wakes it. Wait() releases the mutex while
+	// the thread sleeps and acquires it again before returning, and the caller must check the
+	// condition it is waiting for in a loop because a wait can end without a wake. Wake() wakes
+	// one waiting thread, and WakeAll() wakes every waiting thread.
+
+	class Mutex
+	{
+		friend class Condition;
+
+		private:
+
+			#if defined(_WIN32)
+
+				CRITICAL_SECTION	criticalSection;
+
+			#else
+
+				pthread_mutex_t		mutex;
+
+			#endif
+
+		public:
+
+			Mutex();
+			~Mutex();
+
+			void Acquire(void);
+			void Release(void);
+	};
+
+
+	class Condition
+	{
+		private:
+
+			#if defined(_WIN32)
+
+				CONDITION_VARIABLE	conditionVariable;
+
+			#else
+
+				pthread_cond_t		condition;
+
+			#endif
+
+		public:
+
+			Condition();
+			~Condition();
+
+			void Wait(Mutex *mutex);
+			void Wake(void);
+			void WakeAll(void);
+	};
+
+
+	// These functions hide the differences between platforms from code that runs on several
+	// threads or measures time. AtomicIncrement() returns the incremented value, and
+	// AtomicCompareExchange() stores the exchange value only if the current value equals the
+	// comparand and returns the value it found. GetMicrosecondTime() returns an absolute time in
+	// microseconds, and OutputDebugText() writes to the debugger output on Windows and to the
+	// standard error stream elsewhere.
+
+	int32 GetProcessorCount(void);
+	int64 GetMicrosecondTime(void);
+	void YieldThread(void);
+
+	int32 AtomicIncrement(volatile int32 *value);
+	int32 AtomicCompareExchange(volatile int32 *value, int32 exchange, int32 comparand);
+
+	void OutputDebugText(const char *text);
+
+
 	bool ImportTargaImageFile(const char *name, Color4U **image, Integer2D *size);
 	void ReleaseTargaImageData(Color4U *image);
 
+	// A Targa file can also be decoded into storage provided by the caller, such as the first
+	// level of a mipmap chain. GetTargaImageSize() returns false if the file is not supported,
+	// and DecodeTargaImage() may only be called for a file that is supported.
+
+	bool GetTargaImageSize(const File& file, Integer2D *size);
+	void DecodeTargaImage(const File& file, Color4U *image);
+
 	int32 GenerateMipmapImages(const Integer3D& size, const Color4U *source, Color4U **image);
 	int32 GenerateMipmapImages(const Integer3D& size, const Color2S *source, Color2S **image);
 	int32 GenerateMipmapImages(const Integer3D& size, const Color1S *source, Color1S **image);
 	void ReleaseMipmapImages(void *image);
 
+	// BuildMipmapImages() fills in the mipmap chain of an image allocated by the caller with
+	// CalculateMipmapImageSize() after level 0 has been stored at the beginning of it.
+
+	int32 BuildMipmapImages(const Integer3D& size, Color4U *image);
+
+	void UpdateMipmapImages(const Integer3D& size, const Color4U *source, Color4U *image, const Rect& rect);
+	void UpdateMipmapImages(const Integer3D& size, const Color2S *source, Color2S *image, const Rect& rect);
+	void UpdateMipmapImages(const Integer3D& size, const Color1S *source, Color1S *image, const Rect& rect);
+	uint32 CalculateMipmapImageSize(const Integer3D& size, uint32 pixelSize);
+
+
+	// The TextureLayout class defines the texture types and formats and describes how images in
+	// them are laid out in memory. It doesn't depend on the graphics library, so images can be
+	// prepared for textures by code that never creates one. The Texture class derives from it.
+
+	class TextureLayout
+	{
+		public:
+
+			enum
+			{
+				kType2D,
+				kType3D,
+				kTypeCube,
+				kType2DArray,
+				kTypeRectangle,
+				kTypeMultisample,
+				kTypeCount
+			};
+
+			enum
+			{
+				kFormatGammaRgba,
+				kFormatLinearRgba,
+				kFormatSignedRgba,
+				kFormatLinearRedGreen,
+				kFormatSignedRedGreen,
+				kFormatLinearRed,
+				kFormatSignedRed,
+				kFormatFloat16Rgba,
+				kFormatUint16Rgba,
+				kFormatDepth,
+				kFormatGammaBC1,
+				kFormatGammaBC3,
+				kFormatLinearBC4,
+				kFormatSignedBC4,
+				kFormatLinearBC5,
+				kFormatSignedBC5,
+				kFormatCount
+			};
+
+			// The BC formats store 4x4 blocks of texels. An image in one of these formats holds the
+			// blocks of each mipmap in rows, and it cannot be passed to UpdateTexture().
+
+			static bool CompressedFormat(int32 format)
+			{
+				return (format >= kFormatGammaBC1);
+			}
+
+			// GetFormatSize() returns the number of bytes in one texel of an uncompressed format or
+			// in one 4x4 block of a compressed format. CalculateLayerSize() returns the number of
+			// bytes in one layer of one mipmap, and CalculateImageSize() returns the number of bytes
+			// in an image holding all the mipmaps in the order a Texture uploads them. The image size
+			// is zero if any dimension or the mipmap count is not positive, if there are more mipmaps
+			// than the full chain, or if the image would not fit in 32 bits.
+
+			static uint32 GetFormatSize(int32 format);
+			static uint32 CalculateLayerSize(int32 format, int32 width, int32 height);
+			static uint32 CalculateImageSize(int32 type, int32 format, int32 width, int32 height, int32 depth, int32 mipmapCount);
+	};
+
 
 	uint32 RandomInteger(uint32 n);
 	float RandomFloat(float n);
@@ -0,0 +1,591 @@
+#include "Benchmark.h"
+
+#include <stdio.h>
+
+
+using namespace Framework;
+
+
+namespace
+{
+	enum
+	{
+		kBenchmarkMinSize			= 256,
+		kBenchmarkMaxSize			= 4096,
+		kHorizonCubeRepeatCount		= 1000,
+		kHorizonCubeTexelCount		= 6 * 16 * 16
+	};
+
+
+	struct BenchmarkChecksum
+	{
+		const char		*stageName;
+		uint64			checksum;
+	};
+
+
+	// These checksums were recorded from an x86-64 build using SSE. Stages that call functions in
+	// the math library may produce different results with other compilers. The horizon maps also
+	// depend on the bake mode and search radius, and the gamma mipmaps depend on the filter, so their
+	// checksums are kept in separate tables for the configurations that have been recorded. In the
+	// default configuration of Base.h, every stage must have a recorded checksum. In any other
+	// configuration, a stage without one reports the checksum it produced.
+
+	const BenchmarkChecksum benchmarkChecksumTable[] =
+	{
+		{"Normal map, Synthetic 256x256", 0x7325AE7F4EE4B3D1ULL},
+		{"Normal mipmaps, Synthetic 256x256", 0x878CD8991DCAA6D8ULL},
+		{"Parallax map, Synthetic 256x256", 0xC4D695FBE3D93E67ULL},
+		{"Cone map, Synthetic 256x256", 0x05A712508E68EA20ULL},
+		{"Normal map, Synthetic 512x512", 0xA1BCB727F58B21D2ULL},
+		{"Normal mipmaps, Synthetic 512x512", 0x728B7CE33394A4C2ULL},
+		{"Parallax map, Synthetic 512x512", 0xDED50276F484EB81ULL},
+		{"Cone map, Synthetic 512x512", 0xB62342757B14D5A2ULL},
+		{"Normal map, Synthetic 1024x1024", 0x9BD9F8342F4E41A7ULL},
+		{"Normal mipmaps, Synthetic 1024x1024", 0x69928C0FDBD53313ULL},
+		{"Parallax map, Synthetic 1024x1024", 0xD4579CBC41175903ULL},
+		{"Cone map, Synthetic 1024x1024", 0x1833618FFFBBDB94ULL},
+		{"Normal map, Synthetic 2048x2048", 0x2D3C66235469A548ULL},
+		{"Normal mipmaps, Synthetic 2048x2048", 0xF5208033CE9A8310ULL},
+		{"Parallax map, Synthetic 2048x2048", 0x00C53460B6F6333FULL},
+		{"Cone map, Synthetic 2048x2048", 0x83F7C38B528A67E7ULL},
+		{"Normal map, Synthetic 4096x4096", 0x5199148CDFEFF0C5ULL},
+		{"Normal mipmaps, Synthetic 4096x4096", 0xA6BD28813163BCDAULL},
+		{"Parallax map, Synthetic 4096x4096", 0x390C3E63B7FBF936ULL},
+		{"Cone map, Synthetic 4096x4096", 0xDFBA9B075B1C2753ULL},
+		{"Normal map, StoneFloor 512x512", 0x0F8BF99EE90B73D5ULL},
+		{"Normal mipmaps, StoneFloor 512x512", 0xF221533A7B2B977EULL},
+		{"Parallax map, StoneFloor 512x512", 0x6216A816C0DE9ED8ULL},
+		{"Cone map, StoneFloor 512x512", 0x25850F368529ED39ULL},
+		{"Normal map, StoneWall 1024x1024", 0x3E07631A52E5A867ULL},
+		{"Normal mipmaps, StoneWall 1024x1024", 0x180F6E48B921EBD3ULL},
+		{"Parallax map, StoneWall 1024x1024", 0xC35C4B758D5B11B1ULL},
+		{"Cone map, StoneWall 1024x1024", 0x1AD915F3239CF34BULL},
+		{"Normal map, Cracks 1024x1024", 0xBF292C73F78CE84FULL},
+		{"Normal mipmaps, Cracks 1024x1024", 0x7F30A5969B8B96FBULL},
+		{"Parallax map, Cracks 1024x1024", 0x5FC9C5E0C683805EULL},
+		{"Cone map, Cracks 1024x1024", 0xA684E9C90495C1F9ULL},
+		{"BC5 normal mipmaps, Synthetic 256x256", 0x9F1DC8CFC874ACC0ULL},
+		{"BC5 normal mipmaps, Synthetic 512x512", 0x9F62F2EF2A59CB4FULL},
+		{"BC5 normal mipmaps, Synthetic 1024x1024", 0x696F44998F292582ULL},
+		{"BC5 normal mipmaps, Synthetic 2048x2048", 0xC9E00E87C2125D7BULL},
+		{"BC5 normal mipmaps, Synthetic 4096x4096", 0x6073595BBCB8D419ULL},
+		{"BC5 normal mipmaps, StoneFloor 512x512", 0x2FE9EFE6824E2813ULL},
+		{"BC5 normal mipmaps, StoneWall 1024x1024", 0x7DB88F3BF6E8C054ULL},
+		{"BC5 normal mipmaps, Cracks 1024x1024", 0x750866025B948805ULL},
+		{"Horizon cube, Generated 16x96", 0x6DF0DE0551480325ULL},
+		{"", 0}
+	};
+
+
+	const BenchmarkChecksum bruteForceHorizonChecksumTable[] =
+	{
+		{"Horizon map, Synthetic 256x256", 0xC6E1B0D49ABDA03FULL},
+		{"Horizon mipmaps, Synthetic 256x256", 0xF958C52C07EC0B19ULL},
+		{"Horizon map, Synthetic 512x512", 0x95C2698BF615B92AULL},
+		{"Horizon mipmaps, Synthetic 512x512", 0xA8B380D0671E8D5CULL},
+		{"Horizon map, Synthetic 1024x1024", 0xA68FBCF26BB437E5ULL},
+		{"Horizon mipmaps, Synthetic 1024x1024", 0xB3C6B99F0CC737A2ULL},
+		{"Horizon map, Synthetic 2048x2048", 0xD4631431C137FC0EULL},
+		{"Horizon mipmaps, Synthetic 2048x2048", 0x5D85084748CC1515ULL},
+		{"Horizon map, Synthetic 4096x4096", 0xDB29EF99991AC2D2ULL},
+		{"Horizon mipmaps, Synthetic 4096x4096", 0xA916A9F239D27E57ULL},
+		{"Horizon map, StoneFloor 512x512", 0x5048BCE2366F402CULL},
+		{"Horizon mipmaps, StoneFloor 512x512", 0x5661F091C5130031ULL},
+		{"Horizon map, StoneWall 1024x1024", 0x2B88C8B037DFF4C5ULL},
+		{"Horizon mipmaps, StoneWall 1024x1024", 0x9B1FB65FCB0493E6ULL},
+		{"Horizon map, Cracks 1024x1024", 0xB3CAEB000618E764ULL},
+		{"Horizon mipmaps, Cracks 1024x1024", 0xB1BEF492D6B562E1ULL},
+		{"BC5 horizon mipmaps, Synthetic 256x256", 0xB28B8E5552CF86AEULL},
+		{"BC5 horizon mipmaps, Synthetic 512x512", 0x32041A1E67400C0FULL},
+		{"BC5 horizon mipmaps, Synthetic 1024x1024", 0xFD1C4C0BAEDDA36DULL},
+		{"BC5 horizon mipmaps, Synthetic 2048x2048", 0xAD4F4DF7A605288CULL},
+		{"BC5 horizon mipmaps, Synthetic 4096x4096", 0x78B54742CE954C95ULL},
+		{"BC5 horizon mipmaps, StoneFloor 512x512", 0x754AF4AEB71B5737ULL},
+		{"BC5 horizon mipmaps, StoneWall 1024x1024", 0x021912B1E1685AC0ULL},
+		{"BC5 horizon mipmaps, Cracks 1024x1024", 0x4AC0AF3FCB4E6898ULL},
+		{"", 0}
+	};
+
+
+	const BenchmarkChecksum sweepHorizonChecksumTable[] =
+	{
+		{"Horizon map, Synthetic 256x256", 0xF74F9FD4D13ED788ULL},
+		{"Horizon mipmaps, Synthetic 256x256", 0x696475C1E2EAFD58ULL},
+		{"Horizon map, Synthetic 512x512", 0xC9545A7B47372F26ULL},
+		{"Horizon mipmaps, Synthetic 512x512", 0xF751B84032372E54ULL},
+		{"Horizon map, Synthetic 1024x1024", 0x08B063F7F96CC491ULL},
+		{"Horizon mipmaps, Synthetic 1024x1024", 0xCF8F9FC0E69EAD09ULL},
+		{"Horizon map, Synthetic 2048x2048", 0x7C3A38EF8D3879AAULL},
+		{"Horizon mipmaps, Synthetic 2048x2048", 0x0A25FDE9AC95FCF7ULL},
+		{"Horizon map, Synthetic 4096x4096", 0x61FBB2FCEE7FF191ULL},
+		{"Horizon mipmaps, Synthetic 4096x4096", 0x6D7A5B326570133FULL},
+		{"Horizon map, StoneFloor 512x512", 0xA22BA8ED69E7ECFFULL},
+		{"Horizon mipmaps, StoneFloor 512x512", 0x5EBDBC5550549350ULL},
+		{"Horizon map, StoneWall 1024x1024", 0xEAF0CA78FCC8C512ULL},
+		{"Horizon mipmaps, StoneWall 1024x1024", 0x390F62B0FFFA011CULL},
+		{"Horizon map, Cracks 1024x1024", 0x7CC102C34825B5F0ULL},
+		{"Horizon mipmaps, Cracks 1024x1024", 0x665C1A0A852CD467ULL},
+		{"BC5 horizon mipmaps, Synthetic 256x256", 0x2F3E2B94AB890BFBULL},
+		{"BC5 horizon mipmaps, Synthetic 512x512", 0xCABDA2F2AD1F6386ULL},
+		{"BC5 horizon mipmaps, Synthetic 1024x1024", 0x7508FF38A142CEF6ULL},
+		{"BC5 horizon mipmaps, Synthetic 2048x2048", 0xD9DF4BA626D4C7E5ULL},
+		{"BC5 horizon mipmaps, Synthetic 4096x4096", 0x70460412C028C98BULL},
+		{"BC5 horizon mipmaps, StoneFloor 512x512", 0x77E2A2DCE27654A6ULL},
+		{"BC5 horizon mipmaps, StoneWall 1024x1024", 0x7D6018DDC002CA5CULL},
+		{"BC5 horizon mipmaps, Cracks 1024x1024", 0x0E124750A39930B0ULL},
+		{"", 0}
+	};
+
+
+	const BenchmarkChecksum kaiserGammaChecksumTable[] =
+	{
+		{"Gamma mipmaps, Synthetic 256x256", 0x378965842EDEC3D7ULL},
+		{"Gamma mipmaps, Synthetic 512x512", 0x09511E5AEA1B148AULL},
+		{"Gamma mipmaps, Synthetic 1024x1024", 0x9504705C9F0A3112ULL},
+		{"Gamma mipmaps, Synthetic 2048x2048", 0x32C1C89A992862CFULL},
+		{"Gamma mipmaps, Synthetic 4096x4096", 0x6B10E6312392E9BCULL},
+		{"Gamma mipmaps, StoneFloor 512x512", 0x98ED92B3069A552FULL},
+		{"Gamma mipmaps, StoneWall 1024x1024", 0xF6E65794BE0740E2ULL},
+		{"Gamma mipmaps, Cracks 1024x1024", 0xBB411DF739339BF9ULL},
+		{"BC1 gamma mipmaps, Synthetic 256x256", 0xB9C4AFF14E7D5905ULL},
+		{"BC1 gamma mipmaps, Synthetic 512x512", 0x71C543A6789DB46BULL},
+		{"BC1 gamma mipmaps, Synthetic 1024x1024", 0xBFB280D34833C40EULL},
+		{"BC1 gamma mipmaps, Synthetic 2048x2048", 0x1F4B8FF7D8F0FBBBULL},
+		{"BC1 gamma mipmaps, Synthetic 4096x4096", 0x0B2A1B366AA7A3D7ULL},
+		{"BC1 gamma mipmaps, StoneFloor 512x512", 0x13ECBF2639017E05ULL},
+		{"BC1 gamma mipmaps, StoneWall 1024x1024", 0xD17FCBB2E6359556ULL},
+		{"BC1 gamma mipmaps, Cracks 1024x1024", 0xC12825055D31F361ULL},
+		{"", 0}
+	};
+
+
+	const BenchmarkChecksum *FindBenchmarkChecksum(const BenchmarkChecksum *table, const char *name)
+	{
+		for (; table->stageName[0] != 0; table++)
+		{
+			if (Text::CompareText(table->stageName, name))
+			{
+				return (table);
+			}
+		}
+
+		return (nullptr);
+	}
+
+
+	const BenchmarkChecksum *GetRecordedChecksum(const char *name)
+	{
+		const BenchmarkChecksum *recorded = FindBenchmarkChecksum(benchmarkChecksumTable, name);
+
+		#if HORIZON_BAKE_MODE == 0
+
+			recorded = (recorded) ? recorded : FindBenchmarkChecksum(bruteForceHorizonChecksumTable, name);
+
+		#elif (HORIZON_BAKE_MODE == 1) && (HORIZON_SEARCH_RADIUS == 64)
+
+			recorded = (recorded) ? recorded : FindBenchmarkChecksum(sweepHorizonChecksumTable, name);
+
+		#endif
+
+		// The filter is an enumerant, so it is compared here rather than by the preprocessor.
+
+		if ((!recorded) && (GAMMA_MIPMAP_FILTER == kMipmapFilterKaiser))
+		{
+			recorded = FindBenchmarkChecksum(kaiserGammaChecksumTable, name);
+		}
+
+		return (recorded);
+	}
+
+
+	inline bool DefaultBenchmarkConfiguration(void)
+	{
+		return ((HORIZON_BAKE_MODE == 0) && (GAMMA_MIPMAP_FILTER == kMipmapFilterKaiser));
+	}
+
+
+	struct BenchmarkSource
+	{
+		const char		*sourceName;
+		const char		*fileName;
+	};
+
+
+	const BenchmarkSource benchmarkSourceTable[] =
+	{
+		{"StoneFloor", "Textures/StoneFloor-nrml.tga"},
+		{"StoneWall", "Textures/StoneWall-nrml.tga"},
+		{"Cracks", "Textures/Cracks-nrml.tga"}
+	};
+
+
+	struct BenchmarkResult
+	{
+		int32		stageCount;
+		int32		mismatchCount;
+		int32		unknownCount;
+	};
+
+
+	inline uint32 HashLattice(int32 x, int32 y, uint32 seed)
+	{
+		uint32 h = uint32(x) * 0x8DA6B343U + uint32(y) * 0xD8163841U + seed * 0xCB1AB31FU;
+		h = (h ^ (h >> 13)) * 0x5BD1E995U;
+		return (h ^ (h >> 15));
+	}
+
+
+	float GetLatticeValue(int32 x, int32 y, int32 period, uint32 seed)
+	{
+		return (float(HashLattice(x & (period - 1), y & (period - 1), seed) >> 8) * (1.0F / 16777216.0F));
+	}
+
+
+	void BakeBenchmarkHorizonMap(const Color4U *heightMap, Color4U *horizonMap, int32 width, int32 height, float scale)
+	{
+		// The horizon map is baked in the same mode as the world textures.
+
+		#if HORIZON_BAKE_MODE == 2
+
+			BakeHorizonMapPyramid(heightMap, horizonMap, width, height, scale, HORIZON_SEARCH_RADIUS, HORIZON_PYRAMID_ERROR, BAKE_THREAD_COUNT);
+
+		#elif HORIZON_BAKE_MODE == 1
+
+			BakeHorizonMapSweep(heightMap, horizonMap, width, height, scale, HORIZON_SEARCH_RADIUS, BAKE_THREAD_COUNT);
+
+		#else
+
+			BakeHorizonMap(heightMap, horizonMap, width, height, scale, BAKE_THREAD_COUNT);
+
+		#endif
+	}
+
+
+	void OutputBenchmarkStage(BenchmarkResult *result, const char *stageName, const char *sourceName, int32 width, int32 height, int32 pixelCount, int64 time, const void *data, uint32 size)
+	{
+		String<>	name(stageName);
+
+		name += ", ";
+		name += sourceName;
+		name += " ";
+		name += width;
+		name += "x";
+		name += height;
+
+		float milliseconds = float(time) * 0.001F;
+		float rate = float(pixelCount) / Fmax(float(time), 1.0F);
+		uint64 checksum = CalculateBakeChecksum(data, size);
+
+		String<>	string(name);
+
+		string += ": ";
+		string += String<>(milliseconds);
+		string += " ms, ";
+		string += String<>(rate);
+		string += " Mpixel/s, checksum ";
+		string += Text::Integer64ToHexString16(checksum);
+
+		// Look up the checksum recorded for this stage and source. A missing checksum is counted
+		// as a mismatch in the default configuration.
+
+		const BenchmarkChecksum *recorded = GetRecordedChecksum(name);
+
+		if (!recorded)
+		{
+			if (DefaultBenchmarkConfiguration())
+			{
+				string += " NOT RECORDED\n";
+				result->mismatchCount++;
+			}
+			else
+			{
+				string += " (not recorded)\n";
+				result->unknownCount++;
+			}
+		}
+		else if (recorded->checksum != checksum)
+		{
+			string += " MISMATCH, expected ";
+			string += Text::Integer64ToHexString16(recorded->checksum);
+			string += "\n";
+			result->mismatchCount++;
+		}
+		else
+		{
+			string += " (ok)\n";
+		}
+
+		result->stageCount++;
+		fputs(string, stdout);
+	}
+
+
+	void OutputCompressionQuality(BenchmarkResult *result, const char *stageName, const char *sourceName, float psnr, float threshold)
+	{
+		// A compressed stage fails when the peak signal-to-noise ratio of the decompressed image
+		// falls below the threshold, and the failure is counted as a mismatch.
+
+		String<>	string(stageName);
+
+		string += ", ";
+		string += sourceName;
+		string += ": PSNR ";
+		string += String<>(psnr);
+		string += " dB";
+
+		if (psnr < threshold)
+		{
+			string += " BELOW THRESHOLD ";
+			string += String<>(threshold);
+			string += " dB\n";
+			result->mismatchCount++;
+		}
+		else
+		{
+			string += " (ok)\n";
+		}
+
+		fputs(string, stdout);
+	}
+
+
+	void BenchmarkHeightMap(BenchmarkResult *result, const char *sourceName, const Color4U *heightMap, int32 width, int32 height)
+	{
+		int32 pixelCount = width * height;
+
+		// Normal map and its mipmaps.
+
+		Color2S *normalMap = new Color2S[pixelCount];
+		Color2S *normalMipmapImages;
+
+		int64 time = GetMicrosecondTime();
+		BakeNormalMap(heightMap, normalMap, width, height, 16.0F, BAKE_THREAD_COUNT);
+		OutputBenchmarkStage(result, "Normal map", sourceName, width, height, pixelCount, GetMicrosecondTime() - time, normalMap, pixelCount * sizeof(Color2S));
+
+		time = GetMicrosecondTime();
+		int32 mipmapCount = GenerateMipmapImages(Integer3D(width, height, 1), normalMap, &normalMipmapImages);
+		uint32 imageSize = CalculateMipmapImageSize(Integer3D(width, height, 1), sizeof(Color2S));
+		OutputBenchmarkStage(result, "Normal mipmaps", sourceName, width, height, pixelCount, GetMicrosecondTime() - time, normalMipmapImages, imageSize);
+
+		time = GetMicrosecondTime();
+		void *normalCode = CompressTextureImage(Integer3D(width, height, 1), mipmapCount, TextureLayout::kFormatSignedBC5, normalMipmapImages, BAKE_THREAD_COUNT);
+		uint32 codeSize = TextureLayout::CalculateImageSize(TextureLayout::kType2D, TextureLayout::kFormatSignedBC5, width, height, 1, mipmapCount);
+		OutputBenchmarkStage(result, "BC5 normal mipmaps", sourceName, width, height, pixelCount, GetMicrosecondTime() - time, normalCode, codeSize);
+
+		Color2S *normalDecoded = new Color2S[imageSize / sizeof(Color2S)];
+		DecompressTextureImage(Integer3D(width, height, 1), mipmapCount, TextureLayout::kFormatSignedBC5, normalCode, normalDecoded);
+		OutputCompressionQuality(result, "BC5 normal mipmaps", sourceName, CalculateImagePsnr(normalDecoded, normalMipmapImages, imageSize / sizeof(Color2S), sizeof(Color2S), 2, true), 30.0F);
+
+		delete[] normalDecoded;
+		ReleaseMipmapImages(normalCode);
+		ReleaseMipmapImages(normalMipmapImages);
+		delete[] normalMap;
+
+		// Two-layer horizon map and its mipmaps.
+
+		Color4U *horizonMap = new Color4U[pixelCount * 2];
+		Color4U *horizonMipmapImages;
+
+		time = GetMicrosecondTime();
+		BakeBenchmarkHorizonMap(heightMap, horizonMap, width, height, 16.0F);
+		OutputBenchmarkStage(result, "Horizon map", sourceName, width, height, pixelCount, GetMicrosecondTime() - time, horizonMap, pixelCount * 2 * sizeof(Color4U));
+
+		time = GetMicrosecondTime();
+		GenerateMipmapImages(Integer3D(width, height, 2), horizonMap, &horizonMipmapImages);
+		imageSize = CalculateMipmapImageSize(Integer3D(width, height, 2), sizeof(Color4U));
+		OutputBenchmarkStage(result, "Horizon mipmaps", sourceName, width, height, pixelCount * 2, GetMicrosecondTime() - time, horizonMipmapImages, imageSize);
+
+		// The horizon layers are compressed into a pair of BC5 images, which are checked as one
+		// image with the channels in their original order.
+
+		void	*horizonCode[2];
+
+		time = GetMicrosecondTime();
+		CompressHorizonImage(Integer3D(width, height, 2), mipmapCount, horizonMipmapImages, &horizonCode[0], &horizonCode[1], BAKE_THREAD_COUNT);
+		int64 horizonTime = GetMicrosecondTime() - time;
+
+		codeSize = TextureLayout::CalculateImageSize(TextureLayout::kType2DArray, TextureLayout::kFormatLinearBC5, width, height, 2, mipmapCount);
+		uint8 *horizonData = new uint8[codeSize * 2];
+		Terathon::CopyMemory(horizonCode[0], horizonData, codeSize);
+		Terathon::CopyMemory(horizonCode[1], horizonData + codeSize, codeSize);
+		OutputBenchmarkStage(result, "BC5 horizon mipmaps", sourceName, width, height, pixelCount * 2, horizonTime, horizonData, codeSize * 2);
+
+		Color2U *horizonDecoded = new Color2U[imageSize / sizeof(Color2U)];
+		Color4U *horizonImage = new Color4U[imageSize / sizeof(Color4U)];
+		DecompressTextureImage(Integer3D(width, height, 2), mipmapCount, TextureLayout::kFormatLinearBC5, horizonCode[0], horizonDecoded);
+		DecompressTextureImage(Integer3D(width, height, 2), mipmapCount, TextureLayout::kFormatLinearBC5, horizonCode[1], horizonDecoded + imageSize / sizeof(Color4U));
+
+		const Color2U *blueAlpha = horizonDecoded + imageSize / sizeof(Color4U);
+		for (machine a = 0; a < machine(imageSize / sizeof(Color4U)); a++)
+		{
+			horizonImage[a].Set(horizonDecoded[a].red, horizonDecoded[a].green, blueAlpha[a].red, blueAlpha[a].green);
+		}
+
+		OutputCompressionQuality(result, "BC5 horizon mipmaps", sourceName, CalculateImagePsnr(horizonImage, horizonMipmapImages, imageSize / sizeof(Color4U), sizeof(Color4U), 4), 30.0F);
+
+		delete[] horizonImage;
+		delete[] horizonDecoded;
+		delete[] horizonData;
+		ReleaseMipmapImages(horizonCode[1]);
+		ReleaseMipmapImages(horizonCode[0]);
+		ReleaseMipmapImages(horizonMipmapImages);
+		delete[] horizonMap;
+
+		// Gamma-correct mipmaps of the height map treated as a color image.
+
+		Color4U *colorMipmapImages;
+
+		time = GetMicrosecondTime();
+		GenerateGammaMipmapImages(Integer3D(width, height, 1), heightMap, &colorMipmapImages, GAMMA_MIPMAP_FILTER, BAKE_THREAD_COUNT);
+		imageSize = CalculateMipmapImageSize(Integer3D(width, height, 1), sizeof(Color4U));
+		OutputBenchmarkStage(result, "Gamma mipmaps", sourceName, width, height, pixelCount, GetMicrosecondTime() - time, colorMipmapImages, imageSize);
+
+		time = GetMicrosecondTime();
+		void *colorCode = CompressTextureImage(Integer3D(width, height, 1), mipmapCount, TextureLayout::kFormatGammaBC1, colorMipmapImages, BAKE_THREAD_COUNT);
+		codeSize = TextureLayout::CalculateImageSize(TextureLayout::kType2D, TextureLayout::kFormatGammaBC1, width, height, 1, mipmapCount);
+		OutputBenchmarkStage(result, "BC1 gamma mipmaps", sourceName, width, height, pixelCount, GetMicrosecondTime() - time, colorCode, codeSize);
+
+		// BC1 does not store alpha, so only the color channels are compared.
+
+		Color4U *colorDecoded = new Color4U[imageSize / sizeof(Color4U)];
+		DecompressTextureImage(Integer3D(width, height, 1), mipmapCount, TextureLayout::kFormatGammaBC1, colorCode, colorDecoded);
+		OutputCompressionQuality(result, "BC1 gamma mipmaps", sourceName, CalculateImagePsnr(colorDecoded, colorMipmapImages, imageSize / sizeof(Color4U), sizeof(Color4U), 3), 32.0F);
+
+		delete[] colorDecoded;
+		ReleaseMipmapImages(colorCode);
+		ReleaseMipmapImages(colorMipmapImages);
+
+		// Parallax map and cone map.
+
+		Color1S *parallaxMap = new Color1S[pixelCount];
+		Color1U *coneMap = new Color1U[pixelCount];
+
+		SurfaceMapSet	parallaxMapSet;
+
+		parallaxMapSet.normalMap = nullptr;
+		parallaxMapSet.parallaxMap = parallaxMap;
+		parallaxMapSet.horizonMap = nullptr;
+		parallaxMapSet.ambientMap = nullptr;
+		parallaxMapSet.parallaxScale = 1.0F;
+		parallaxMapSet.ambientPower = 1.0F;
+
+		time = GetMicrosecondTime();
+		BakeSurfaceMaps(heightMap, &parallaxMapSet, width, height, 1.0F, BAKE_THREAD_COUNT);
+		OutputBenchmarkStage(result, "Parallax map", sourceName, width, height, pixelCount, GetMicrosecondTime() - time, parallaxMap, pixelCount * sizeof(Color1S));
+
+		time = GetMicrosecondTime();
+		BakeConeMap(heightMap, coneMap, width, height, BAKE_THREAD_COUNT);
+		OutputBenchmarkStage(result, "Cone map", sourceName, width, height, pixelCount, GetMicrosecondTime() - time, coneMap, pixelCount * sizeof(Color1U));
+
+		delete[] coneMap;
+		delete[] parallaxMap;
+	}
+}
+
+
+void Framework::GenerateBenchmarkHeightMap(Color4U *heightMap, int32 width, int32 height, uint32 seed)
+{
+	// Sum six octaves of smoothly interpolated lattice noise that wraps at the edges of the map,
+	// which resembles the mix of broad and fine detail found in the shipped height maps.
+
+	for (int32 y = 0; y < height; y++)
+	{
+		for (int32 x = 0; x < width; x++)
+		{
+			float value = 0.0F;
+			float amplitude = 0.5F;
+			int32 cellSize = Max(width, height) >> 2;
+
+			for (int32 octave = 0; octave < 6; octave++)
+			{
+				int32 period = Max(width / cellSize, 1);
+				float u = float(x) / float(cellSize);
+				float v = float(y) / float(cellSize);
+				int32 i = int32(u);
+				int32 j = int32(v);
+				u -= float(i);
+				v -= float(j);
+				u = u * u * (3.0F - 2.0F * u);
+				v = v * v * (3.0F - 2.0F * v);
+
+				float v00 = GetLatticeValue(i, j, period, seed + octave);
+				float v10 = GetLatticeValue(i + 1, j, period, seed + octave);
+				float v01 = GetLatticeValue(i, j + 1, period, seed + octave);
+				float v11 = GetLatticeValue(i + 1, j + 1, period, seed + octave);
+				float a = v00 + (v10 - v00) * u;
+				float b = v01 + (v11 - v01) * u;
+				value += (a + (b - a) * v) * amplitude;
+
+				amplitude *= 0.5F;
+				cellSize = Max(cellSize >> 1, 1);
+			}
+
+			uint32 h = uint32(Min(value * 255.0F + 0.5F, 255.0F));
+			heightMap[y * width + x].Set(h, h, h, 255);
+		}
+	}
+}
+
+int32 Framework::RunBakeBenchmark(void)
+{
+	BenchmarkResult		result;
+
+	result.stageCount = 0;
+	result.mismatchCount = 0;
+	result.unknownCount = 0;
+
+	int64 startTime = GetMicrosecondTime();
+
+	for (int32 size = kBenchmarkMinSize; size <= kBenchmarkMaxSize; size <<= 1)
+	{
+		Color4U *heightMap = new Color4U[size * size];
+		GenerateBenchmarkHeightMap(heightMap, size, size, 0);
+		BenchmarkHeightMap(&result, "Synthetic", heightMap, size, size);
+		delete[] heightMap;
+	}
+
+	for (const BenchmarkSource& source : benchmarkSourceTable)
+	{
+		Color4U		*heightMap;
+		Integer2D	imageSize;
+
+		if (ImportTargaImageFile(source.fileName, &heightMap, &imageSize))
+		{
+			BenchmarkHeightMap(&result, source.sourceName, heightMap, imageSize.x, imageSize.y);
+			ReleaseTargaImageData(heightMap);
+		}
+		else
+		{
+			String<> string(source.fileName);
+			string += ": could not be loaded\n";
+			fputs(string, stdout);
+		}
+	}
+
+	// The horizon cube is small, so it is generated many times to obtain a measurable time.
+
+	Color4U *horizonCube = new Color4U[kHorizonCubeTexelCount];
+
+	int64 time = GetMicrosecondTime();
+	for (int32 k = 0; k < kHorizonCubeRepeatCount; k++)
+	{
+		GenerateHorizonCube(horizonCube);
+	}
+
+	OutputBenchmarkStage(&result, "Horizon cube", "Generated", 16, 16 * 6, kHorizonCubeTexelCount * kHorizonCubeRepeatCount, GetMicrosecondTime() - time, horizonCube, kHorizonCubeTexelCount * sizeof(Color4U));
+	delete[] horizonCube;
+
+	String<> string("Bake benchmark: ");
+	string += result.stageCount;
+	string += " stages, ";
+	string += result.mismatchCount;
+	string += " mismatches, ";
+	string += result.unknownCount;
+	string += " not recorded, ";
+	string += String<>(float(GetMicrosecondTime() - startTime) * 1.0e-6F);
+	string += " s total\n";
+	fputs(string, stdout);
+
+	return (result.mismatchCount);
+}
@@ -0,0 +1,23 @@
+#ifndef Benchmark_h
+#define Benchmark_h
+
+
+#include "Encode.h"
+
+
+namespace Framework
+{
+	// The bake benchmark runs the texture bakers on synthetic height maps of several sizes and on
+	// the height maps shipped with the application. It writes the time taken by each stage to the
+	// standard output, and it compares a checksum of each result with the one recorded for it so
+	// that optimized bakers can be checked for identical output. It does not use the GPU, and it
+	// is built as its own console program. RunBakeBenchmark() returns the number of stages whose
+	// checksums don't match, whose compression quality is too low, or, in the default
+	// configuration, that have no recorded checksum.
+
+	void GenerateBenchmarkHeightMap(Color4U *heightMap, int32 width, int32 height, uint32 seed);
+	int32 RunBakeBenchmark(void);
+}
+
+
+#endif
@@ -0,0 +1,13 @@
+#include "Benchmark.h"
+
+
+using namespace Framework;
+
+
+int main()
+{
+	// The exit code is nonzero if any stage failed its checksum or quality test, so the
+	// benchmark can be run by scripts that check the bakers.
+
+	return ((RunBakeBenchmark() == 0) ? 0 : 1);
+}
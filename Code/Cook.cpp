@@ -0,0 +1,166 @@
+#include "Cook.h"
+
+
+using namespace Framework;
+
+
+CookedTexture::CookedTexture()
+{
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = nullptr;
+	textureHeader = nullptr;
+}
+
+CookedTexture::~CookedTexture()
+{
+	Close();
+}
+
+bool CookedTexture::Open(const char *name)
+{
+	LARGE_INTEGER	fileSize;
+
+	Close();
+
+	fileHandle = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return (false);
+	}
+
+	if ((GetFileSizeEx(fileHandle, &fileSize)) && (uint64(fileSize.QuadPart) >= sizeof(CookedTextureHeader)))
+	{
+		mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle)
+		{
+			textureHeader = static_cast<const CookedTextureHeader *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+		}
+	}
+
+	// The image must lie entirely inside the file and have exactly the size that the
+	// Texture constructor will read from it. The size calculation returns zero for
+	// dimensions that are invalid or too large, so an empty image is never accepted.
+
+	const CookedTextureHeader *header = textureHeader;
+	if ((header) && (header->identifier == kCookedTextureIdentifier) && (header->version == kCookedTextureVersion) && (uint32(header->textureType) < Texture::kTypeCount) && (uint32(header->textureFormat) < Texture::kFormatCount))
+	{
+		uint64 imageEnd = uint64(header->imageOffset) + header->imageSize;
+		if ((header->imageSize != 0) && (header->imageOffset >= sizeof(CookedTextureHeader)) && (imageEnd <= uint64(fileSize.QuadPart)) && (header->imageSize == Texture::CalculateImageSize(header->textureType, header->textureFormat, header->width, header->height, header->depth, header->mipmapCount)))
+		{
+			return (true);
+		}
+	}
+
+	Close();
+	return (false);
+}
+
+void CookedTexture::Close(void)
+{
+	if (textureHeader)
+	{
+		UnmapViewOfFile(textureHeader);
+		textureHeader = nullptr;
+	}
+
+	if (mappingHandle)
+	{
+		CloseHandle(mappingHandle);
+		mappingHandle = nullptr;
+	}
+
+	if (fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(fileHandle);
+		fileHandle = INVALID_HANDLE_VALUE;
+	}
+}
+
+Texture *CookedTexture::CreateTexture(void) const
+{
+	const CookedTextureHeader *header = textureHeader;
+	return (new Texture(header->textureType, header->textureFormat, header->width, header->height, header->depth, header->mipmapCount, GetImage()));
+}
+
+
+String<> Framework::GetCookedTextureName(const char *name)
+{
+	int32 length = Text::GetTextLength(name);
+	for (int32 k = length - 1; k >= 0; k--)
+	{
+		char c = name[k];
+		if (c == '.')
+		{
+			length = k;
+			break;
+		}
+
+		if ((c == '/') || (c == '\\'))
+		{
+			break;
+		}
+	}
+
+	String<> cookedName(name, length);
+	cookedName += ".ctex";
+	return (cookedName);
+}
+
+bool Framework::GetCookedTextureStamp(const char *sourceName, uint64 buildKey, CookedTextureStamp *stamp)
+{
+	WIN32_FILE_ATTRIBUTE_DATA	attributeData;
+
+	stamp->buildKey = buildKey;
+
+	if (!GetFileAttributesExA(sourceName, GetFileExInfoStandard, &attributeData))
+	{
+		stamp->sourceSize = 0;
+		stamp->sourceTime = 0;
+		return (false);
+	}
+
+	stamp->sourceSize = (uint64(attributeData.nFileSizeHigh) << 32) | attributeData.nFileSizeLow;
+	stamp->sourceTime = (uint64(attributeData.ftLastWriteTime.dwHighDateTime) << 32) | attributeData.ftLastWriteTime.dwLowDateTime;
+	return (true);
+}
+
+bool Framework::WriteCookedTexture(const char *name, int32 type, int32 format, int32 width, int32 height, int32 depth, int32 mipmapCount, const void *image, const CookedTextureStamp& stamp)
+{
+	CookedTextureHeader		header;
+	DWORD					actual;
+
+	HANDLE fileHandle = CreateFileA(name, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return (false);
+	}
+
+	// The header occupies 64 bytes, so the image is aligned to a cache line in the mapped file.
+
+	header.identifier = kCookedTextureIdentifier;
+	header.version = kCookedTextureVersion;
+	header.textureType = type;
+	header.textureFormat = format;
+	header.width = width;
+	header.height = height;
+	header.depth = depth;
+	header.mipmapCount = mipmapCount;
+	header.imageOffset = sizeof(CookedTextureHeader);
+	header.imageSize = Texture::CalculateImageSize(type, format, width, height, depth, mipmapCount);
+	header.textureStamp = stamp;
+
+	bool success = ((header.imageSize != 0) && (WriteFile(fileHandle, &header, sizeof(CookedTextureHeader), &actual, nullptr)) && (actual == sizeof(CookedTextureHeader)));
+	if (success)
+	{
+		success = ((WriteFile(fileHandle, image, header.imageSize, &actual, nullptr)) && (actual == header.imageSize));
+	}
+
+	CloseHandle(fileHandle);
+
+	if (!success)
+	{
+		DeleteFileA(name);
+	}
+
+	return (success);
+}
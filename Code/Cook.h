@@ -0,0 +1,98 @@
+#ifndef Cook_h
+#define Cook_h
+
+
+#include "Graphics.h"
+
+
+namespace Framework
+{
+	enum
+	{
+		kCookedTextureIdentifier	= 'CTEX',
+		kCookedTextureVersion		= 2
+	};
+
+
+	// A CookedTextureStamp identifies what a cooked texture was built from. The size and last
+	// write time of the source image detect a source that changed after it was cooked, and the
+	// build key is a checksum of the parameters that affect the result, such as the normal scale,
+	// the mipmap filter, and the encoder version. The size and time are zero if the source image
+	// did not exist as a separate file when the texture was cooked.
+
+	struct CookedTextureStamp
+	{
+		uint64		sourceSize;
+		uint64		sourceTime;
+		uint64		buildKey;
+	};
+
+
+	// A cooked texture file begins with a CookedTextureHeader, and the image follows it at the
+	// offset given in the header. The image contains every mipmap in the layout that the Texture
+	// constructor uploads, so it can be passed to the constructor directly from the file.
+
+	struct CookedTextureHeader
+	{
+		uint32		identifier;
+		uint32		version;
+		int32		textureType;
+		int32		textureFormat;
+		int32		width;
+		int32		height;
+		int32		depth;
+		int32		mipmapCount;
+		uint32		imageOffset;
+		uint32		imageSize;
+		CookedTextureStamp	textureStamp;
+	};
+
+
+	// The CookedTexture class maps a cooked texture file into memory. Open() returns false if the
+	// file does not exist or is not a valid cooked texture with the current version, in which
+	// case the texture has to be built from its source image instead.
+
+	class CookedTexture
+	{
+		private:
+
+			HANDLE						fileHandle;
+			HANDLE						mappingHandle;
+			const CookedTextureHeader	*textureHeader;
+
+		public:
+
+			CookedTexture();
+			~CookedTexture();
+
+			const CookedTextureHeader *GetHeader(void) const
+			{
+				return (textureHeader);
+			}
+
+			const void *GetImage(void) const
+			{
+				return (reinterpret_cast<const char *>(textureHeader) + textureHeader->imageOffset);
+			}
+
+			bool Open(const char *name);
+			void Close(void);
+
+			Texture *CreateTexture(void) const;
+	};
+
+
+	// The cooked file for a texture has the name of its source image with the extension
+	// replaced by .ctex. WriteCookedTexture() is called by the offline cooker.
+	//
+	// GetCookedTextureStamp() fills in the stamp for a source image and build key. It returns
+	// false if the source image does not exist as a separate file, in which case the size and
+	// time are zero and a cooked file can only be checked against the build key.
+
+	String<> GetCookedTextureName(const char *name);
+	bool GetCookedTextureStamp(const char *sourceName, uint64 buildKey, CookedTextureStamp *stamp);
+	bool WriteCookedTexture(const char *name, int32 type, int32 format, int32 width, int32 height, int32 depth, int32 mipmapCount, const void *image, const CookedTextureStamp& stamp);
+}
+
+
+#endif
@@ -0,0 +1,849 @@
+#include "Encode.h"
+
+
+using namespace Framework;
+
+
+namespace
+{
+	// The ColorBlock structure holds the 16 texels of a color block with each channel stored
+	// contiguously, so that four texels at a time can be compared against the palette.
+
+	struct ColorBlock
+	{
+		alignas(16) float	red[16];
+		alignas(16) float	green[16];
+		alignas(16) float	blue[16];
+	};
+
+
+	// An EncodeSurface is one layer of one mipmap. Its block rows are numbered consecutively
+	// after those of the preceding surfaces so that all of them form a single band of rows.
+
+	struct EncodeSurface
+	{
+		int32			firstRow;
+		int32			width;
+		int32			height;
+		const uint8		*sourceImage;
+		uint8			*codeImage;
+	};
+
+
+	struct BlockEncodeData
+	{
+		int32				textureFormat;
+		int32				pixelSize;
+		int32				channelOffset;
+		int32				surfaceCount;
+		const EncodeSurface	*surfaceTable;
+	};
+
+
+	inline uint32 QuantizeColor(float red, float green, float blue)
+	{
+		uint32 r = uint32(Fmin(Fmax(red, 0.0F), 255.0F) * (31.0F / 255.0F) + 0.5F);
+		uint32 g = uint32(Fmin(Fmax(green, 0.0F), 255.0F) * (63.0F / 255.0F) + 0.5F);
+		uint32 b = uint32(Fmin(Fmax(blue, 0.0F), 255.0F) * (31.0F / 255.0F) + 0.5F);
+		return ((r << 11) | (g << 5) | b);
+	}
+
+	inline void ExpandColor(uint32 color, int32 *channel)
+	{
+		uint32 r = (color >> 11) & 31;
+		uint32 g = (color >> 5) & 63;
+		uint32 b = color & 31;
+
+		channel[0] = (r << 3) | (r >> 2);
+		channel[1] = (g << 2) | (g >> 4);
+		channel[2] = (b << 3) | (b >> 2);
+	}
+
+	inline vec_float CalculateColorDistance(const vec_float& red, const vec_float& green, const vec_float& blue, const float *color)
+	{
+		vec_float dr = VecSub(red, VecLoadSmearScalar(&color[0]));
+		vec_float dg = VecSub(green, VecLoadSmearScalar(&color[1]));
+		vec_float db = VecSub(blue, VecLoadSmearScalar(&color[2]));
+		return (VecMadd(dr, dr, VecMadd(dg, dg, VecMul(db, db))));
+	}
+
+
+	float EvaluateColorBlock(const ColorBlock *block, uint32 color0, uint32 color1, uint32 *indices)
+	{
+		// Choose the nearest of the four palette entries for every texel, and return the sum of
+		// the squared distances. The palette is generated the way a four-color block is decoded.
+
+		int32	endpoint0[3], endpoint1[3];
+
+		ExpandColor(color0, endpoint0);
+		ExpandColor(color1, endpoint1);
+
+		float	palette[4][3];
+
+		for (int32 k = 0; k < 3; k++)
+		{
+			palette[0][k] = float(endpoint0[k]);
+			palette[1][k] = float(endpoint1[k]);
+			palette[2][k] = float((endpoint0[k] * 2 + endpoint1[k] + 1) / 3);
+			palette[3][k] = float((endpoint0[k] + endpoint1[k] * 2 + 1) / 3);
+		}
+
+		const vec_float one = VecLoadVectorConstant<0x3F800000>();
+		const vec_float two = VecLoadVectorConstant<0x40000000>();
+		const vec_float three = VecLoadVectorConstant<0x40400000>();
+
+		vec_float error = VecFloatGetZero();
+		alignas(16) float	selection[16];
+
+		for (int32 group = 0; group < 16; group += 4)
+		{
+			vec_float red = VecLoad(&block->red[group]);
+			vec_float green = VecLoad(&block->green[group]);
+			vec_float blue = VecLoad(&block->blue[group]);
+
+			vec_float best = CalculateColorDistance(red, green, blue, palette[0]);
+			vec_float index = VecFloatGetZero();
+
+			vec_float d = CalculateColorDistance(red, green, blue, palette[1]);
+			index = VecSelect(index, one, VecMaskCmplt(d, best));
+			best = VecMin(best, d);
+
+			d = CalculateColorDistance(red, green, blue, palette[2]);
+			index = VecSelect(index, two, VecMaskCmplt(d, best));
+			best = VecMin(best, d);
+
+			d = CalculateColorDistance(red, green, blue, palette[3]);
+			index = VecSelect(index, three, VecMaskCmplt(d, best));
+			best = VecMin(best, d);
+
+			error = VecAdd(error, best);
+			VecStore(index, &selection[group]);
+		}
+
+		uint32 bits = 0;
+		for (int32 i = 0; i < 16; i++)
+		{
+			bits |= uint32(selection[i]) << (i * 2);
+		}
+
+		*indices = bits;
+
+		alignas(16) float	sum[4];
+
+		VecStore(error, sum);
+		return ((sum[0] + sum[1]) + (sum[2] + sum[3]));
+	}
+
+	bool RefineColorEndpoints(const ColorBlock *block, uint32 indices, uint32 *color0, uint32 *color1)
+	{
+		// Find the endpoints minimizing the squared error for the current assignment of texels to
+		// palette entries by solving the 2x2 normal equations of the least squares fit.
+
+		static const float weightTable[4] = {1.0F, 0.0F, 2.0F / 3.0F, 1.0F / 3.0F};
+
+		float aa = 0.0F;
+		float ab = 0.0F;
+		float bb = 0.0F;
+		float ax[3] = {0.0F, 0.0F, 0.0F};
+		float bx[3] = {0.0F, 0.0F, 0.0F};
+
+		for (int32 i = 0; i < 16; i++)
+		{
+			float a = weightTable[(indices >> (i * 2)) & 3];
+			float b = 1.0F - a;
+
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+
+			ax[0] += a * block->red[i];
+			ax[1] += a * block->green[i];
+			ax[2] += a * block->blue[i];
+			bx[0] += b * block->red[i];
+			bx[1] += b * block->green[i];
+			bx[2] += b * block->blue[i];
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (Fabs(determinant) < 1.0e-4F)
+		{
+			return (false);
+		}
+
+		float f = 1.0F / determinant;
+		*color0 = QuantizeColor((ax[0] * bb - bx[0] * ab) * f, (ax[1] * bb - bx[1] * ab) * f, (ax[2] * bb - bx[2] * ab) * f);
+		*color1 = QuantizeColor((bx[0] * aa - ax[0] * ab) * f, (bx[1] * aa - ax[1] * ab) * f, (bx[2] * aa - ax[2] * ab) * f);
+		return (true);
+	}
+
+	void EncodeColorBlock(const ColorBlock *block, uint8 *code)
+	{
+		float mean[3] = {0.0F, 0.0F, 0.0F};
+
+		for (int32 i = 0; i < 16; i++)
+		{
+			mean[0] += block->red[i];
+			mean[1] += block->green[i];
+			mean[2] += block->blue[i];
+		}
+
+		mean[0] *= 1.0F / 16.0F;
+		mean[1] *= 1.0F / 16.0F;
+		mean[2] *= 1.0F / 16.0F;
+
+		// Find the principal axis of the colors by power iteration on the covariance matrix,
+		// starting with the column of the matrix for the channel having the largest variance.
+
+		float covariance[6] = {0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F};
+		for (int32 i = 0; i < 16; i++)
+		{
+			float r = block->red[i] - mean[0];
+			float g = block->green[i] - mean[1];
+			float b = block->blue[i] - mean[2];
+
+			covariance[0] += r * r;
+			covariance[1] += r * g;
+			covariance[2] += r * b;
+			covariance[3] += g * g;
+			covariance[4] += g * b;
+			covariance[5] += b * b;
+		}
+
+		float axis[3];
+		if ((covariance[0] >= covariance[3]) && (covariance[0] >= covariance[5]))
+		{
+			axis[0] = covariance[0];
+			axis[1] = covariance[1];
+			axis[2] = covariance[2];
+		}
+		else if (covariance[3] >= covariance[5])
+		{
+			axis[0] = covariance[1];
+			axis[1] = covariance[3];
+			axis[2] = covariance[4];
+		}
+		else
+		{
+			axis[0] = covariance[2];
+			axis[1] = covariance[4];
+			axis[2] = covariance[5];
+		}
+
+		for (int32 iteration = 0; iteration < 4; iteration++)
+		{
+			float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+			float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+			float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+
+			float m = Fmax(Fmax(Fabs(x), Fabs(y)), Fabs(z));
+			if (m < 1.0e-6F)
+			{
+				break;
+			}
+
+			m = 1.0F / m;
+			axis[0] = x * m;
+			axis[1] = y * m;
+			axis[2] = z * m;
+		}
+
+		// The initial endpoints are the texels with the extreme projections onto the axis.
+
+		int32 minIndex = 0;
+		int32 maxIndex = 0;
+		float minProjection = Math::infinity;
+		float maxProjection = Math::minus_infinity;
+
+		for (int32 i = 0; i < 16; i++)
+		{
+			float p = block->red[i] * axis[0] + block->green[i] * axis[1] + block->blue[i] * axis[2];
+			if (p < minProjection)
+			{
+				minProjection = p;
+				minIndex = i;
+			}
+
+			if (p > maxProjection)
+			{
+				maxProjection = p;
+				maxIndex = i;
+			}
+		}
+
+		uint32 color0 = QuantizeColor(block->red[maxIndex], block->green[maxIndex], block->blue[maxIndex]);
+		uint32 color1 = QuantizeColor(block->red[minIndex], block->green[minIndex], block->blue[minIndex]);
+
+		uint32 indices;
+		float error = EvaluateColorBlock(block, color0, color1, &indices);
+
+		// Refine the endpoints with least squares fits as long as the error decreases.
+
+		for (int32 iteration = 0; (iteration < 2) && (error > 0.0F); iteration++)
+		{
+			uint32 refined0, refined1, refinedIndices;
+
+			if (!RefineColorEndpoints(block, indices, &refined0, &refined1))
+			{
+				break;
+			}
+
+			float refinedError = EvaluateColorBlock(block, refined0, refined1, &refinedIndices);
+			if (!(refinedError < error))
+			{
+				break;
+			}
+
+			color0 = refined0;
+			color1 = refined1;
+			indices = refinedIndices;
+			error = refinedError;
+		}
+
+		// The four-color mode requires the first endpoint to be greater than the second. Swapping
+		// the endpoints exchanges palette entries 0 with 1 and 2 with 3. Equal endpoints are decoded
+		// in the three-color mode, where only entry 0 is safe to use.
+
+		if (color0 < color1)
+		{
+			uint32 c = color0;
+			color0 = color1;
+			color1 = c;
+			indices ^= 0x55555555;
+		}
+		else if (color0 == color1)
+		{
+			indices = 0;
+		}
+
+		code[0] = uint8(color0);
+		code[1] = uint8(color0 >> 8);
+		code[2] = uint8(color1);
+		code[3] = uint8(color1 >> 8);
+		code[4] = uint8(indices);
+		code[5] = uint8(indices >> 8);
+		code[6] = uint8(indices >> 16);
+		code[7] = uint8(indices >> 24);
+	}
+
+	void EncodeChannelBlock(const float *value, uint8 *code)
+	{
+		// The endpoints are the extreme values, and the block uses the eight-value mode in which
+		// the first endpoint is greater than the second. The values are given in the range of the
+		// endpoint bytes, which is [-127, 127] for signed blocks.
+
+		float minValue = value[0];
+		float maxValue = value[0];
+		for (int32 i = 1; i < 16; i++)
+		{
+			minValue = Fmin(minValue, value[i]);
+			maxValue = Fmax(maxValue, value[i]);
+		}
+
+		code[0] = uint8(int32(maxValue));
+		code[1] = uint8(int32(minValue));
+
+		uint64 bits = 0;
+		if (maxValue > minValue)
+		{
+			// Palette entry k for k in [2, 7] is ((8 - k) * max + (k - 1) * min) / 7, so the level
+			// of a value measured from the minimum in sevenths maps to a palette entry as follows.
+
+			static const uint8 levelTable[8] = {1, 7, 6, 5, 4, 3, 2, 0};
+
+			const vec_float half = VecLoadVectorConstant<0x3F000000>();
+			float scale = 7.0F / (maxValue - minValue);
+
+			vec_float vmin = VecLoadSmearScalar(&minValue);
+			vec_float vscale = VecLoadSmearScalar(&scale);
+
+			alignas(16) float	level[16];
+
+			for (int32 group = 0; group < 16; group += 4)
+			{
+				VecStore(VecMadd(VecSub(VecLoad(&value[group]), vmin), vscale, half), &level[group]);
+			}
+
+			for (int32 i = 0; i < 16; i++)
+			{
+				bits |= uint64(levelTable[Min(int32(level[i]), 7)]) << (i * 3);
+			}
+		}
+
+		for (int32 i = 0; i < 6; i++)
+		{
+			code[i + 2] = uint8(bits >> (i * 8));
+		}
+	}
+
+	void DecodeChannelPalette(int32 value0, int32 value1, int32 minValue, int32 maxValue, int32 *palette)
+	{
+		palette[0] = value0;
+		palette[1] = value1;
+
+		if (value0 > value1)
+		{
+			for (int32 k = 1; k < 7; k++)
+			{
+				palette[k + 1] = int32(Floor(float((7 - k) * value0 + k * value1) * (1.0F / 7.0F) + 0.5F));
+			}
+		}
+		else
+		{
+			for (int32 k = 1; k < 5; k++)
+			{
+				palette[k + 1] = int32(Floor(float((5 - k) * value0 + k * value1) * (1.0F / 5.0F) + 0.5F));
+			}
+
+			palette[6] = minValue;
+			palette[7] = maxValue;
+		}
+	}
+
+	uint64 ReadChannelIndices(const uint8 *code)
+	{
+		uint64 bits = 0;
+		for (int32 i = 0; i < 6; i++)
+		{
+			bits |= uint64(code[i + 2]) << (i * 8);
+		}
+
+		return (bits);
+	}
+
+
+	// The Load functions gather the texels of the block whose upper-left corner is (x, y). Blocks
+	// at the right and bottom edges of images smaller than a multiple of four repeat the last
+	// column and row, which keeps the texels outside the image from affecting the endpoints.
+
+	void LoadColorBlock(const EncodeSurface *surface, int32 x, int32 y, ColorBlock *block, float *alpha)
+	{
+		const Color4U *image = reinterpret_cast<const Color4U *>(surface->sourceImage);
+		int32 width = surface->width;
+
+		for (int32 j = 0; j < 4; j++)
+		{
+			const Color4U *row = image + Min(y + j, surface->height - 1) * width;
+			for (int32 i = 0; i < 4; i++)
+			{
+				const Color4U& texel = row[Min(x + i, width - 1)];
+				int32 k = j * 4 + i;
+
+				block->red[k] = float(texel.red);
+				block->green[k] = float(texel.green);
+				block->blue[k] = float(texel.blue);
+				alpha[k] = float(texel.alpha);
+			}
+		}
+	}
+
+	void LoadChannelBlock(const EncodeSurface *surface, int32 pixelSize, int32 channel, bool signedFlag, int32 x, int32 y, float *value)
+	{
+		int32 width = surface->width;
+
+		for (int32 j = 0; j < 4; j++)
+		{
+			const uint8 *row = surface->sourceImage + Min(y + j, surface->height - 1) * width * pixelSize + channel;
+			for (int32 i = 0; i < 4; i++)
+			{
+				uint32 v = row[Min(x + i, width - 1) * pixelSize];
+				value[j * 4 + i] = (signedFlag) ? float(Max(int32(int8(v)), -127)) : float(v);
+			}
+		}
+	}
+
+
+	void EncodeBlockRow(const BlockEncodeData *data, const EncodeSurface *surface, int32 row)
+	{
+		int32 format = data->textureFormat;
+		int32 blockSize = ((format == TextureLayout::kFormatGammaBC1) || (format == TextureLayout::kFormatLinearBC4) || (format == TextureLayout::kFormatSignedBC4)) ? 8 : 16;
+		int32 blockCount = (surface->width + 3) >> 2;
+		bool signedFlag = (format == TextureLayout::kFormatSignedBC4) || (format == TextureLayout::kFormatSignedBC5);
+
+		uint8 *code = surface->codeImage + row * blockCount * blockSize;
+		int32 y = row * 4;
+
+		alignas(16) float	value[16];
+		ColorBlock			colorBlock;
+
+		for (int32 x = 0; x < surface->width; x += 4)
+		{
+			switch (format)
+			{
+				case TextureLayout::kFormatGammaBC1:
+
+					LoadColorBlock(surface, x, y, &colorBlock, value);
+					EncodeColorBlock(&colorBlock, code);
+					break;
+
+				case TextureLayout::kFormatGammaBC3:
+
+					LoadColorBlock(surface, x, y, &colorBlock, value);
+					EncodeChannelBlock(value, code);
+					EncodeColorBlock(&colorBlock, code + 8);
+					break;
+
+				case TextureLayout::kFormatLinearBC4:
+				case TextureLayout::kFormatSignedBC4:
+
+					LoadChannelBlock(surface, data->pixelSize, data->channelOffset, signedFlag, x, y, value);
+					EncodeChannelBlock(value, code);
+					break;
+
+				case TextureLayout::kFormatLinearBC5:
+				case TextureLayout::kFormatSignedBC5:
+
+					LoadChannelBlock(surface, data->pixelSize, data->channelOffset, signedFlag, x, y, value);
+					EncodeChannelBlock(value, code);
+					LoadChannelBlock(surface, data->pixelSize, data->channelOffset + 1, signedFlag, x, y, value);
+					EncodeChannelBlock(value, code + 8);
+					break;
+			}
+
+			code += blockSize;
+		}
+	}
+
+	void EncodeBlockBand(int32 firstRow, int32 rowCount, void *cookie)
+	{
+		const BlockEncodeData *data = static_cast<BlockEncodeData *>(cookie);
+		const EncodeSurface *surface = data->surfaceTable;
+		const EncodeSurface *lastSurface = surface + (data->surfaceCount - 1);
+
+		for (int32 row = firstRow; row < firstRow + rowCount; row++)
+		{
+			while ((surface != lastSurface) && (surface[1].firstRow <= row))
+			{
+				surface++;
+			}
+
+			if (surface->firstRow <= row)
+			{
+				EncodeBlockRow(data, surface, row - surface->firstRow);
+			}
+		}
+	}
+
+
+	uint8 *CompressImage(const Integer3D& size, int32 mipmapCount, int32 format, const uint8 *image, int32 pixelSize, int32 channelOffset, int32 threadCount)
+	{
+		// Every layer of every mipmap becomes one surface, and the block rows of all surfaces are
+		// encoded in a single pass so that the small mipmaps do not each need their own threads.
+
+		int32 layerCount = size.z;
+		int32 surfaceCount = mipmapCount * layerCount;
+		EncodeSurface *surfaceTable = new EncodeSurface[surfaceCount];
+
+		uint8 *code = new uint8[TextureLayout::CalculateImageSize(TextureLayout::kType2DArray, format, size.x, size.y, layerCount, mipmapCount)];
+		uint8 *codeImage = code;
+
+		int32 width = size.x;
+		int32 height = size.y;
+		int32 rowCount = 0;
+
+		for (int32 mipmap = 0; mipmap < mipmapCount; mipmap++)
+		{
+			uint32 codeSize = TextureLayout::CalculateImageSize(TextureLayout::kType2D, format, width, height, 1, 1);
+			for (int32 layer = 0; layer < layerCount; layer++)
+			{
+				EncodeSurface *surface = &surfaceTable[mipmap * layerCount + layer];
+
+				surface->firstRow = rowCount;
+				surface->width = width;
+				surface->height = height;
+				surface->sourceImage = image;
+				surface->codeImage = codeImage;
+
+				rowCount += (height + 3) >> 2;
+				image += width * height * pixelSize;
+				codeImage += codeSize;
+			}
+
+			width = Max(width >> 1, 1);
+			height = Max(height >> 1, 1);
+		}
+
+		BlockEncodeData		data;
+
+		data.textureFormat = format;
+		data.pixelSize = pixelSize;
+		data.channelOffset = channelOffset;
+		data.surfaceCount = surfaceCount;
+		data.surfaceTable = surfaceTable;
+
+		ExecuteBakeBands(rowCount, &EncodeBlockBand, &data, threadCount);
+
+		delete[] surfaceTable;
+		return (code);
+	}
+
+	int32 GetUncompressedPixelSize(int32 format)
+	{
+		switch (format)
+		{
+			case TextureLayout::kFormatLinearBC4:
+			case TextureLayout::kFormatSignedBC4:
+
+				return (1);
+
+			case TextureLayout::kFormatLinearBC5:
+			case TextureLayout::kFormatSignedBC5:
+
+				return (2);
+		}
+
+		return (4);
+	}
+}
+
+
+void Framework::EncodeColorBlock(const Color4U *texel, uint8 *code)
+{
+	ColorBlock		block;
+
+	for (int32 i = 0; i < 16; i++)
+	{
+		block.red[i] = float(texel[i].red);
+		block.green[i] = float(texel[i].green);
+		block.blue[i] = float(texel[i].blue);
+	}
+
+	::EncodeColorBlock(&block, code);
+}
+
+void Framework::EncodeChannelBlock(const uint8 *value, uint8 *code)
+{
+	alignas(16) float	v[16];
+
+	for (int32 i = 0; i < 16; i++)
+	{
+		v[i] = float(value[i]);
+	}
+
+	::EncodeChannelBlock(v, code);
+}
+
+void Framework::EncodeSignedChannelBlock(const int8 *value, uint8 *code)
+{
+	alignas(16) float	v[16];
+
+	for (int32 i = 0; i < 16; i++)
+	{
+		v[i] = float(Max(int32(value[i]), -127));
+	}
+
+	::EncodeChannelBlock(v, code);
+}
+
+void Framework::DecodeColorBlock(const uint8 *code, Color4U *texel)
+{
+	uint32 color0 = code[0] | (code[1] << 8);
+	uint32 color1 = code[2] | (code[3] << 8);
+	uint32 indices = code[4] | (code[5] << 8) | (code[6] << 16) | (uint32(code[7]) << 24);
+
+	int32	endpoint0[3], endpoint1[3];
+
+	ExpandColor(color0, endpoint0);
+	ExpandColor(color1, endpoint1);
+
+	int32	palette[4][4];
+
+	for (int32 k = 0; k < 3; k++)
+	{
+		palette[0][k] = endpoint0[k];
+		palette[1][k] = endpoint1[k];
+
+		if (color0 > color1)
+		{
+			palette[2][k] = (endpoint0[k] * 2 + endpoint1[k] + 1) / 3;
+			palette[3][k] = (endpoint0[k] + endpoint1[k] * 2 + 1) / 3;
+		}
+		else
+		{
+			palette[2][k] = (endpoint0[k] + endpoint1[k] + 1) >> 1;
+			palette[3][k] = 0;
+		}
+	}
+
+	// The fourth entry is transparent black in the three-color mode.
+
+	palette[0][3] = 255;
+	palette[1][3] = 255;
+	palette[2][3] = 255;
+	palette[3][3] = (color0 > color1) ? 255 : 0;
+
+	for (int32 i = 0; i < 16; i++)
+	{
+		const int32 *color = palette[(indices >> (i * 2)) & 3];
+		texel[i].Set(color[0], color[1], color[2], color[3]);
+	}
+}
+
+void Framework::DecodeChannelBlock(const uint8 *code, uint8 *value)
+{
+	int32	palette[8];
+
+	DecodeChannelPalette(code[0], code[1], 0, 255, palette);
+
+	uint64 bits = ReadChannelIndices(code);
+	for (int32 i = 0; i < 16; i++)
+	{
+		value[i] = uint8(palette[(bits >> (i * 3)) & 7]);
+	}
+}
+
+void Framework::DecodeSignedChannelBlock(const uint8 *code, int8 *value)
+{
+	int32	palette[8];
+
+	DecodeChannelPalette(Max(int32(int8(code[0])), -127), Max(int32(int8(code[1])), -127), -127, 127, palette);
+
+	uint64 bits = ReadChannelIndices(code);
+	for (int32 i = 0; i < 16; i++)
+	{
+		value[i] = int8(palette[(bits >> (i * 3)) & 7]);
+	}
+}
+
+void *Framework::CompressTextureImage(const Integer3D& size, int32 mipmapCount, int32 format, const void *image, int32 threadCount)
+{
+	return (CompressImage(size, mipmapCount, format, static_cast<const uint8 *>(image), GetUncompressedPixelSize(format), 0, threadCount));
+}
+
+void Framework::DecompressTextureImage(const Integer3D& size, int32 mipmapCount, int32 format, const void *code, void *image)
+{
+	int32 pixelSize = GetUncompressedPixelSize(format);
+	int32 layerCount = size.z;
+	int32 width = size.x;
+	int32 height = size.y;
+
+	const uint8 *block = static_cast<const uint8 *>(code);
+	uint8 *output = static_cast<uint8 *>(image);
+
+	for (int32 mipmap = 0; mipmap < mipmapCount; mipmap++)
+	{
+		for (int32 layer = 0; layer < layerCount; layer++)
+		{
+			for (int32 y = 0; y < height; y += 4)
+			{
+				for (int32 x = 0; x < width; x += 4)
+				{
+					// Decode the block into 16 texels and copy the ones inside the image.
+
+					Color4U		texel[16];
+					uint8		value[2][16];
+
+					switch (format)
+					{
+						case TextureLayout::kFormatGammaBC1:
+
+							DecodeColorBlock(block, texel);
+							block += 8;
+							break;
+
+						case TextureLayout::kFormatGammaBC3:
+
+							DecodeChannelBlock(block, value[0]);
+							DecodeColorBlock(block + 8, texel);
+							for (int32 i = 0; i < 16; i++)
+							{
+								texel[i].alpha = value[0][i];
+							}
+
+							block += 16;
+							break;
+
+						case TextureLayout::kFormatLinearBC4:
+
+							DecodeChannelBlock(block, value[0]);
+							block += 8;
+							break;
+
+						case TextureLayout::kFormatSignedBC4:
+
+							DecodeSignedChannelBlock(block, reinterpret_cast<int8 *>(value[0]));
+							block += 8;
+							break;
+
+						case TextureLayout::kFormatLinearBC5:
+
+							DecodeChannelBlock(block, value[0]);
+							DecodeChannelBlock(block + 8, value[1]);
+							block += 16;
+							break;
+
+						case TextureLayout::kFormatSignedBC5:
+
+							DecodeSignedChannelBlock(block, reinterpret_cast<int8 *>(value[0]));
+							DecodeSignedChannelBlock(block + 8, reinterpret_cast<int8 *>(value[1]));
+							block += 16;
+							break;
+					}
+
+					int32 columnCount = Min(width - x, 4);
+					int32 rowCount = Min(height - y, 4);
+
+					for (int32 j = 0; j < rowCount; j++)
+					{
+						uint8 *pixel = output + ((y + j) * width + x) * pixelSize;
+						for (int32 i = 0; i < columnCount; i++)
+						{
+							int32 k = j * 4 + i;
+
+							if (pixelSize == 4)
+							{
+								reinterpret_cast<Color4U *>(pixel)[i] = texel[k];
+							}
+							else
+							{
+								pixel[i * pixelSize] = value[0][k];
+								if (pixelSize == 2)
+								{
+									pixel[i * 2 + 1] = value[1][k];
+								}
+							}
+						}
+					}
+				}
+			}
+
+			output += width * height * pixelSize;
+		}
+
+		width = Max(width >> 1, 1);
+		height = Max(height >> 1, 1);
+	}
+}
+
+void Framework::CompressHorizonImage(const Integer3D& size, int32 mipmapCount, const Color4U *image, void **redGreenImage, void **blueAlphaImage, int32 threadCount)
+{
+	const uint8 *data = reinterpret_cast<const uint8 *>(image);
+	*redGreenImage = CompressImage(size, mipmapCount, TextureLayout::kFormatLinearBC5, data, 4, 0, threadCount);
+	*blueAlphaImage = CompressImage(size, mipmapCount, TextureLayout::kFormatLinearBC5, data, 4, 2, threadCount);
+}
+
+float Framework::CalculateImagePsnr(const void *image, const void *reference, uint32 pixelCount, int32 pixelSize, int32 channelCount, bool signedFlag)
+{
+	const uint8 *data1 = static_cast<const uint8 *>(image);
+	const uint8 *data2 = static_cast<const uint8 *>(reference);
+
+	uint64 sum = 0;
+	for (uint32 a = 0; a < pixelCount; a++)
+	{
+		for (int32 k = 0; k < channelCount; k++)
+		{
+			int32 d = (signedFlag) ? int32(int8(data1[k])) - int32(int8(data2[k])) : int32(data1[k]) - int32(data2[k]);
+			sum += d * d;
+		}
+
+		data1 += pixelSize;
+		data2 += pixelSize;
+	}
+
+	if (sum == 0)
+	{
+		return (Math::infinity);
+	}
+
+	float mse = float(sum) / float(pixelCount * channelCount);
+	return (10.0F * log10(65025.0F / mse));
+}
@@ -0,0 +1,55 @@
+#ifndef Encode_h
+#define Encode_h
+
+
+#include "Bake.h"
+
+
+namespace Framework
+{
+	// The encoder version is part of the build key stored in cooked textures. It must be
+	// incremented whenever a change to the encoders changes the blocks they produce.
+
+	enum
+	{
+		kTextureEncoderVersion		= 1
+	};
+
+
+	// The block encoders compress one 4x4 block of texels, given in rows, into the BC formats
+	// used by the compressed Texture formats. A BC1 block occupies 8 bytes, and it always uses
+	// the four-color mode, so alpha is ignored. A BC4 block also occupies 8 bytes and encodes
+	// a single channel, which is signed when the block is decoded as a snorm format. BC3 is a
+	// BC4 alpha block followed by a BC1 color block, and BC5 is a pair of BC4 blocks.
+
+	void EncodeColorBlock(const Color4U *texel, uint8 *code);
+	void EncodeChannelBlock(const uint8 *value, uint8 *code);
+	void EncodeSignedChannelBlock(const int8 *value, uint8 *code);
+
+	void DecodeColorBlock(const uint8 *code, Color4U *texel);
+	void DecodeChannelBlock(const uint8 *code, uint8 *value);
+	void DecodeSignedChannelBlock(const uint8 *code, int8 *value);
+
+	// A texture image is compressed into one of the TextureLayout::kFormat BC formats from an
+	// image with the same mipmap layout in the corresponding uncompressed format, which is Color4U
+	// for BC1 and BC3, Color1U or Color1S for BC4, and Color2U or Color2S for BC5. The z component
+	// of the size is the number of layers in each mipmap, which is 6 for a cube texture. Rows of
+	// blocks are distributed among threadCount threads as in ExecuteBakeBands(), and the result
+	// must be released with ReleaseMipmapImages().
+
+	void *CompressTextureImage(const Integer3D& size, int32 mipmapCount, int32 format, const void *image, int32 threadCount = 0);
+	void DecompressTextureImage(const Integer3D& size, int32 mipmapCount, int32 format, const void *code, void *image);
+
+	// A horizon map is compressed into two BC5 images, one holding the red and green channels and
+	// the other holding the blue and alpha channels. Both use TextureLayout::kFormatLinearBC5.
+
+	void CompressHorizonImage(const Integer3D& size, int32 mipmapCount, const Color4U *image, void **redGreenImage, void **blueAlphaImage, int32 threadCount = 0);
+
+	// The peak signal-to-noise ratio of a decompressed image is measured in decibels over the first
+	// channelCount bytes of each pixel, and it is infinite when those bytes are identical.
+
+	float CalculateImagePsnr(const void *image, const void *reference, uint32 pixelCount, int32 pixelSize, int32 channelCount, bool signedFlag = false);
+}
+
+
+#endif
@@ -16,6 +16,8 @@ using namespace Framework;
 
 
 GraphicsManager *Framework::graphicsManager = nullptr;
+ResourceManager *Framework::resourceManager = nullptr;
+UploadManager *Framework::uploadManager = nullptr;
 
 
 Framework::Buffer::Buffer(uint32 size, const void *data)
@@ -152,33 +154,67 @@ void Program::BindProgram(void)
 }
 
 
-Texture::Texture(int32 type, int32 format, int32 width, int32 height, int32 depth, int32 mipmapCount, const void *image)
+namespace
 {
-	static const GLenum targetTable[kTypeCount] =
+	const GLenum internalFormatTable[Texture::kFormatCount] =
 	{
-		GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_RECTANGLE, GL_TEXTURE_2D_MULTISAMPLE
+		GL_SRGB8_ALPHA8, GL_RGBA8, GL_RGBA8_SNORM, GL_RG8, GL_RG8_SNORM, GL_R8, GL_R8_SNORM, GL_RGBA16F, GL_RGBA16UI, GL_DEPTH_COMPONENT32F,
+		GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, GL_COMPRESSED_RED_RGTC1, GL_COMPRESSED_SIGNED_RED_RGTC1, GL_COMPRESSED_RG_RGTC2, GL_COMPRESSED_SIGNED_RG_RGTC2
 	};
 
-	static const GLenum internalFormatTable[kFormatCount] =
+	const GLenum formatTable[Texture::kFormatCount] =
 	{
-		GL_SRGB8_ALPHA8, GL_RGBA8, GL_RGBA8_SNORM, GL_RG8, GL_RG8_SNORM, GL_R8, GL_R8_SNORM, GL_RGBA16F, GL_RGBA16UI, GL_DEPTH_COMPONENT32F
+		GL_RGBA, GL_RGBA, GL_RGBA, GL_RG, GL_RG, GL_RED, GL_RED, GL_RGBA, GL_RGBA_INTEGER, GL_DEPTH_COMPONENT,
+		0, 0, 0, 0, 0, 0
 	};
 
-	static const GLenum formatTable[kFormatCount] =
+	const GLenum typeTable[Texture::kFormatCount] =
 	{
-		GL_RGBA, GL_RGBA, GL_RGBA, GL_RG, GL_RG, GL_RED, GL_RED, GL_RGBA, GL_RGBA_INTEGER, GL_DEPTH_COMPONENT
+		GL_UNSIGNED_BYTE, GL_UNSIGNED_BYTE, GL_BYTE, GL_UNSIGNED_BYTE, GL_BYTE, GL_UNSIGNED_BYTE, GL_BYTE, GL_HALF_FLOAT, GL_UNSIGNED_SHORT, GL_FLOAT,
+		0, 0, 0, 0, 0, 0
 	};
 
-	static const GLenum typeTable[kFormatCount] =
+
+	void UploadImage2D(GLuint textureObject, int32 format, int32 mipmap, int32 width, int32 height, const void *data)
 	{
-		GL_UNSIGNED_BYTE, GL_UNSIGNED_BYTE, GL_BYTE, GL_UNSIGNED_BYTE, GL_BYTE, GL_UNSIGNED_BYTE, GL_BYTE, GL_HALF_FLOAT, GL_UNSIGNED_SHORT, GL_FLOAT
-	};
+		if (Texture::CompressedFormat(format))
+		{
+			glCompressedTextureSubImage2D(textureObject, mipmap, 0, 0, width, height, internalFormatTable[format], Texture::CalculateLayerSize(format, width, height), data);
+		}
+		else
+		{
+			glTextureSubImage2D(textureObject, mipmap, 0, 0, width, height, formatTable[format], typeTable[format], data);
+		}
+	}
+
+	void UploadImage3D(GLuint textureObject, int32 format, int32 mipmap, int32 layer, int32 width, int32 height, int32 depth, const void *data)
+	{
+		if (Texture::CompressedFormat(format))
+		{
+			glCompressedTextureSubImage3D(textureObject, mipmap, 0, 0, layer, width, height, depth, internalFormatTable[format], Texture::CalculateLayerSize(format, width, height) * depth, data);
+		}
+		else
+		{
+			glTextureSubImage3D(textureObject, mipmap, 0, 0, layer, width, height, depth, formatTable[format], typeTable[format], data);
+		}
+	}
+}
+
 
-	static const int8 sizeTable[kFormatCount] =
+Texture::Texture(int32 type, int32 format, int32 width, int32 height, int32 depth, int32 mipmapCount, const void *image)
+{
+	static const GLenum targetTable[kTypeCount] =
 	{
-		4, 4, 4, 2, 2, 1, 1, 8, 8, 4
+		GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_RECTANGLE, GL_TEXTURE_2D_MULTISAMPLE
 	};
 
+	textureType = type;
+	textureFormat = format;
+	textureSize.Set(width, height, depth);
+	textureMipmapCount = mipmapCount;
+	residentMipmap = 0;
+	requestedMipmap = 0;
+
 	glCreateTextures(targetTable[type], 1, &textureObject);
 	glTextureParameteri(textureObject, GL_TEXTURE_MAX_LEVEL, mipmapCount - 1);
 
@@ -194,86 +230,150 @@ Texture::Texture(int32 type, int32 format, int32 width, int32 height, int32 dept
 		glTextureParameteri(textureObject, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	}
 
-	const char *data = static_cast<const char *>(image);
-
 	switch (type)
 	{
 		case kType2D:
 
 			glTextureStorage2D(textureObject, mipmapCount, internalFormatTable[format], width, height);
-
-			for (int32 mipmap = 0; mipmap < mipmapCount; mipmap++)
-			{
-				glTextureSubImage2D(textureObject, mipmap, 0, 0, width, height, formatTable[format], typeTable[format], data);
-				data += width * height * sizeTable[format];
-				width = Max(width >> 1, 1);
-				height = Max(height >> 1, 1);
-			}
-
 			break;
 
 		case kType3D:
+		case kType2DArray:
 
 			glTextureStorage3D(textureObject, mipmapCount, internalFormatTable[format], width, height, depth);
-
-			for (int32 mipmap = 0; mipmap < mipmapCount; mipmap++)
-			{
-				glTextureSubImage3D(textureObject, mipmap, 0, 0, 0, width, height, depth, formatTable[format], typeTable[format], data);
-				data += width * height * depth * sizeTable[format];
-				width = Max(width >> 1, 1);
-				height = Max(height >> 1, 1);
-				depth = Max(depth >> 1, 1);
-			}
-
 			break;
 
 		case kTypeCube:
 
 			glTextureStorage2D(textureObject, mipmapCount, internalFormatTable[format], width, width);
+			break;
 
-			for (int32 mipmap = 0; mipmap < mipmapCount; mipmap++)
-			{
-				for (int32 face = 0; face < 6; face++)
-				{
-					glTextureSubImage3D(textureObject, mipmap, 0, 0, face, width, width, 1, formatTable[format], typeTable[format], data);
-					data += width * width * sizeTable[format];
-				}
+		case kTypeRectangle:
 
-				width = Max(width >> 1, 1);
-			}
+			glTextureStorage2D(textureObject, 1, internalFormatTable[format], width, height);
+			textureMipmapCount = 1;
+			mipmapCount = 1;
+			break;
+
+		case kTypeMultisample:
 
+			glTextureStorage2DMultisample(textureObject, 4, internalFormatTable[format], width, height, GL_FALSE);
 			break;
+	}
+
+	// Without an image, the storage is left undefined so that it can be filled in later by the
+	// UploadManager class.
+
+	if ((image) && (type != kTypeMultisample))
+	{
+		const char *data = static_cast<const char *>(image);
+		for (int32 mipmap = 0; mipmap < mipmapCount; mipmap++)
+		{
+			UploadMipmapImage(mipmap, data);
+			data += GetMipmapImageSize(mipmap);
+		}
+	}
+}
+
+Texture::~Texture()
+{
+	glDeleteTextures(1, &textureObject);
+}
+
+uint32 Texture::GetMipmapImageSize(int32 mipmap) const
+{
+	int32 width = Max(textureSize.x >> mipmap, 1);
+	int32 height = Max(textureSize.y >> mipmap, 1);
+
+	switch (textureType)
+	{
+		case kType3D:
+
+			return (CalculateLayerSize(textureFormat, width, height) * Max(textureSize.z >> mipmap, 1));
+
+		case kTypeCube:
+
+			return (CalculateLayerSize(textureFormat, width, width) * 6);
 
 		case kType2DArray:
 
-			glTextureStorage3D(textureObject, mipmapCount, internalFormatTable[format], width, height, depth);
+			return (CalculateLayerSize(textureFormat, width, height) * textureSize.z);
+	}
 
-			for (int32 mipmap = 0; mipmap < mipmapCount; mipmap++)
-			{
-				glTextureSubImage3D(textureObject, mipmap, 0, 0, 0, width, height, depth, formatTable[format], typeTable[format], data);
-				data += width * height * depth * sizeTable[format];
-				width = Max(width >> 1, 1);
-				height = Max(height >> 1, 1);
-			}
+	return (CalculateLayerSize(textureFormat, width, height));
+}
 
-			break;
+uint32 Texture::GetMipmapImageOffset(int32 mipmap) const
+{
+	uint32 offset = 0;
+	for (int32 a = 0; a < mipmap; a++)
+	{
+		offset += GetMipmapImageSize(a);
+	}
+
+	return (offset);
+}
+
+void Texture::UploadMipmapImage(int32 mipmap, const void *image)
+{
+	// The image may be an offset into the buffer bound as GL_PIXEL_UNPACK_BUFFER.
+
+	const char *data = static_cast<const char *>(image);
 
+	int32 width = Max(textureSize.x >> mipmap, 1);
+	int32 height = Max(textureSize.y >> mipmap, 1);
+
+	switch (textureType)
+	{
+		case kType2D:
 		case kTypeRectangle:
 
-			glTextureStorage2D(textureObject, 1, internalFormatTable[format], width, height);
-			glTextureSubImage2D(textureObject, 0, 0, 0, width, height, formatTable[format], typeTable[format], data);
+			UploadImage2D(textureObject, textureFormat, mipmap, width, height, data);
 			break;
 
-		case kTypeMultisample:
+		case kType3D:
 
-			glTextureStorage2DMultisample(textureObject, 4, internalFormatTable[format], width, height, GL_FALSE);
+			UploadImage3D(textureObject, textureFormat, mipmap, 0, width, height, Max(textureSize.z >> mipmap, 1), data);
+			break;
+
+		case kTypeCube:
+
+			for (int32 face = 0; face < 6; face++)
+			{
+				UploadImage3D(textureObject, textureFormat, mipmap, face, width, width, 1, data);
+				data += CalculateLayerSize(textureFormat, width, width);
+			}
+
+			break;
+
+		case kType2DArray:
+
+			UploadImage3D(textureObject, textureFormat, mipmap, 0, width, height, textureSize.z, data);
 			break;
 	}
 }
 
-Texture::~Texture()
+void Texture::SetResidentMipmap(int32 mipmap)
 {
-	glDeleteTextures(1, &textureObject);
+	residentMipmap = mipmap;
+	glTextureParameteri(textureObject, GL_TEXTURE_BASE_LEVEL, mipmap);
+}
+
+void Texture::RequestDetail(float pixelSize)
+{
+	// The number of texels in the largest mipmap covered by one pixel is halved in each
+	// smaller mipmap, and the requested mipmap is the first one in which it is less than two.
+
+	float texelCount = float(textureSize.x) * pixelSize;
+
+	int32 mipmap = 0;
+	while ((texelCount >= 2.0F) && (mipmap < requestedMipmap))
+	{
+		texelCount *= 0.5F;
+		mipmap++;
+	}
+
+	requestedMipmap = mipmap;
 }
 
 void Texture::BindTexture(int32 unit)
@@ -281,8 +381,64 @@ void Texture::BindTexture(int32 unit)
 	glBindTextures(unit, 1, &textureObject);
 }
 
+void Texture::UpdateTexture(const Rect& rect, const void *image)
+{
+	// Upload the part of every mipmap covering the rectangle in the first mipmap. The image
+	// contains the complete mipmap chain in the same layout passed to the constructor, and the
+	// unpack state selects the subrectangle in place. All layers of an array are updated.
+
+	int32 format = textureFormat;
+	int32 width = textureSize.x;
+	int32 height = textureSize.y;
+	int32 depth = (textureType == kType2DArray) ? textureSize.z : 1;
+
+	int32 scaleX = 1;
+	int32 scaleY = 1;
+
+	const char *data = static_cast<const char *>(image);
+
+	for (int32 mipmap = 0; mipmap < textureMipmapCount; mipmap++)
+	{
+		int32 left = rect.min.x / scaleX;
+		int32 top = rect.min.y / scaleY;
+		int32 right = (rect.max.x + scaleX - 1) / scaleX;
+		int32 bottom = (rect.max.y + scaleY - 1) / scaleY;
+
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+		glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, height);
+
+		const char *texel = data + (top * width + left) * GetFormatSize(format);
+		if (textureType == kType2DArray)
+		{
+			glTextureSubImage3D(textureObject, mipmap, left, top, 0, right - left, bottom - top, depth, formatTable[format], typeTable[format], texel);
+		}
+		else
+		{
+			glTextureSubImage2D(textureObject, mipmap, left, top, right - left, bottom - top, formatTable[format], typeTable[format], texel);
+		}
+
+		data += width * height * depth * GetFormatSize(format);
+
+		if (width != 1)
+		{
+			width >>= 1;
+			scaleX <<= 1;
+		}
+
+		if (height != 1)
+		{
+			height >>= 1;
+			scaleY <<= 1;
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+}
+
 
-Font::Font(const char *name) : fontFile(name)
+
+Font::Font(const char *name) : fontFile(name, kFileMapped)
 {
 	fontHeader = Slug::GetFontHeader(fontFile.GetData());
 
@@ -309,6 +465,468 @@ Font::~Font()
 }
 
 
+ResourceManager::Resource::Resource(const char *name, Shared *object) : resourceName(name)
+{
+	resourceObject = object;
+	object->Retain();
+}
+
+ResourceManager::Resource::~Resource()
+{
+	resourceObject->Release();
+}
+
+
+ResourceManager::ResourceManager() : textureTable(32, 4), programTable(16, 4)
+{
+	textureHitCount = 0;
+	textureMissCount = 0;
+	programHitCount = 0;
+	programMissCount = 0;
+}
+
+ResourceManager::~ResourceManager()
+{
+	// The hash tables delete their resources, which releases the references held by the manager.
+}
+
+Shared *ResourceManager::FindResource(const HashTable<Resource> *table, const char *name)
+{
+	const Resource *resource = table->FindHashTableElement(String<>(name));
+	if (resource)
+	{
+		Shared *object = resource->GetObject();
+		object->Retain();
+		return (object);
+	}
+
+	return (nullptr);
+}
+
+int32 ResourceManager::PurgeTable(HashTable<Resource> *table)
+{
+	int32 purgeCount = 0;
+
+	int32 bucketCount = table->GetBucketCount();
+	for (int32 a = 0; a < bucketCount; a++)
+	{
+		Resource *resource = table->GetFirstBucketElement(a);
+		while (resource)
+		{
+			Resource *next = resource->GetNextBucketElement();
+
+			if (resource->GetObject()->GetReferenceCount() == 1)
+			{
+				delete resource;
+				purgeCount++;
+			}
+
+			resource = next;
+		}
+	}
+
+	return (purgeCount);
+}
+
+Texture *ResourceManager::FindTexture(const char *name)
+{
+	Texture *texture = static_cast<Texture *>(FindResource(&textureTable, name));
+	if (texture)
+	{
+		textureHitCount++;
+	}
+	else
+	{
+		textureMissCount++;
+	}
+
+	return (texture);
+}
+
+void ResourceManager::AddTexture(const char *name, Texture *texture)
+{
+	textureTable.InsertHashTableElement(new Resource(name, texture));
+}
+
+Program *ResourceManager::FindProgram(const char *name)
+{
+	Program *program = static_cast<Program *>(FindResource(&programTable, name));
+	if (program)
+	{
+		programHitCount++;
+	}
+	else
+	{
+		programMissCount++;
+	}
+
+	return (program);
+}
+
+void ResourceManager::AddProgram(const char *name, Program *program)
+{
+	programTable.InsertHashTableElement(new Resource(name, program));
+}
+
+Program *ResourceManager::GetProgram(const char *vertexName, const char *fragmentName)
+{
+	String<> name(vertexName);
+	name += ", ";
+	name += fragmentName;
+
+	Program *program = FindProgram(name);
+	if (!program)
+	{
+		File vertexShader(vertexName);
+		File fragmentShader(fragmentName);
+
+		const char *vertexString = vertexShader.GetData();
+		const char *fragmentString = fragmentShader.GetData();
+		program = new Program(1, &vertexString, 1, &fragmentString);
+		AddProgram(name, program);
+	}
+
+	return (program);
+}
+
+int32 ResourceManager::PurgeUnusedResources(void)
+{
+	return (PurgeTable(&textureTable) + PurgeTable(&programTable));
+}
+
+void ResourceManager::OutputStatistics(void) const
+{
+	String<> string("Resources: ");
+	string += textureTable.GetHashTableElementCount();
+	string += " textures, ";
+	string += textureHitCount;
+	string += " hits, ";
+	string += textureMissCount;
+	string += " misses; ";
+	string += programTable.GetHashTableElementCount();
+	string += " programs, ";
+	string += programHitCount;
+	string += " hits, ";
+	string += programMissCount;
+	string += " misses\n";
+	OutputDebugStringA(string);
+}
+
+
+TextureArrayBuilder::TextureArrayBuilder(int32 format, int32 width, int32 height, int32 mipmapCount)
+{
+	arrayFormat = format;
+	arraySize.Set(width, height);
+	arrayMipmapCount = mipmapCount;
+}
+
+int32 TextureArrayBuilder::AddLayer(const void *image)
+{
+	int32 layer = layerImage.GetArrayElementCount();
+	layerImage.AppendArrayElement(image);
+	return (layer);
+}
+
+Texture *TextureArrayBuilder::BuildTexture(void) const
+{
+	// The images hold one mipmap chain each, but an array image holds every layer of each
+	// mipmap before the next mipmap, so the mipmaps are interleaved here.
+
+	int32 layerCount = layerImage.GetArrayElementCount();
+	uint32 imageSize = Texture::CalculateImageSize(Texture::kType2DArray, arrayFormat, arraySize.x, arraySize.y, layerCount, arrayMipmapCount);
+	char *image = new char[imageSize];
+
+	char *data = image;
+	uint32 layerOffset = 0;
+	int32 width = arraySize.x;
+	int32 height = arraySize.y;
+
+	for (int32 mipmap = 0; mipmap < arrayMipmapCount; mipmap++)
+	{
+		uint32 size = Texture::CalculateLayerSize(arrayFormat, width, height);
+		for (int32 layer = 0; layer < layerCount; layer++)
+		{
+			Terathon::CopyMemory(static_cast<const char *>(layerImage[layer]) + layerOffset, data, size);
+			data += size;
+		}
+
+		layerOffset += size;
+		width = Max(width >> 1, 1);
+		height = Max(height >> 1, 1);
+	}
+
+	Texture		*texture;
+
+	if (uploadManager)
+	{
+		texture = new Texture(Texture::kType2DArray, arrayFormat, arraySize.x, arraySize.y, layerCount, arrayMipmapCount, nullptr);
+		uploadManager->UploadTexture(texture, image, &ReleaseMipmapImages, image);
+	}
+	else
+	{
+		texture = new Texture(Texture::kType2DArray, arrayFormat, arraySize.x, arraySize.y, layerCount, arrayMipmapCount, image);
+		ReleaseMipmapImages(image);
+	}
+
+	return (texture);
+}
+
+
+UploadManager::UploadManager(uint32 size, uint32 budget)
+{
+	static const GLbitfield storageFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	ringSize = size & ~(kUploadAlignment - 1);
+	ringHead = 0;
+	ringUsedSize = 0;
+
+	frameBudget = budget;
+	uploadedSize = 0;
+
+	glCreateBuffers(1, &bufferObject);
+	glNamedBufferStorage(bufferObject, ringSize, nullptr, storageFlags);
+	ringStorage = static_cast<char *>(glMapNamedBufferRange(bufferObject, 0, ringSize, storageFlags));
+}
+
+UploadManager::~UploadManager()
+{
+	for (;;)
+	{
+		UploadFence *fence = fenceList.GetFirstListElement();
+		if (!fence)
+		{
+			break;
+		}
+
+		glDeleteSync(fence->fenceSync);
+
+		for (const UploadLevel& level : fence->levelArray)
+		{
+			level.texture->Release();
+		}
+
+		delete fence;
+	}
+
+	for (;;)
+	{
+		UploadJob *job = jobList.GetFirstListElement();
+		if (!job)
+		{
+			break;
+		}
+
+		FinishJob(job);
+	}
+
+	glUnmapNamedBuffer(bufferObject);
+	glDeleteBuffers(1, &bufferObject);
+}
+
+void UploadManager::FinishJob(UploadJob *job)
+{
+	if (job->releaseFunction)
+	{
+		(*job->releaseFunction)(job->releaseCookie);
+	}
+
+	job->texture->Release();
+	delete job;
+}
+
+bool UploadManager::AllocateRing(uint32 size, uint32 *offset)
+{
+	// Space is allocated in order around the ring, and it is freed in the same order as fences
+	// are signaled. An allocation that does not fit before the end of the ring starts over at
+	// the beginning, and the space skipped at the end is freed along with it.
+
+	size = (size + (kUploadAlignment - 1)) & ~(kUploadAlignment - 1);
+
+	uint32 head = ringHead;
+	uint32 skipSize = 0;
+
+	if (head + size > ringSize)
+	{
+		skipSize = ringSize - head;
+		head = 0;
+	}
+
+	if (ringUsedSize + skipSize + size > ringSize)
+	{
+		return (false);
+	}
+
+	*offset = head;
+	ringHead = head + size;
+	ringUsedSize += skipSize + size;
+	return (true);
+}
+
+bool UploadManager::StageMipmap(UploadJob *job, UploadFence *fence, uint32 *frameSize)
+{
+	Texture *texture = job->texture;
+	int32 mipmap = job->mipmapIndex;
+	uint32 size = texture->GetMipmapImageSize(mipmap);
+
+	// The first mipmap staged in a frame is allowed to exceed the budget so that a large
+	// mipmap cannot be postponed forever.
+
+	if ((*frameSize != 0) && (*frameSize + size > frameBudget))
+	{
+		return (false);
+	}
+
+	const char *data = job->imageData + texture->GetMipmapImageOffset(mipmap);
+
+	if (size <= ringSize)
+	{
+		uint32		offset;
+
+		if (!AllocateRing(size, &offset))
+		{
+			return (false);
+		}
+
+		Terathon::CopyMemory(data, ringStorage + offset, size);
+		texture->UploadMipmapImage(mipmap, reinterpret_cast<const void *>(machine_address(offset)));
+	}
+	else
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		texture->UploadMipmapImage(mipmap, data);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferObject);
+	}
+
+	*frameSize += size;
+
+	texture->Retain();
+	fence->levelArray.AppendArrayElement(UploadLevel{texture, mipmap});
+
+	if (--job->mipmapIndex < 0)
+	{
+		FinishJob(job);
+	}
+
+	return (true);
+}
+
+void UploadManager::RetireFences(void)
+{
+	for (;;)
+	{
+		UploadFence *fence = fenceList.GetFirstListElement();
+		if (!fence)
+		{
+			break;
+		}
+
+		GLenum status = glClientWaitSync(fence->fenceSync, 0, 0);
+		if ((status != GL_ALREADY_SIGNALED) && (status != GL_CONDITION_SATISFIED))
+		{
+			break;
+		}
+
+		glDeleteSync(fence->fenceSync);
+		ringUsedSize -= fence->ringSize;
+
+		for (const UploadLevel& level : fence->levelArray)
+		{
+			Texture *texture = level.texture;
+			if (level.mipmapIndex < texture->residentMipmap)
+			{
+				texture->SetResidentMipmap(level.mipmapIndex);
+			}
+
+			texture->Release();
+		}
+
+		delete fence;
+	}
+
+	if (ringUsedSize == 0)
+	{
+		ringHead = 0;
+	}
+}
+
+void UploadManager::UploadTexture(Texture *texture, const void *image, UploadReleaseFunction *releaseFunction, void *releaseCookie)
+{
+	int32 mipmapCount = texture->textureMipmapCount;
+
+	texture->Retain();
+	texture->residentMipmap = mipmapCount;
+	texture->requestedMipmap = mipmapCount - 1;
+
+	UploadJob *job = new UploadJob;
+	job->texture = texture;
+	job->imageData = static_cast<const char *>(image);
+	job->mipmapIndex = mipmapCount - 1;
+	job->releaseFunction = releaseFunction;
+	job->releaseCookie = releaseCookie;
+
+	jobList.AppendListElement(job);
+}
+
+void UploadManager::ProcessUploads(void)
+{
+	RetireFences();
+
+	if (jobList.Empty())
+	{
+		return;
+	}
+
+	UploadFence *fence = new UploadFence;
+	uint32 previousUsedSize = ringUsedSize;
+	uint32 frameSize = 0;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, bufferObject);
+
+	// Each round stages the next mipmap of every texture whose requested mipmap has not been
+	// reached, and rounds continue until nothing more is requested or staging has to stop.
+
+	bool stagedFlag = true;
+	while (stagedFlag)
+	{
+		stagedFlag = false;
+
+		UploadJob *job = jobList.GetFirstListElement();
+		while (job)
+		{
+			UploadJob *next = job->GetNextListElement();
+
+			if (job->mipmapIndex >= job->texture->requestedMipmap)
+			{
+				if (!StageMipmap(job, fence, &frameSize))
+				{
+					stagedFlag = false;
+					break;
+				}
+
+				stagedFlag = true;
+			}
+
+			job = next;
+		}
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (frameSize != 0)
+	{
+		fence->fenceSync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		fence->ringSize = ringUsedSize - previousUsedSize;
+		fenceList.AppendListElement(fence);
+
+		uploadedSize += frameSize;
+	}
+	else
+	{
+		delete fence;
+	}
+}
+
+
 Framebuffer::Framebuffer(const Texture *colorTexture, const Texture *depthTexture)
 {
 	glCreateFramebuffers(1, &framebufferObject);
@@ -425,6 +1043,14 @@ void Renderable::Render(int32 programIndex)
 		return;
 	}
 
+	for (int32 a = 0; a < textureCount; a++)
+	{
+		if (!renderableTexture[a]->GetReadyFlag())
+		{
+			return;
+		}
+	}
+
 	glBlendFunc(blendSrcTable[programIndex][blendMode], blendDstTable[programIndex][blendMode]);
 	glDepthMask(depthWriteFlag);
 
@@ -647,7 +1273,8 @@ void GraphicsManager::InitializeOpenGL(void)
 	
 	GLGETPROC(glCreateBuffers);					GLGETPROC(glDeleteBuffers);					GLGETPROC(glBindBuffer);
 	GLGETPROC(glBindBufferBase);				GLGETPROC(glNamedBufferData);				GLGETPROC(glNamedBufferSubData);
-	GLGETPROC(glMapNamedBuffer);				GLGETPROC(glUnmapNamedBuffer);
+	GLGETPROC(glMapNamedBuffer);				GLGETPROC(glUnmapNamedBuffer);				GLGETPROC(glNamedBufferStorage);
+	GLGETPROC(glMapNamedBufferRange);
 
 	GLGETPROC(glCreateVertexArrays);			GLGETPROC(glDeleteVertexArrays);			GLGETPROC(glBindVertexArray);
 	GLGETPROC(glEnableVertexArrayAttrib);		GLGETPROC(glDisableVertexArrayAttrib);		GLGETPROC(glVertexArrayAttribFormat);
@@ -672,6 +1299,8 @@ void GraphicsManager::InitializeOpenGL(void)
 	GLGETPROC(glGenQueries);					GLGETPROC(glDeleteQueries);					GLGETPROC(glBeginQuery);
 	GLGETPROC(glEndQuery);						GLGETPROC(glGetQueryObjectui64v);
 
+	GLGETPROC(glFenceSync);						GLGETPROC(glDeleteSync);					GLGETPROC(glClientWaitSync);
+
 	// Set up the framebuffer storage for color and depth.
 
 	colorTexture = new Texture(Texture::kTypeMultisample, Texture::kFormatGammaRgba, screenWidth, screenHeight, 1, 1, nullptr);
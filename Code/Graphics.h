@@ -4,6 +4,8 @@
 
 #include "Base.h"
 
+#include <gl/gl.h>
+
 
 using namespace Terathon;
 
@@ -14,14 +16,22 @@ using namespace Terathon;
 #define GL_MIN									0x8007
 #define GL_MAX									0x8008
 #define GL_TEXTURE_3D							0x806F
+#define GL_UNPACK_IMAGE_HEIGHT					0x806E
 #define GL_TEXTURE_CUBE_MAP						0x8513
 #define GL_TEXTURE_2D_ARRAY						0x8C1A
 #define GL_TEXTURE_RECTANGLE					0x84F5
 #define GL_TEXTURE_2D_MULTISAMPLE				0x9100
 #define GL_COMPARE_REF_DEPTH_TO_TEXTURE			0x884E
+#define GL_TEXTURE_BASE_LEVEL					0x813C
 #define GL_TEXTURE_MAX_LEVEL					0x813D
 #define GL_TEXTURE_MAX_ANISOTROPY				0x84FE
 #define GL_SRGB8_ALPHA8							0x8C43
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT		0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT	0x8C4F
+#define GL_COMPRESSED_RED_RGTC1					0x8DBB
+#define GL_COMPRESSED_SIGNED_RED_RGTC1			0x8DBC
+#define GL_COMPRESSED_RG_RGTC2					0x8DBD
+#define GL_COMPRESSED_SIGNED_RG_RGTC2			0x8DBE
 #define GL_RGBA8_SNORM							0x8F97
 #define GL_RG									0x8227
 #define GL_RG8									0x822B
@@ -47,8 +57,16 @@ using namespace Terathon;
 #define GL_ARRAY_BUFFER							0x8892
 #define GL_ELEMENT_ARRAY_BUFFER					0x8893
 #define GL_UNIFORM_BUFFER						0x8A11
+#define GL_PIXEL_UNPACK_BUFFER					0x88EC
 #define GL_STATIC_DRAW							0x88E4
 #define GL_WRITE_ONLY							0x88B9
+#define GL_MAP_WRITE_BIT						0x0002
+#define GL_MAP_PERSISTENT_BIT					0x0040
+#define GL_MAP_COHERENT_BIT						0x0080
+#define GL_SYNC_GPU_COMMANDS_COMPLETE			0x9117
+#define GL_ALREADY_SIGNALED						0x911A
+#define GL_TIMEOUT_EXPIRED						0x911B
+#define GL_CONDITION_SATISFIED					0x911C
 #define GL_LOWER_LEFT							0x8CA1
 #define GL_UPPER_LEFT							0x8CA2
 #define GL_NEGATIVE_ONE_TO_ONE					0x935E
@@ -76,6 +94,7 @@ typedef char			GLchar;
 typedef ptrdiff_t		GLintptr;
 typedef ptrdiff_t		GLsizeiptr;
 typedef uint64			GLuint64;
+typedef struct __GLsync	*GLsync;
 
 // Declare the GL functions we need that aren't in opengl32.lib.
 // The actual storage is defined at the top of Graphics.cpp.
@@ -255,47 +274,63 @@ namespace Framework
 	};
 
 
-	class Texture : public Shared
+	class Texture : public Shared, public TextureLayout
 	{
 		friend class Framebuffer;
+		friend class UploadManager;
 
 		private:
 
 			GLuint			textureObject;
 
+			int32			textureType;
+			int32			textureFormat;
+			Integer3D		textureSize;
+			int32			textureMipmapCount;
+			int32			residentMipmap;
+			int32			requestedMipmap;
+
 			~Texture();
 
+			uint32 GetMipmapImageSize(int32 mipmap) const;
+			uint32 GetMipmapImageOffset(int32 mipmap) const;
+			void UploadMipmapImage(int32 mipmap, const void *image);
+
+			void SetResidentMipmap(int32 mipmap);
+
 		public:
 
-			enum
+			// A texture created with a null image has storage for all of its mipmaps, but their contents
+			// are undefined until an image is uploaded. While the UploadManager is uploading the image,
+			// only the mipmaps from the resident one to the smallest can be sampled, and the ready flag
+			// is clear until the smallest mipmap has arrived. Geometry using a texture that is not ready
+			// is not rendered.
+
+			Texture(int32 type, int32 format, int32 width, int32 height, int32 depth, int32 mipmapCount, const void *image);
+
+			bool GetReadyFlag(void) const
 			{
-				kType2D,
-				kType3D,
-				kTypeCube,
-				kType2DArray,
-				kTypeRectangle,
-				kTypeMultisample,
-				kTypeCount
-			};
+				return (residentMipmap < textureMipmapCount);
+			}
 
-			enum
+			int32 GetResidentMipmap(void) const
 			{
-				kFormatGammaRgba,
-				kFormatLinearRgba,
-				kFormatSignedRgba,
-				kFormatLinearRedGreen,
-				kFormatSignedRedGreen,
-				kFormatLinearRed,
-				kFormatSignedRed,
-				kFormatFloat16Rgba,
-				kFormatUint16Rgba,
-				kFormatDepth,
-				kFormatCount
-			};
+				return (residentMipmap);
+			}
 
-			Texture(int32 type, int32 format, int32 width, int32 height, int32 depth, int32 mipmapCount, const void *image);
+			int32 GetRequestedMipmap(void) const
+			{
+				return (requestedMipmap);
+			}
+
+			// RequestDetail() asks for the mipmap in which one texel is no larger than a screen pixel
+			// covering pixelSize units of texture coordinates. Requests only ever make the requested
+			// mipmap larger, and the UploadManager does not upload mipmaps larger than the request.
+
+			void RequestDetail(float pixelSize);
 
 			void BindTexture(int32 unit);
+			void UpdateTexture(const Rect& rect, const void *image);
 	};
 
 
@@ -332,6 +367,245 @@ namespace Framework
 	};
 
 
+	// The ResourceManager class keeps one reference to every texture and program registered with it,
+	// so that builders asking for the same resource share a single object on the GPU. Resources are
+	// identified by a name that combines the file path with any parameters affecting creation. The
+	// Find functions return a resource with an added reference that the caller must release, or
+	// nullptr if it has not been created yet.
+
+	class ResourceManager
+	{
+		private:
+
+			class Resource : public HashTableElement<Resource>
+			{
+				private:
+
+					String<>		resourceName;
+					Shared			*resourceObject;
+
+				public:
+
+					typedef String<> KeyType;
+
+					Resource(const char *name, Shared *object);
+					~Resource();
+
+					const KeyType& GetKey(void) const
+					{
+						return (resourceName);
+					}
+
+					Shared *GetObject(void) const
+					{
+						return (resourceObject);
+					}
+
+					static uint32 Hash(const KeyType& key)
+					{
+						return (Text::Hash(key));
+					}
+			};
+
+			HashTable<Resource>		textureTable;
+			HashTable<Resource>		programTable;
+
+			int32					textureHitCount;
+			int32					textureMissCount;
+			int32					programHitCount;
+			int32					programMissCount;
+
+			static Shared *FindResource(const HashTable<Resource> *table, const char *name);
+			static int32 PurgeTable(HashTable<Resource> *table);
+
+		public:
+
+			ResourceManager();
+			~ResourceManager();
+
+			int32 GetTextureHitCount(void) const
+			{
+				return (textureHitCount);
+			}
+
+			int32 GetTextureMissCount(void) const
+			{
+				return (textureMissCount);
+			}
+
+			int32 GetProgramHitCount(void) const
+			{
+				return (programHitCount);
+			}
+
+			int32 GetProgramMissCount(void) const
+			{
+				return (programMissCount);
+			}
+
+			Texture *FindTexture(const char *name);
+			void AddTexture(const char *name, Texture *texture);
+
+			Program *FindProgram(const char *name);
+			void AddProgram(const char *name, Program *program);
+
+			// GetProgram() returns the program built from a pair of shader files, loading and
+			// compiling them only if the pair has not been requested before.
+
+			Program *GetProgram(const char *vertexName, const char *fragmentName);
+
+			// PurgeUnusedResources() releases every resource referenced only by the manager and
+			// returns the number released.
+
+			int32 PurgeUnusedResources(void);
+			void OutputStatistics(void) const;
+	};
+
+
+	// The TextureArrayBuilder class packs the images of 2D textures having the same format, size,
+	// and mipmap count into the layers of a single kType2DArray texture, so that geometries using
+	// different images can share one texture binding and select a layer in their shaders. The
+	// images must remain valid until BuildTexture() is called. If there is an UploadManager, the
+	// array texture is uploaded through it.
+
+	class TextureArrayBuilder
+	{
+		private:
+
+			int32					arrayFormat;
+			Integer2D				arraySize;
+			int32					arrayMipmapCount;
+
+			Array<const void *>		layerImage;
+
+		public:
+
+			TextureArrayBuilder(int32 format, int32 width, int32 height, int32 mipmapCount);
+
+			int32 GetLayerCount(void) const
+			{
+				return (layerImage.GetArrayElementCount());
+			}
+
+			bool LayoutMatches(int32 format, int32 width, int32 height, int32 mipmapCount) const
+			{
+				return ((format == arrayFormat) && (width == arraySize.x) && (height == arraySize.y) && (mipmapCount == arrayMipmapCount));
+			}
+
+			// AddLayer() returns the index of the layer holding the image, which must have the
+			// layout passed to the constructor.
+
+			int32 AddLayer(const void *image);
+			Texture *BuildTexture(void) const;
+	};
+
+
+	// The UploadManager class copies texture images into a ring of persistently mapped memory
+	// bound as the pixel unpack buffer, so the driver can transfer them to the GPU without stalling
+	// the thread that issues the uploads. ProcessUploads() is called once per frame, and it stages
+	// whole mipmaps until the frame budget is spent or the ring is full. A fence is inserted after
+	// each frame's uploads, and the ring space they used is reclaimed when the fence is signaled.
+	// A mipmap larger than the ring is uploaded directly from the image.
+	//
+	// Mipmaps are uploaded from the smallest to the largest, and a round of uploads takes one
+	// mipmap from every texture, so all textures become usable at low resolution before any of
+	// them receives detail. When the fence following a mipmap is signaled, the texture's base
+	// level is lowered to that mipmap. Mipmaps larger than the one requested for a texture are
+	// held back until rendering asks for more detail.
+
+	typedef void UploadReleaseFunction(void *cookie);
+
+	class UploadManager
+	{
+		private:
+
+			enum
+			{
+				kUploadAlignment = 16
+			};
+
+			struct UploadJob : public ListElement<UploadJob>
+			{
+				Texture						*texture;
+				const char					*imageData;
+				int32						mipmapIndex;
+
+				UploadReleaseFunction		*releaseFunction;
+				void						*releaseCookie;
+			};
+
+			struct UploadLevel
+			{
+				Texture						*texture;
+				int32						mipmapIndex;
+			};
+
+			struct UploadFence : public ListElement<UploadFence>
+			{
+				GLsync						fenceSync;
+				uint32						ringSize;
+				Array<UploadLevel>			levelArray;
+			};
+
+			GLuint					bufferObject;
+			char					*ringStorage;
+			uint32					ringSize;
+			uint32					ringHead;
+			uint32					ringUsedSize;
+
+			uint32					frameBudget;
+			uint32					uploadedSize;
+
+			List<UploadJob>			jobList;
+			List<UploadFence>		fenceList;
+
+			static void FinishJob(UploadJob *job);
+
+			bool AllocateRing(uint32 size, uint32 *offset);
+			bool StageMipmap(UploadJob *job, UploadFence *fence, uint32 *frameSize);
+			void RetireFences(void);
+
+		public:
+
+			UploadManager(uint32 size, uint32 budget);
+			~UploadManager();
+
+			uint32 GetFrameBudget(void) const
+			{
+				return (frameBudget);
+			}
+
+			void SetFrameBudget(uint32 budget)
+			{
+				frameBudget = budget;
+			}
+
+			uint32 GetRingUsedSize(void) const
+			{
+				return (ringUsedSize);
+			}
+
+			uint32 GetUploadedSize(void) const
+			{
+				return (uploadedSize);
+			}
+
+			bool UploadsPending(void) const
+			{
+				return ((!jobList.Empty()) || (!fenceList.Empty()));
+			}
+
+			// UploadTexture() takes a texture created with a null image and queues every mipmap in
+			// the image for upload. Only the smallest mipmap is requested at first. The image must
+			// remain valid until the release function is called with the cookie, which happens when
+			// the largest mipmap has been copied into the ring.
+
+			void UploadTexture(Texture *texture, const void *image, UploadReleaseFunction *releaseFunction = nullptr, void *releaseCookie = nullptr);
+
+			void ProcessUploads(void);
+	};
+
+
 	class Framebuffer
 	{
 		friend class GraphicsManager;
@@ -471,6 +745,17 @@ namespace Framework
 				texture->Retain();
 			}
 
+			// RequestTextureDetail() passes the size of a screen pixel in texture coordinates to
+			// every texture used by the renderable.
+
+			void RequestTextureDetail(float pixelSize)
+			{
+				for (int32 a = 0; a < textureCount; a++)
+				{
+					renderableTexture[a]->RequestDetail(pixelSize);
+				}
+			}
+
 			void Render(int32 programIndex);
 	};
 
@@ -534,6 +819,8 @@ namespace Framework
 
 
 	extern GraphicsManager *graphicsManager;
+	extern ResourceManager *resourceManager;
+	extern UploadManager *uploadManager;
 }
 
 
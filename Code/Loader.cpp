@@ -0,0 +1,270 @@
+#include "Loader.h"
+
+
+using namespace Framework;
+
+
+FileLoader *Framework::fileLoader = nullptr;
+
+
+LoadRequest::LoadRequest(const char *name, uint32 flags)
+{
+	fileName = name;
+	fileFlags = flags;
+
+	loadPriority = kLoadPriorityNormal;
+	loadState = kLoadPending;
+	cancelFlag = false;
+	immediateCompletionFlag = false;
+}
+
+LoadRequest::~LoadRequest()
+{
+}
+
+
+FileLoader::FileLoader(int32 threadCount)
+{
+	exitFlag = false;
+
+	loaderCount = Max(threadCount, 1);
+	loaderThread = new Thread *[loaderCount];
+	for (int32 a = 0; a < loaderCount; a++)
+	{
+		loaderThread[a] = new Thread(&LoaderThread, this);
+	}
+}
+
+FileLoader::~FileLoader()
+{
+	loaderMutex.Acquire();
+	exitFlag = true;
+	loaderMutex.Release();
+	pendingCondition.WakeAll();
+
+	for (int32 a = 0; a < loaderCount; a++)
+	{
+		delete loaderThread[a];
+	}
+
+	delete[] loaderThread;
+
+	// Requests that were never read, or whose completions were never dispatched, are cancelled
+	// without invoking their completion callbacks.
+
+	for (int32 a = 0; a <= kLoadPriorityCount; a++)
+	{
+		List<LoadRequest> *list = (a < kLoadPriorityCount) ? &pendingList[a] : &completedList;
+		for (;;)
+		{
+			LoadRequest *request = list->GetFirstListElement();
+			if (!request)
+			{
+				break;
+			}
+
+			list->RemoveListElement(request);
+			request->loadState = kLoadCancelled;
+			request->Release();
+		}
+	}
+}
+
+void FileLoader::CompleteLoad(LoadRequest *request)
+{
+	request->HandleCompletion();
+	request->Release();
+}
+
+void FileLoader::LoaderThread(void *cookie)
+{
+	FileLoader *loader = static_cast<FileLoader *>(cookie);
+
+	for (;;)
+	{
+		LoadRequest		*request;
+
+		loader->loaderMutex.Acquire();
+
+		for (;;)
+		{
+			request = nullptr;
+			if (loader->exitFlag)
+			{
+				break;
+			}
+
+			for (int32 a = kLoadPriorityCount - 1; a >= 0; a--)
+			{
+				request = loader->pendingList[a].GetFirstListElement();
+				if (request)
+				{
+					loader->pendingList[a].RemoveListElement(request);
+					request->loadState = kLoadReading;
+					break;
+				}
+			}
+
+			if (request)
+			{
+				break;
+			}
+
+			loader->pendingCondition.Wait(&loader->loaderMutex);
+		}
+
+		loader->loaderMutex.Release();
+
+		if (!request)
+		{
+			break;
+		}
+
+		bool success = request->loadFile.Load(request->fileName, request->fileFlags);
+
+		loader->loaderMutex.Acquire();
+
+		// Once a request is in the completed list, another thread may dispatch and release it,
+		// so it is not accessed again here after the mutex has been released.
+
+		bool cancelled = request->cancelFlag;
+		bool immediate = false;
+
+		if (cancelled)
+		{
+			request->loadState = kLoadCancelled;
+		}
+		else
+		{
+			request->loadState = (success) ? kLoadComplete : kLoadFailed;
+			immediate = request->immediateCompletionFlag;
+			if (!immediate)
+			{
+				loader->completedList.AppendListElement(request);
+			}
+		}
+
+		loader->loaderMutex.Release();
+		loader->completedCondition.WakeAll();
+
+		if (immediate)
+		{
+			loader->CompleteLoad(request);
+		}
+		else if (cancelled)
+		{
+			request->Release();
+		}
+	}
+}
+
+void FileLoader::LoadFile(LoadRequest *request)
+{
+	request->Retain();
+	request->loadState = kLoadPending;
+	request->cancelFlag = false;
+
+	loaderMutex.Acquire();
+	pendingList[Min(Max(request->loadPriority, 0), kLoadPriorityCount - 1)].AppendListElement(request);
+	loaderMutex.Release();
+
+	pendingCondition.Wake();
+}
+
+bool FileLoader::CancelLoad(LoadRequest *request)
+{
+	bool	cancelled = false;
+	bool	release = false;
+
+	loaderMutex.Acquire();
+
+	int32 state = request->loadState;
+	if (state == kLoadReading)
+	{
+		// The read can't be interrupted, so the loader thread cancels the request when it finishes.
+
+		request->cancelFlag = true;
+		cancelled = true;
+	}
+	else if ((state == kLoadPending) || (request->GetOwningList() == &completedList))
+	{
+		request->Detach();
+		request->loadState = kLoadCancelled;
+		cancelled = true;
+		release = true;
+	}
+
+	loaderMutex.Release();
+
+	if (release)
+	{
+		completedCondition.WakeAll();
+		request->Release();
+	}
+
+	return (cancelled);
+}
+
+bool FileLoader::WaitForLoad(LoadRequest *request)
+{
+	int32	state;
+
+	loaderMutex.Acquire();
+
+	// A pending request is moved to the front of the highest priority so that the caller
+	// doesn't wait for other files to be read first.
+
+	if (request->loadState == kLoadPending)
+	{
+		pendingList[kLoadPriorityHigh].PrependListElement(request);
+	}
+
+	for (;;)
+	{
+		state = request->loadState;
+		if ((state != kLoadPending) && (state != kLoadReading))
+		{
+			break;
+		}
+
+		completedCondition.Wait(&loaderMutex);
+	}
+
+	bool complete = (request->GetOwningList() == &completedList);
+	if (complete)
+	{
+		completedList.RemoveListElement(request);
+	}
+
+	loaderMutex.Release();
+
+	if (complete)
+	{
+		CompleteLoad(request);
+	}
+
+	return (state == kLoadComplete);
+}
+
+void FileLoader::DispatchCompletions(void)
+{
+	for (;;)
+	{
+		loaderMutex.Acquire();
+
+		LoadRequest *request = completedList.GetFirstListElement();
+		if (request)
+		{
+			completedList.RemoveListElement(request);
+		}
+
+		loaderMutex.Release();
+
+		if (!request)
+		{
+			break;
+		}
+
+		CompleteLoad(request);
+	}
+}
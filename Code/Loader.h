@@ -0,0 +1,142 @@
+#ifndef Loader_h
+#define Loader_h
+
+
+#include "Base.h"
+#include "TSCompletable.h"
+
+
+namespace Framework
+{
+	enum
+	{
+		kLoadPriorityLow,
+		kLoadPriorityNormal,
+		kLoadPriorityHigh,
+		kLoadPriorityCount
+	};
+
+
+	enum
+	{
+		kLoadPending,
+		kLoadReading,
+		kLoadComplete,
+		kLoadFailed,
+		kLoadCancelled
+	};
+
+
+	// A LoadRequest holds the name of a file to be read by the FileLoader and, once the read has
+	// finished, the File containing its data. The flags passed to the constructor are passed to
+	// File::Load(), so kFileMapped maps the file instead of copying it. The completion callback is
+	// invoked when the state becomes kLoadComplete or kLoadFailed. By default, it is invoked on the
+	// thread that calls FileLoader::DispatchCompletions(), but if the immediate completion flag is
+	// set, it is invoked on the loader thread as soon as the file has been read.
+
+	class LoadRequest : public Shared, public Completable<LoadRequest>, public ListElement<LoadRequest>
+	{
+		friend class FileLoader;
+
+		private:
+
+			String<>		fileName;
+			uint32			fileFlags;
+			File			loadFile;
+
+			int32			loadPriority;
+			volatile int32	loadState;
+			bool			cancelFlag;
+			bool			immediateCompletionFlag;
+
+			~LoadRequest();
+
+		public:
+
+			LoadRequest(const char *name, uint32 flags = 0);
+
+			const char *GetFileName(void) const
+			{
+				return (fileName);
+			}
+
+			const File& GetFile(void) const
+			{
+				return (loadFile);
+			}
+
+			int32 GetLoadState(void) const
+			{
+				return (loadState);
+			}
+
+			int32 GetLoadPriority(void) const
+			{
+				return (loadPriority);
+			}
+
+			void SetLoadPriority(int32 priority)
+			{
+				loadPriority = priority;
+			}
+
+			bool GetImmediateCompletionFlag(void) const
+			{
+				return (immediateCompletionFlag);
+			}
+
+			void SetImmediateCompletionFlag(bool flag)
+			{
+				immediateCompletionFlag = flag;
+			}
+	};
+
+
+	// The FileLoader class reads files on a small pool of I/O threads. Pending requests are served
+	// in order of priority, and requests with the same priority are served in the order in which
+	// they were submitted. The loader holds a reference to each request until its completion has
+	// been handled or it has been cancelled, so the caller may release its own reference at any time.
+	//
+	// CancelLoad() returns true if the completion callback for the request will not be invoked. A
+	// request already being read is cancelled when the read finishes. WaitForLoad() blocks until a
+	// request has been read, handles its completion on the calling thread if it has not already
+	// been handled, and returns true if the file was loaded. If the request has the immediate
+	// completion flag set, its completion may still be running on the loader thread.
+
+	class FileLoader
+	{
+		private:
+
+			List<LoadRequest>		pendingList[kLoadPriorityCount];
+			List<LoadRequest>		completedList;
+
+			Mutex					loaderMutex;
+			Condition				pendingCondition;
+			Condition				completedCondition;
+
+			int32					loaderCount;
+			Thread					**loaderThread;
+			bool					exitFlag;
+
+			void CompleteLoad(LoadRequest *request);
+
+			static void LoaderThread(void *cookie);
+
+		public:
+
+			FileLoader(int32 threadCount);
+			~FileLoader();
+
+			void LoadFile(LoadRequest *request);
+			bool CancelLoad(LoadRequest *request);
+			bool WaitForLoad(LoadRequest *request);
+
+			void DispatchCompletions(void);
+	};
+
+
+	extern FileLoader *fileLoader;
+}
+
+
+#endif
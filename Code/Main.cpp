@@ -357,6 +357,7 @@ void InitializeFramework(void)
 
 void TerminateFramework(void)
 {
+	resourceManager->OutputStatistics();
 }
 
 void RunFramework(void)
@@ -382,6 +383,13 @@ void RunFramework(void)
 
 		MoveCamera();
 
+		fileLoader->DispatchCompletions();
+
+		if (uploadManager)
+		{
+			uploadManager->ProcessUploads();
+		}
+
 		graphicsManager->BeginRendering();
 		worldManager->RenderWorld(&ambientDrawCount, &lightDrawCount, &lightSourceCount);
 
@@ -398,6 +406,37 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR commandLine
 {
 	WNDCLASSEXW		windowClass;
 
+	#if COOK_TEXTURES
+
+		WorldManager::CookWorldTextures();
+		return (0);
+
+	#endif
+
+	#if BUILD_ASSET_PACK
+
+		BuildAssetPack(ASSET_PACK_NAME);
+		return (0);
+
+	#endif
+
+	#if ASSET_PACK_MODE
+
+		// If the pack file exists, every file in it is loaded from the pack. Otherwise, the
+		// separate files are loaded as usual.
+
+		AssetPack *assetPack = new AssetPack;
+		if (assetPack->Open(ASSET_PACK_NAME, (ASSET_PACK_MODE == 2) ? kFileMapped : 0))
+		{
+			fileSource = assetPack;
+		}
+		else
+		{
+			delete assetPack;
+		}
+
+	#endif
+
 	static const wchar_t applicationName[] = L"CMPM 163 Framework";
 
 	windowClass.cbSize = sizeof(WNDCLASSEXW);
@@ -459,6 +498,15 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR commandLine
 	graphicsManager = new GraphicsManager(screenWidth, screenHeight);
 	if (graphicsManager->Initialize(instance, frameworkWindow))
 	{
+		resourceManager = new ResourceManager;
+
+		#if UPLOAD_FRAME_BUDGET
+
+			uploadManager = new UploadManager(UPLOAD_RING_SIZE, UPLOAD_FRAME_BUDGET);
+
+		#endif
+
+		fileLoader = new FileLoader(LOADER_THREAD_COUNT);
 		worldManager = new WorldManager;
 
 		InitializeFramework();
@@ -466,6 +514,9 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR commandLine
 		TerminateFramework();
 
 		delete worldManager;
+		delete fileLoader;
+		delete uploadManager;
+		delete resourceManager;
 		graphicsManager->Terminate(frameworkWindow);
 	}
 
@@ -473,5 +524,7 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR commandLine
 
 	DestroyWindow(frameworkWindow);
 	UnregisterClassW(applicationName, instance);
+
+	delete fileSource;
 	return (0);
 }
@@ -4549,7 +4549,16 @@ void OpenGexDataDescription::UpdateAnimation(int32 clip, float time) const
 
 Framework::Node *OpenGexDataDescription::ImportGeometry(const char *name, Array<Framework::MeshGeometry *>& meshArray)
 {
-	Framework::File file(name);
+	Framework::File file(name, Framework::kFileMapped);
+	return (ImportGeometry(file, meshArray));
+}
+
+Framework::Node *OpenGexDataDescription::ImportGeometry(const Framework::File& file, Array<Framework::MeshGeometry *>& meshArray)
+{
+	if (!file.GetData())
+	{
+		return (nullptr);
+	}
 
 	Framework::Node *modelNode = nullptr;
 
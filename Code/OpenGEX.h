@@ -1589,6 +1589,7 @@ namespace OpenGEX
 			void UpdateAnimation(int32 clip, float time) const;
 
 			static Framework::Node *ImportGeometry(const char *name, Array<Framework::MeshGeometry *>& meshArray);
+			static Framework::Node *ImportGeometry(const Framework::File& file, Array<Framework::MeshGeometry *>& meshArray);
 	};
 }
 
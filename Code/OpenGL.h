@@ -12,6 +12,8 @@ GLEXTFUNC(void, glNamedBufferData, (GLuint,	GLsizeiptr, const void *, GLenum))
 GLEXTFUNC(void, glNamedBufferSubData, (GLuint, GLintptr, GLsizeiptr, const void *))
 GLEXTFUNC(void *, glMapNamedBuffer, (GLuint, GLenum))
 GLEXTFUNC(GLboolean, glUnmapNamedBuffer, (GLuint))
+GLEXTFUNC(void, glNamedBufferStorage, (GLuint, GLsizeiptr, const void *, GLbitfield))
+GLEXTFUNC(void *, glMapNamedBufferRange, (GLuint, GLintptr, GLsizeiptr, GLbitfield))
 
 GLEXTFUNC(void, glCreateVertexArrays, (GLsizei, GLuint *))
 GLEXTFUNC(void, glDeleteVertexArrays, (GLsizei, const GLuint *))
@@ -67,6 +69,10 @@ GLEXTFUNC(void, glBeginQuery, (GLenum, GLuint))
 GLEXTFUNC(void, glEndQuery, (GLenum))
 GLEXTFUNC(void, glGetQueryObjectui64v, (GLuint, GLenum, GLuint64 *))
 
+GLEXTFUNC(GLsync, glFenceSync, (GLenum, GLbitfield))
+GLEXTFUNC(void, glDeleteSync, (GLsync))
+GLEXTFUNC(GLenum, glClientWaitSync, (GLsync, GLbitfield, GLuint64))
+
 GLEXTFUNC(BOOL, wglChoosePixelFormatARB, (HDC, const int *, const FLOAT *, UINT, int *, UINT *))
 GLEXTFUNC(HGLRC, wglCreateContextAttribsARB, (HDC, HGLRC, const int *))
 GLEXTFUNC(BOOL, wglSwapIntervalEXT, (int))
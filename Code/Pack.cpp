@@ -0,0 +1,336 @@
+#include "Pack.h"
+#include "TSCompression.h"
+
+
+using namespace Framework;
+
+
+AssetPack::Entry::Entry(const char *name, const AssetPackEntry *entry) : entryName(name)
+{
+	packEntry = entry;
+}
+
+
+AssetPack::AssetPack() : entryTable(64, 4)
+{
+	packHandle = INVALID_HANDLE_VALUE;
+	packFile = nullptr;
+	directoryStorage = nullptr;
+	packHeader = nullptr;
+}
+
+AssetPack::~AssetPack()
+{
+	Close();
+}
+
+bool AssetPack::ReadPackData(uint64 offset, uint32 size, void *buffer) const
+{
+	OVERLAPPED		overlapped;
+	DWORD			actual;
+
+	// The offset is passed with each read instead of moving the file pointer, so entries can be
+	// read on several threads at once.
+
+	ZeroMemory(&overlapped, sizeof(OVERLAPPED));
+	overlapped.Offset = DWORD(offset);
+	overlapped.OffsetHigh = DWORD(offset >> 32);
+
+	return ((ReadFile(packHandle, buffer, size, &actual, &overlapped)) && (actual == size));
+}
+
+bool AssetPack::Open(const char *name, uint32 flags)
+{
+	uint64		fileSize;
+
+	Close();
+
+	if (flags & kFileMapped)
+	{
+		packFile = new File;
+		if (!packFile->Load(name, kFileMapped))
+		{
+			Close();
+			return (false);
+		}
+
+		fileSize = packFile->GetSize();
+		if (fileSize >= sizeof(AssetPackHeader))
+		{
+			packHeader = reinterpret_cast<const AssetPackHeader *>(packFile->GetData());
+		}
+	}
+	else
+	{
+		LARGE_INTEGER		size;
+		AssetPackHeader		header;
+
+		packHandle = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (packHandle == INVALID_HANDLE_VALUE)
+		{
+			return (false);
+		}
+
+		// Only the header and directory are read here. The entries are read when they are loaded.
+
+		GetFileSizeEx(packHandle, &size);
+		fileSize = size.QuadPart;
+
+		if ((fileSize >= sizeof(AssetPackHeader)) && (ReadPackData(0, sizeof(AssetPackHeader), &header)) && (header.directorySize <= fileSize - sizeof(AssetPackHeader)))
+		{
+			uint32 directoryEnd = sizeof(AssetPackHeader) + header.directorySize;
+			directoryStorage = new char[directoryEnd];
+			if (ReadPackData(0, directoryEnd, directoryStorage))
+			{
+				packHeader = reinterpret_cast<const AssetPackHeader *>(directoryStorage);
+			}
+		}
+	}
+
+	// Every name must be terminated inside the directory, and the data for every entry must lie
+	// inside the file with room for the zero byte that follows it.
+
+	const AssetPackHeader *header = packHeader;
+	if ((!header) || (header->identifier != kAssetPackIdentifier) || (header->version != kAssetPackVersion) || (header->packSize != fileSize) || (header->directorySize > fileSize - sizeof(AssetPackHeader)))
+	{
+		Close();
+		return (false);
+	}
+
+	uint32 entryCount = header->entryCount;
+	uint64 entryTableSize = uint64(entryCount) * sizeof(AssetPackEntry);
+	if (entryTableSize > header->directorySize)
+	{
+		Close();
+		return (false);
+	}
+
+	const AssetPackEntry *entry = reinterpret_cast<const AssetPackEntry *>(header + 1);
+	const char *nameTable = reinterpret_cast<const char *>(entry + entryCount);
+	uint32 nameTableSize = header->directorySize - uint32(entryTableSize);
+
+	if ((entryCount != 0) && ((nameTableSize == 0) || (nameTable[nameTableSize - 1] != 0)))
+	{
+		Close();
+		return (false);
+	}
+
+	for (uint32 a = 0; a < entryCount; a++, entry++)
+	{
+		uint32 storedSize = (entry->codeSize != 0) ? entry->codeSize : entry->dataSize;
+		if ((entry->nameOffset >= nameTableSize) || ((entry->dataOffset & (kAssetPackAlignment - 1)) != 0) || (entry->dataOffset >= fileSize) || (storedSize >= fileSize - entry->dataOffset))
+		{
+			Close();
+			return (false);
+		}
+
+		entryTable.InsertHashTableElement(new Entry(nameTable + entry->nameOffset, entry));
+	}
+
+	return (true);
+}
+
+void AssetPack::Close(void)
+{
+	entryTable.PurgeHashTable();
+	packHeader = nullptr;
+
+	delete[] directoryStorage;
+	directoryStorage = nullptr;
+
+	delete packFile;
+	packFile = nullptr;
+
+	if (packHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(packHandle);
+		packHandle = INVALID_HANDLE_VALUE;
+	}
+}
+
+bool AssetPack::LoadFile(const char *name, File *file) const
+{
+	const Entry *entry = entryTable.FindHashTableElement(String<>(name));
+	if (!entry)
+	{
+		return (false);
+	}
+
+	const AssetPackEntry *packEntry = entry->GetPackEntry();
+	uint32 size = packEntry->dataSize;
+	uint32 codeSize = packEntry->codeSize;
+
+	if (packFile)
+	{
+		// An uncompressed entry already has the alignment and terminator that a File guarantees,
+		// so it is used directly from the mapped pack.
+
+		const char *data = packFile->GetData() + packEntry->dataOffset;
+		if (codeSize == 0)
+		{
+			file->data = const_cast<char *>(data);
+			file->size = size;
+			return (true);
+		}
+
+		// A compressed entry must decode to exactly its recorded size, or the load fails.
+
+		return (Compression::DecompressData(reinterpret_cast<const uint8 *>(data), codeSize, file->AllocateStorage(size), size) == size);
+	}
+
+	char *data = file->AllocateStorage(size);
+	if (codeSize == 0)
+	{
+		return (ReadPackData(packEntry->dataOffset, size, data));
+	}
+
+	uint8 *code = new uint8[codeSize];
+	bool success = ReadPackData(packEntry->dataOffset, codeSize, code);
+	if (success)
+	{
+		success = (Compression::DecompressData(code, codeSize, data, size) == size);
+	}
+
+	delete[] code;
+	return (success);
+}
+
+
+bool Framework::WriteAssetPack(const char *name, int32 count, const char *const *path)
+{
+	static const char zero[kAssetPackAlignment] = {};
+
+	DWORD			actual;
+	LARGE_INTEGER	position;
+
+	HANDLE fileHandle = CreateFileA(name, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return (false);
+	}
+
+	// The directory is written last, after the offsets and code sizes of all the entries are
+	// known, so the data begins after the space reserved for it.
+
+	uint32 nameTableSize = 0;
+	for (int32 a = 0; a < count; a++)
+	{
+		nameTableSize += Text::GetTextLength(path[a]) + 1;
+	}
+
+	uint32 directorySize = count * sizeof(AssetPackEntry) + nameTableSize;
+	char *directory = new char[directorySize];
+	AssetPackEntry *entry = reinterpret_cast<AssetPackEntry *>(directory);
+	char *nameTable = directory + count * sizeof(AssetPackEntry);
+
+	uint64 offset = (sizeof(AssetPackHeader) + directorySize + (kAssetPackAlignment - 1)) & ~uint64(kAssetPackAlignment - 1);
+	position.QuadPart = offset;
+	bool success = (SetFilePointerEx(fileHandle, position, nullptr, FILE_BEGIN) != 0);
+
+	uint32 nameOffset = 0;
+	for (int32 a = 0; (success) && (a < count); a++)
+	{
+		File file(path[a]);
+		if (!file.GetData())
+		{
+			success = false;
+			break;
+		}
+
+		// The compressor pads its code to a multiple of four bytes, so it can write up to three
+		// bytes past the input size, and the padded code can be larger than the input. The file
+		// is stored uncompressed if compression fails or doesn't make it smaller.
+
+		uint32 size = uint32(file.GetSize());
+		uint8 *code = new uint8[size + 4];
+		uint32 codeSize = (size != 0) ? Compression::CompressData(file.GetData(), size, code) : 0;
+		if (codeSize >= size)
+		{
+			codeSize = 0;
+		}
+
+		entry[a].dataOffset = offset;
+		entry[a].dataSize = size;
+		entry[a].codeSize = codeSize;
+		entry[a].nameOffset = nameOffset;
+		entry[a].reserved = 0;
+
+		nameOffset += Text::CopyText(path[a], nameTable + nameOffset) + 1;
+
+		// Every entry is followed by at least one zero byte, and the next entry begins on the
+		// next aligned boundary after it.
+
+		const void *data = (codeSize != 0) ? static_cast<const void *>(code) : file.GetData();
+		uint32 storedSize = (codeSize != 0) ? codeSize : size;
+		uint32 padSize = kAssetPackAlignment - uint32((offset + storedSize) & (kAssetPackAlignment - 1));
+
+		success = ((WriteFile(fileHandle, data, storedSize, &actual, nullptr)) && (actual == storedSize) && (WriteFile(fileHandle, zero, padSize, &actual, nullptr)) && (actual == padSize));
+		offset += storedSize + padSize;
+
+		delete[] code;
+	}
+
+	if (success)
+	{
+		AssetPackHeader		header;
+
+		header.identifier = kAssetPackIdentifier;
+		header.version = kAssetPackVersion;
+		header.entryCount = count;
+		header.directorySize = directorySize;
+		header.packSize = offset;
+		header.reserved[0] = 0;
+		header.reserved[1] = 0;
+
+		position.QuadPart = 0;
+		success = ((SetFilePointerEx(fileHandle, position, nullptr, FILE_BEGIN)) && (WriteFile(fileHandle, &header, sizeof(AssetPackHeader), &actual, nullptr)) && (actual == sizeof(AssetPackHeader)) && (WriteFile(fileHandle, directory, directorySize, &actual, nullptr)) && (actual == directorySize));
+	}
+
+	delete[] directory;
+	CloseHandle(fileHandle);
+
+	if (!success)
+	{
+		DeleteFileA(name);
+	}
+
+	return (success);
+}
+
+bool Framework::BuildAssetPack(const char *name)
+{
+	static const char *const assetDirectory[4] = {"Textures/", "Models/", "Shaders/", "Fonts/"};
+	static const char *const assetPattern[4] = {"*.tga", "*.ogex", "*.glsl", "*.slug"};
+
+	WIN32_FIND_DATAA	findData;
+	Array<String<>>		pathArray;
+
+	for (int32 a = 0; a < 4; a++)
+	{
+		HANDLE findHandle = FindFirstFileA(String<>(assetDirectory[a]) + assetPattern[a], &findData);
+		if (findHandle != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+				{
+					pathArray.AppendArrayElement(String<>(assetDirectory[a]) + findData.cFileName);
+				}
+			} while (FindNextFileA(findHandle, &findData));
+
+			FindClose(findHandle);
+		}
+	}
+
+	int32 count = pathArray.GetArrayElementCount();
+	const char **path = new const char *[Max(count, 1)];
+	for (int32 a = 0; a < count; a++)
+	{
+		path[a] = pathArray[a];
+	}
+
+	bool success = WriteAssetPack(name, count, path);
+
+	delete[] path;
+	return (success);
+}
@@ -0,0 +1,122 @@
+#ifndef Pack_h
+#define Pack_h
+
+
+#include "Base.h"
+
+
+namespace Framework
+{
+	enum
+	{
+		kAssetPackIdentifier	= 'APAK',
+		kAssetPackVersion		= 1,
+		kAssetPackAlignment		= 64
+	};
+
+
+	// An asset pack file begins with an AssetPackHeader, which is followed by the directory. The
+	// directory holds an AssetPackEntry for every file in the pack followed by a table of the
+	// logical paths of the files, each terminated by a zero byte. The data for each entry begins
+	// on a 64-byte boundary and is followed by at least one zero byte. If the code size is zero,
+	// the data is stored uncompressed. Otherwise, it has been compressed with Compression::CompressData().
+
+	struct AssetPackHeader
+	{
+		uint32		identifier;
+		uint32		version;
+		uint32		entryCount;
+		uint32		directorySize;
+		uint64		packSize;
+		uint32		reserved[2];
+	};
+
+	struct AssetPackEntry
+	{
+		uint64		dataOffset;
+		uint32		dataSize;
+		uint32		codeSize;
+		uint32		nameOffset;
+		uint32		reserved;
+	};
+
+
+	// The AssetPack class provides access to the files stored in an asset pack by their logical
+	// paths, such as "Shaders/Vertex.glsl". It is a FileSource, so while an asset pack is installed in
+	// the global fileSource pointer, File::Load() looks up every name in it before trying to open a
+	// separate file.
+	//
+	// If Open() is called with kFileMapped, the whole pack is mapped into memory once, and a File
+	// loaded from an uncompressed entry points directly into the mapping. Otherwise, only the
+	// directory is kept in memory, and each entry is read through the pack's file handle at its
+	// offset, so several threads may load entries at the same time.
+
+	class AssetPack : public FileSource
+	{
+		private:
+
+			class Entry : public HashTableElement<Entry>
+			{
+				private:
+
+					String<>				entryName;
+					const AssetPackEntry	*packEntry;
+
+				public:
+
+					typedef String<> KeyType;
+
+					Entry(const char *name, const AssetPackEntry *entry);
+
+					const KeyType& GetKey(void) const
+					{
+						return (entryName);
+					}
+
+					const AssetPackEntry *GetPackEntry(void) const
+					{
+						return (packEntry);
+					}
+
+					static uint32 Hash(const KeyType& key)
+					{
+						return (Text::Hash(key));
+					}
+			};
+
+			HANDLE					packHandle;
+			File					*packFile;
+			char					*directoryStorage;
+
+			const AssetPackHeader	*packHeader;
+			HashTable<Entry>		entryTable;
+
+			bool ReadPackData(uint64 offset, uint32 size, void *buffer) const;
+
+		public:
+
+			AssetPack();
+			~AssetPack();
+
+			int32 GetEntryCount(void) const
+			{
+				return ((packHeader) ? packHeader->entryCount : 0);
+			}
+
+			bool Open(const char *name, uint32 flags = 0);
+			void Close(void);
+
+			bool LoadFile(const char *name, File *file) const override;
+	};
+
+
+	// WriteAssetPack() stores the files named in the path array in a new asset pack, using each
+	// name as its logical path. BuildAssetPack() is called by the offline pack tool, and it
+	// writes every texture image, model, shader, and font used by the framework.
+
+	bool WriteAssetPack(const char *name, int32 count, const char *const *path);
+	bool BuildAssetPack(const char *name);
+}
+
+
+#endif
@@ -0,0 +1,83 @@
+#include "Surface.h"
+
+
+using namespace Framework;
+
+
+EditableSurface::EditableSurface(const Color4U *map, int32 width, int32 height, float scale)
+{
+	int32 pixelCount = width * height;
+
+	heightMap = new Color4U[pixelCount];
+	Terathon::CopyMemory(map, heightMap, pixelCount * sizeof(Color4U));
+
+	mapWidth = width;
+	mapHeight = height;
+	bakeScale = scale;
+
+	// The whole surface is baked with the same exact search that is later used to
+	// rebake parts of it, so updated texels always match their neighbors.
+
+	normalMap = new Color2S[pixelCount];
+	horizonMap = new Color4U[pixelCount * 2];
+
+	SurfaceMapSet	mapSet;
+
+	mapSet.normalMap = normalMap;
+	mapSet.parallaxMap = nullptr;
+	mapSet.horizonMap = horizonMap;
+	mapSet.ambientMap = nullptr;
+	mapSet.parallaxScale = 1.0F;
+	mapSet.ambientPower = 1.0F;
+
+	BakeSurfaceMaps(heightMap, &mapSet, width, height, scale, BAKE_THREAD_COUNT);
+
+	mipmapCount = GenerateMipmapImages(Integer3D(width, height, 1), normalMap, &normalMipmapImages);
+	GenerateMipmapImages(Integer3D(width, height, 2), horizonMap, &horizonMipmapImages);
+
+	normalTexture = new Texture(Texture::kType2D, Texture::kFormatSignedRedGreen, width, height, 1, mipmapCount, normalMipmapImages);
+	horizonTexture = new Texture(Texture::kType2DArray, Texture::kFormatLinearRgba, width, height, 2, mipmapCount, horizonMipmapImages);
+}
+
+EditableSurface::~EditableSurface()
+{
+	horizonTexture->Release();
+	normalTexture->Release();
+
+	ReleaseMipmapImages(horizonMipmapImages);
+	ReleaseMipmapImages(normalMipmapImages);
+
+	delete[] horizonMap;
+	delete[] normalMap;
+	delete[] heightMap;
+}
+
+void EditableSurface::UpdateSurface(const Rect& dirtyRect)
+{
+	SurfaceMapSet	mapSet;
+	Rect			wrappedRect[4];
+
+	mapSet.normalMap = normalMap;
+	mapSet.parallaxMap = nullptr;
+	mapSet.horizonMap = horizonMap;
+	mapSet.ambientMap = nullptr;
+	mapSet.parallaxScale = 1.0F;
+	mapSet.ambientPower = 1.0F;
+
+	// Every texel whose search window overlaps the dirty rectangle is rebaked, including
+	// texels on the opposite side of the map when the window wraps around an edge.
+
+	int32 rectCount = GetWrappedRects(GetSurfaceBakeFootprint(&mapSet, dirtyRect), mapWidth, mapHeight, wrappedRect);
+	for (int32 a = 0; a < rectCount; a++)
+	{
+		const Rect& rect = wrappedRect[a];
+
+		RebakeSurfaceMaps(heightMap, &mapSet, mapWidth, mapHeight, bakeScale, rect, BAKE_THREAD_COUNT);
+
+		UpdateMipmapImages(Integer3D(mapWidth, mapHeight, 1), normalMap, normalMipmapImages, rect);
+		UpdateMipmapImages(Integer3D(mapWidth, mapHeight, 2), horizonMap, horizonMipmapImages, rect);
+
+		normalTexture->UpdateTexture(rect, normalMipmapImages);
+		horizonTexture->UpdateTexture(rect, horizonMipmapImages);
+	}
+}
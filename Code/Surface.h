@@ -0,0 +1,74 @@
+#ifndef Surface_h
+#define Surface_h
+
+
+#include "Graphics.h"
+#include "Bake.h"
+
+
+namespace Framework
+{
+	// The EditableSurface class keeps the normal and horizon maps of a height map that changes at
+	// run time, together with their mipmap chains and textures. After heights are modified inside
+	// a rectangle, UpdateSurface() rebakes, remipmaps, and uploads only the texels affected.
+
+	class EditableSurface
+	{
+		private:
+
+			Color4U			*heightMap;
+			int32			mapWidth;
+			int32			mapHeight;
+			float			bakeScale;
+
+			Color2S			*normalMap;
+			Color4U			*horizonMap;
+
+			int32			mipmapCount;
+			Color2S			*normalMipmapImages;
+			Color4U			*horizonMipmapImages;
+
+			Texture			*normalTexture;
+			Texture			*horizonTexture;
+
+		public:
+
+			EditableSurface(const Color4U *map, int32 width, int32 height, float scale);
+			~EditableSurface();
+
+			Color4U *GetHeightMap(void) const
+			{
+				return (heightMap);
+			}
+
+			int32 GetMipmapCount(void) const
+			{
+				return (mipmapCount);
+			}
+
+			const Color2S *GetNormalMipmapImages(void) const
+			{
+				return (normalMipmapImages);
+			}
+
+			const Color4U *GetHorizonMipmapImages(void) const
+			{
+				return (horizonMipmapImages);
+			}
+
+			Texture *GetNormalTexture(void) const
+			{
+				return (normalTexture);
+			}
+
+			Texture *GetHorizonTexture(void) const
+			{
+				return (horizonTexture);
+			}
+
+			void UpdateSurface(const Rect& dirtyRect);
+	};
+}
+
+
+#endif
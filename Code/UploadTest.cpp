@@ -0,0 +1,863 @@
+#include "UploadTest.h"
+#include "Surface.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+using namespace Framework;
+
+
+namespace
+{
+	// These are the GL function pointers replaced by a GLRecorder, saved so that they can be
+	// restored when the recorder is destroyed.
+
+	struct GLFunctionTable
+	{
+		decltype(glCreateBuffers)					createBuffers;
+		decltype(glCreateTextures)					createTextures;
+		decltype(glDeleteBuffers)					deleteBuffers;
+		decltype(glBindBuffer)						bindBuffer;
+		decltype(glNamedBufferStorage)				namedBufferStorage;
+		decltype(glMapNamedBufferRange)				mapNamedBufferRange;
+		decltype(glUnmapNamedBuffer)				unmapNamedBuffer;
+		decltype(glTextureStorage2D)				textureStorage2D;
+		decltype(glTextureStorage3D)				textureStorage3D;
+		decltype(glTextureParameteri)				textureParameteri;
+		decltype(glTextureParameterf)				textureParameterf;
+		decltype(glTextureSubImage2D)				textureSubImage2D;
+		decltype(glTextureSubImage3D)				textureSubImage3D;
+		decltype(glCompressedTextureSubImage2D)		compressedTextureSubImage2D;
+		decltype(glCompressedTextureSubImage3D)		compressedTextureSubImage3D;
+		decltype(glFenceSync)						fenceSync;
+		decltype(glDeleteSync)						deleteSync;
+		decltype(glClientWaitSync)					clientWaitSync;
+	};
+
+
+	GLRecorder			*activeRecorder = nullptr;
+	GLFunctionTable		savedFunctionTable;
+
+
+	uint32 GetPixelSize(GLenum format, GLenum type)
+	{
+		uint32 componentCount = 1;
+		if ((format == GL_RGBA) || (format == GL_RGBA_INTEGER))
+		{
+			componentCount = 4;
+		}
+		else if (format == GL_RG)
+		{
+			componentCount = 2;
+		}
+
+		if ((type == GL_HALF_FLOAT) || (type == GL_UNSIGNED_SHORT))
+		{
+			return (componentCount * 2);
+		}
+
+		if (type == GL_FLOAT)
+		{
+			return (componentCount * 4);
+		}
+
+		return (componentCount);
+	}
+}
+
+
+GLRecorder::GLRecorder()
+{
+	objectCount = 0;
+	lastTexture = 0;
+	unpackBuffer = 0;
+
+	bufferStorage = nullptr;
+	bufferSize = 0;
+
+	fenceCount = 0;
+	signaledCount = 0;
+	liveFenceCount = 0;
+
+	activeRecorder = this;
+
+	GLFunctionTable *table = &savedFunctionTable;
+	table->createBuffers = glCreateBuffers;
+	table->createTextures = glCreateTextures;
+	table->deleteBuffers = glDeleteBuffers;
+	table->bindBuffer = glBindBuffer;
+	table->namedBufferStorage = glNamedBufferStorage;
+	table->mapNamedBufferRange = glMapNamedBufferRange;
+	table->unmapNamedBuffer = glUnmapNamedBuffer;
+	table->textureStorage2D = glTextureStorage2D;
+	table->textureStorage3D = glTextureStorage3D;
+	table->textureParameteri = glTextureParameteri;
+	table->textureParameterf = glTextureParameterf;
+	table->textureSubImage2D = glTextureSubImage2D;
+	table->textureSubImage3D = glTextureSubImage3D;
+	table->compressedTextureSubImage2D = glCompressedTextureSubImage2D;
+	table->compressedTextureSubImage3D = glCompressedTextureSubImage3D;
+	table->fenceSync = glFenceSync;
+	table->deleteSync = glDeleteSync;
+	table->clientWaitSync = glClientWaitSync;
+
+	glCreateBuffers = &CreateBuffers;
+	glCreateTextures = &CreateTextures;
+	glDeleteBuffers = &DeleteBuffers;
+	glBindBuffer = &BindBuffer;
+	glNamedBufferStorage = &NamedBufferStorage;
+	glMapNamedBufferRange = &MapNamedBufferRange;
+	glUnmapNamedBuffer = &UnmapNamedBuffer;
+	glTextureStorage2D = &TextureStorage2D;
+	glTextureStorage3D = &TextureStorage3D;
+	glTextureParameteri = &TextureParameteri;
+	glTextureParameterf = &TextureParameterf;
+	glTextureSubImage2D = &TextureSubImage2D;
+	glTextureSubImage3D = &TextureSubImage3D;
+	glCompressedTextureSubImage2D = &CompressedTextureSubImage2D;
+	glCompressedTextureSubImage3D = &CompressedTextureSubImage3D;
+	glFenceSync = &FenceSync;
+	glDeleteSync = &DeleteSync;
+	glClientWaitSync = &ClientWaitSync;
+}
+
+GLRecorder::~GLRecorder()
+{
+	const GLFunctionTable *table = &savedFunctionTable;
+	glCreateBuffers = table->createBuffers;
+	glCreateTextures = table->createTextures;
+	glDeleteBuffers = table->deleteBuffers;
+	glBindBuffer = table->bindBuffer;
+	glNamedBufferStorage = table->namedBufferStorage;
+	glMapNamedBufferRange = table->mapNamedBufferRange;
+	glUnmapNamedBuffer = table->unmapNamedBuffer;
+	glTextureStorage2D = table->textureStorage2D;
+	glTextureStorage3D = table->textureStorage3D;
+	glTextureParameteri = table->textureParameteri;
+	glTextureParameterf = table->textureParameterf;
+	glTextureSubImage2D = table->textureSubImage2D;
+	glTextureSubImage3D = table->textureSubImage3D;
+	glCompressedTextureSubImage2D = table->compressedTextureSubImage2D;
+	glCompressedTextureSubImage3D = table->compressedTextureSubImage3D;
+	glFenceSync = table->fenceSync;
+	glDeleteSync = table->deleteSync;
+	glClientWaitSync = table->clientWaitSync;
+
+	activeRecorder = nullptr;
+	delete[] bufferStorage;
+
+	for (TextureImage& textureImage : textureImageArray)
+	{
+		delete[] textureImage.imageStorage;
+	}
+}
+
+uint64 GLRecorder::CalculateChecksum(const void *data, uint32 size)
+{
+	// This is the 64-bit FNV-1a hash.
+
+	const uint8 *byte = static_cast<const uint8 *>(data);
+	uint64 checksum = 0xCBF29CE484222325ULL;
+
+	for (uint32 a = 0; a < size; a++)
+	{
+		checksum = (checksum ^ byte[a]) * 0x00000100000001B3ULL;
+	}
+
+	return (checksum);
+}
+
+const void *GLRecorder::GetUploadData(const void *image) const
+{
+	// While a buffer is bound to GL_PIXEL_UNPACK_BUFFER, the image pointer is an offset into it.
+
+	return ((unpackBuffer != 0) ? static_cast<const void *>(bufferStorage + GetPointerAddress(image)) : image);
+}
+
+GLRecorder::TextureImage *GLRecorder::FindTextureImage(GLuint texture)
+{
+	for (TextureImage& textureImage : textureImageArray)
+	{
+		if (textureImage.textureObject == texture)
+		{
+			return (&textureImage);
+		}
+	}
+
+	return (nullptr);
+}
+
+void GLRecorder::RecordUpload(GLuint texture, int32 mipmap, uint32 size, const void *image)
+{
+	uploadArray.AppendArrayElement(UploadRecord{texture, mipmap, unpackBuffer, GetPointerAddress(image), size, CalculateChecksum(GetUploadData(image), size)});
+}
+
+void GLRecorder::StoreImage(GLuint texture, int32 level, int32 x, int32 y, int32 z, int32 width, int32 height, int32 depth, uint32 pixelSize, const void *image)
+{
+	TextureImage *textureImage = FindTextureImage(texture);
+	if ((!textureImage) || (textureImage->levelCount == 0))
+	{
+		return;
+	}
+
+	int32 layerCount = textureImage->textureDepth;
+	if (!textureImage->imageStorage)
+	{
+		uint32 size = 0;
+		for (int32 a = 0; a < textureImage->levelCount; a++)
+		{
+			size += Max(textureImage->textureWidth >> a, 1) * Max(textureImage->textureHeight >> a, 1) * layerCount * pixelSize;
+		}
+
+		textureImage->imageStorage = new char[size];
+	}
+
+	char *storage = textureImage->imageStorage;
+	for (int32 a = 0; a < level; a++)
+	{
+		storage += Max(textureImage->textureWidth >> a, 1) * Max(textureImage->textureHeight >> a, 1) * layerCount * pixelSize;
+	}
+
+	// Rows are read with a pitch equal to the width of the mipmap and layers with a pitch equal
+	// to its area. Every upload made by the framework either covers a whole mipmap or sets
+	// GL_UNPACK_ROW_LENGTH and GL_UNPACK_IMAGE_HEIGHT to these values. The glPixelStorei()
+	// function isn't loaded through a pointer, so the recorder can't see those calls.
+
+	int32 levelWidth = Max(textureImage->textureWidth >> level, 1);
+	int32 levelHeight = Max(textureImage->textureHeight >> level, 1);
+	const char *data = static_cast<const char *>(GetUploadData(image));
+
+	for (int32 k = 0; k < depth; k++)
+	{
+		for (int32 j = 0; j < height; j++)
+		{
+			const char *source = data + ((k * levelHeight + j) * levelWidth) * pixelSize;
+			char *destination = storage + (((z + k) * levelHeight + y + j) * levelWidth + x) * pixelSize;
+			CopyMemory(source, destination, width * pixelSize);
+		}
+	}
+}
+
+int32 GLRecorder::GetBaseLevel(GLuint texture) const
+{
+	for (const BaseLevelRecord& record : baseLevelArray)
+	{
+		if (record.textureObject == texture)
+		{
+			return (record.baseLevel);
+		}
+	}
+
+	return (-1);
+}
+
+const void *GLRecorder::GetTextureImage(GLuint texture) const
+{
+	for (const TextureImage& textureImage : textureImageArray)
+	{
+		if (textureImage.textureObject == texture)
+		{
+			return (textureImage.imageStorage);
+		}
+	}
+
+	return (nullptr);
+}
+
+void GLRecorder::SignalFences(int32 count)
+{
+	signaledCount = Min(signaledCount + count, fenceCount);
+}
+
+void GLRecorder::CreateBuffers(GLsizei count, GLuint *buffer)
+{
+	for (machine a = 0; a < count; a++)
+	{
+		buffer[a] = ++activeRecorder->objectCount;
+	}
+}
+
+void GLRecorder::CreateTextures(GLenum target, GLsizei count, GLuint *texture)
+{
+	for (machine a = 0; a < count; a++)
+	{
+		texture[a] = ++activeRecorder->objectCount;
+
+		if ((target == GL_TEXTURE_2D) || (target == GL_TEXTURE_2D_ARRAY))
+		{
+			activeRecorder->textureImageArray.AppendArrayElement(TextureImage{texture[a], 0, 0, 0, 0, nullptr});
+		}
+	}
+
+	activeRecorder->lastTexture = activeRecorder->objectCount;
+}
+
+void GLRecorder::DeleteBuffers(GLsizei count, const GLuint *buffer)
+{
+	// Only the buffer used as the upload ring has storage.
+
+	delete[] activeRecorder->bufferStorage;
+	activeRecorder->bufferStorage = nullptr;
+	activeRecorder->bufferSize = 0;
+}
+
+void GLRecorder::BindBuffer(GLenum target, GLuint buffer)
+{
+	if (target == GL_PIXEL_UNPACK_BUFFER)
+	{
+		activeRecorder->unpackBuffer = buffer;
+	}
+}
+
+void GLRecorder::NamedBufferStorage(GLuint buffer, GLsizeiptr size, const void *data, GLbitfield flags)
+{
+	delete[] activeRecorder->bufferStorage;
+	activeRecorder->bufferStorage = new char[size];
+	activeRecorder->bufferSize = uint32(size);
+}
+
+void *GLRecorder::MapNamedBufferRange(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+	return (activeRecorder->bufferStorage + offset);
+}
+
+GLboolean GLRecorder::UnmapNamedBuffer(GLuint buffer)
+{
+	return (GL_TRUE);
+}
+
+void GLRecorder::TextureStorage2D(GLuint texture, GLsizei levels, GLenum format, GLsizei width, GLsizei height)
+{
+	TextureImage *textureImage = activeRecorder->FindTextureImage(texture);
+	if (textureImage)
+	{
+		textureImage->textureWidth = width;
+		textureImage->textureHeight = height;
+		textureImage->textureDepth = 1;
+		textureImage->levelCount = levels;
+	}
+}
+
+void GLRecorder::TextureStorage3D(GLuint texture, GLsizei levels, GLenum format, GLsizei width, GLsizei height, GLsizei depth)
+{
+	TextureImage *textureImage = activeRecorder->FindTextureImage(texture);
+	if (textureImage)
+	{
+		textureImage->textureWidth = width;
+		textureImage->textureHeight = height;
+		textureImage->textureDepth = depth;
+		textureImage->levelCount = levels;
+	}
+}
+
+void GLRecorder::TextureParameteri(GLuint texture, GLenum name, int param)
+{
+	if (name == GL_TEXTURE_BASE_LEVEL)
+	{
+		for (BaseLevelRecord& record : activeRecorder->baseLevelArray)
+		{
+			if (record.textureObject == texture)
+			{
+				record.baseLevel = param;
+				return;
+			}
+		}
+
+		activeRecorder->baseLevelArray.AppendArrayElement(BaseLevelRecord{texture, param});
+	}
+}
+
+void GLRecorder::TextureParameterf(GLuint texture, GLenum name, float param)
+{
+}
+
+void GLRecorder::TextureSubImage2D(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+{
+	uint32 pixelSize = GetPixelSize(format, type);
+	activeRecorder->RecordUpload(texture, level, width * height * pixelSize, pixels);
+	activeRecorder->StoreImage(texture, level, x, y, 0, width, height, 1, pixelSize, pixels);
+}
+
+void GLRecorder::TextureSubImage3D(GLuint texture, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels)
+{
+	uint32 pixelSize = GetPixelSize(format, type);
+	activeRecorder->RecordUpload(texture, level, width * height * depth * pixelSize, pixels);
+	activeRecorder->StoreImage(texture, level, x, y, z, width, height, depth, pixelSize, pixels);
+}
+
+void GLRecorder::CompressedTextureSubImage2D(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLsizei size, const void *data)
+{
+	activeRecorder->RecordUpload(texture, level, size, data);
+}
+
+void GLRecorder::CompressedTextureSubImage3D(GLuint texture, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei size, const void *data)
+{
+	activeRecorder->RecordUpload(texture, level, size, data);
+}
+
+GLsync GLRecorder::FenceSync(GLenum condition, GLbitfield flags)
+{
+	// A fence is identified by its position in the order of insertion, starting at one.
+
+	activeRecorder->liveFenceCount++;
+	return (reinterpret_cast<GLsync>(machine_address(++activeRecorder->fenceCount)));
+}
+
+void GLRecorder::DeleteSync(GLsync sync)
+{
+	activeRecorder->liveFenceCount--;
+}
+
+GLenum GLRecorder::ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+	return ((int32(GetPointerAddress(sync)) <= activeRecorder->signaledCount) ? GL_ALREADY_SIGNALED : GL_TIMEOUT_EXPIRED);
+}
+
+
+namespace
+{
+	struct UploadTest
+	{
+		const char		*testName;
+		bool			(*testFunction)(void);
+	};
+
+
+	bool Check(bool condition, const char *text)
+	{
+		if (!condition)
+		{
+			String<> string("  Check failed: ");
+			string += text;
+			string += "\n";
+			fputs(string, stdout);
+		}
+
+		return (condition);
+	}
+
+	uint8 *CreateTestImage(uint32 size, uint32 seed)
+	{
+		uint8 *image = new uint8[size];
+		for (uint32 a = 0; a < size; a++)
+		{
+			image[a] = uint8(a * 7 + seed * 31 + (a >> 8));
+		}
+
+		return (image);
+	}
+
+	void CountRelease(void *cookie)
+	{
+		++*static_cast<int32 *>(cookie);
+	}
+
+	uint32 GetMipmapOffset(int32 format, int32 width, int32 height, int32 mipmap)
+	{
+		uint32 offset = 0;
+		for (int32 a = 0; a < mipmap; a++)
+		{
+			offset += TextureLayout::CalculateLayerSize(format, Max(width >> a, 1), Max(height >> a, 1));
+		}
+
+		return (offset);
+	}
+
+	bool CheckUploadData(const GLRecorder::UploadRecord& record, const uint8 *image, int32 format, int32 width, int32 height)
+	{
+		const uint8 *data = image + GetMipmapOffset(format, width, height, record.mipmapIndex);
+		uint32 size = TextureLayout::CalculateLayerSize(format, Max(width >> record.mipmapIndex, 1), Max(height >> record.mipmapIndex, 1));
+		return (Check((record.imageSize == size) && (record.imageChecksum == GLRecorder::CalculateChecksum(data, size)), "uploaded data matches the image"));
+	}
+
+
+	bool TestBudgetSplitting(void)
+	{
+		enum
+		{
+			kTextureSize		= 64,
+			kMipmapCount		= 7,
+			kFrameBudget		= 1024
+		};
+
+		GLRecorder		recorder;
+		Texture			*texture[2];
+		GLuint			textureObject[2];
+		uint8			*image[2];
+		int32			nextMipmap[2];
+
+		// Two textures request all of their mipmaps, and the frame budget is smaller than the largest
+		// mipmaps of both. Every frame must stay within the budget unless it stages a single mipmap,
+		// and each texture must receive its mipmaps from the smallest to the largest.
+
+		UploadManager *manager = new UploadManager(0x10000, kFrameBudget);
+		uint32 imageSize = TextureLayout::CalculateImageSize(TextureLayout::kType2D, TextureLayout::kFormatLinearRgba, kTextureSize, kTextureSize, 1, kMipmapCount);
+
+		for (machine k = 0; k < 2; k++)
+		{
+			image[k] = CreateTestImage(imageSize, uint32(k));
+			texture[k] = new Texture(Texture::kType2D, Texture::kFormatLinearRgba, kTextureSize, kTextureSize, 1, kMipmapCount, nullptr);
+			textureObject[k] = recorder.GetLastTexture();
+			nextMipmap[k] = kMipmapCount - 1;
+
+			manager->UploadTexture(texture[k], image[k]);
+			texture[k]->RequestDetail(0.0F);
+		}
+
+		bool success = true;
+		int32 stagedFrameCount = 0;
+		int32 previousCount = 0;
+
+		for (machine frame = 0; (frame < 64) && (manager->UploadsPending()); frame++)
+		{
+			manager->ProcessUploads();
+			recorder.SignalAllFences();
+
+			uint32 frameSize = 0;
+			int32 uploadCount = recorder.GetUploadCount();
+			for (machine a = previousCount; a < uploadCount; a++)
+			{
+				const GLRecorder::UploadRecord& record = recorder.GetUploadRecord(int32(a));
+				int32 k = (record.textureObject == textureObject[0]) ? 0 : 1;
+
+				success &= Check(record.mipmapIndex == nextMipmap[k]--, "mipmaps are uploaded from the smallest to the largest");
+				success &= Check(record.unpackBuffer != 0, "mipmaps smaller than the ring are staged in the ring");
+				success &= CheckUploadData(record, image[k], Texture::kFormatLinearRgba, kTextureSize, kTextureSize);
+				frameSize += record.imageSize;
+			}
+
+			success &= Check((frameSize <= kFrameBudget) || (uploadCount - previousCount == 1), "a frame stays within the budget unless it stages one mipmap");
+
+			stagedFrameCount += (uploadCount != previousCount);
+			previousCount = uploadCount;
+		}
+
+		// The first frame takes one mipmap from each texture in turn. The largest mipmaps of the
+		// first texture get a frame each before the second texture continues, so seven frames stage
+		// something.
+
+		success &= Check((recorder.GetUploadCount() > 1) && (recorder.GetUploadRecord(0).textureObject == textureObject[0]) && (recorder.GetUploadRecord(1).textureObject == textureObject[1]), "a round takes one mipmap from every texture");
+		success &= Check((nextMipmap[0] == -1) && (nextMipmap[1] == -1), "every mipmap is uploaded once");
+		success &= Check(stagedFrameCount == 7, "uploads are split among seven frames");
+		success &= Check(manager->GetUploadedSize() == imageSize * 2, "the uploaded size counts every mipmap");
+		success &= Check(!manager->UploadsPending(), "no uploads are pending at the end");
+
+		delete manager;
+
+		for (machine k = 0; k < 2; k++)
+		{
+			texture[k]->Release();
+			delete[] image[k];
+		}
+
+		return (success);
+	}
+
+	bool TestRingWrap(void)
+	{
+		enum
+		{
+			kTextureCount		= 4,
+			kTextureWidth		= 8,
+			kTextureHeight		= 3,
+			kRingSize			= 256
+		};
+
+		GLRecorder		recorder;
+		Texture			*texture[kTextureCount];
+		uint8			*image[kTextureCount];
+
+		// Every texture has a single 96-byte mipmap, and the budget allows one of them per frame.
+		// The ring holds two of them with 64 bytes left over at the end.
+
+		UploadManager *manager = new UploadManager(kRingSize, 96);
+		uint32 imageSize = TextureLayout::CalculateImageSize(TextureLayout::kType2D, TextureLayout::kFormatLinearRgba, kTextureWidth, kTextureHeight, 1, 1);
+
+		for (machine k = 0; k < kTextureCount; k++)
+		{
+			image[k] = CreateTestImage(imageSize, uint32(k));
+			texture[k] = new Texture(Texture::kType2D, Texture::kFormatLinearRgba, kTextureWidth, kTextureHeight, 1, 1, nullptr);
+			manager->UploadTexture(texture[k], image[k]);
+		}
+
+		bool success = true;
+
+		manager->ProcessUploads();
+		manager->ProcessUploads();
+		success &= Check((recorder.GetUploadCount() == 2) && (recorder.GetUploadRecord(0).imageAddress == 0) && (recorder.GetUploadRecord(1).imageAddress == 96), "the first two mipmaps are staged one after the other");
+		success &= Check(manager->GetRingUsedSize() == 192, "the ring holds the first two mipmaps");
+
+		// When the first fence is signaled, its space at the beginning of the ring is reclaimed, and
+		// the third mipmap doesn't fit at the end, so it wraps around to the beginning. The space
+		// skipped at the end is counted as used until the mipmap's fence is signaled.
+
+		recorder.SignalFences(1);
+		manager->ProcessUploads();
+		success &= Check((recorder.GetUploadCount() == 3) && (recorder.GetUploadRecord(2).imageAddress == 0), "the third mipmap wraps around to the beginning of the ring");
+		success &= Check(manager->GetRingUsedSize() == kRingSize, "the space skipped at the end of the ring is counted as used");
+
+		// The ring is full, so nothing can be staged until another fence is signaled, and no
+		// fence is inserted for a frame that staged nothing.
+
+		manager->ProcessUploads();
+		success &= Check((recorder.GetUploadCount() == 3) && (recorder.GetFenceCount() == 3), "nothing is staged while the ring is full");
+
+		recorder.SignalFences(1);
+		manager->ProcessUploads();
+		success &= Check((recorder.GetUploadCount() == 4) && (recorder.GetUploadRecord(3).imageAddress == 96), "the fourth mipmap reuses the space of the second");
+		success &= Check(manager->GetRingUsedSize() == kRingSize, "the skipped space stays used until the third fence is signaled");
+
+		recorder.SignalAllFences();
+		manager->ProcessUploads();
+		success &= Check(manager->GetRingUsedSize() == 0, "the ring is empty when every fence is signaled");
+		success &= Check((!manager->UploadsPending()) && (recorder.GetLiveFenceCount() == 0), "every fence is deleted");
+
+		for (machine a = 0; a < recorder.GetUploadCount(); a++)
+		{
+			success &= CheckUploadData(recorder.GetUploadRecord(int32(a)), image[a], Texture::kFormatLinearRgba, kTextureWidth, kTextureHeight);
+		}
+
+		delete manager;
+
+		for (machine k = 0; k < kTextureCount; k++)
+		{
+			texture[k]->Release();
+			delete[] image[k];
+		}
+
+		return (success);
+	}
+
+	bool TestFenceRetirement(void)
+	{
+		enum
+		{
+			kTextureSize		= 16,
+			kMipmapCount		= 5
+		};
+
+		GLRecorder		recorder;
+		int32			releaseCount = 0;
+
+		// With a 16-byte budget, the two smallest mipmaps are staged in separate frames, and each
+		// larger mipmap gets a frame of its own.
+
+		UploadManager *manager = new UploadManager(0x10000, 16);
+		uint32 imageSize = TextureLayout::CalculateImageSize(TextureLayout::kType2D, TextureLayout::kFormatLinearRgba, kTextureSize, kTextureSize, 1, kMipmapCount);
+		uint8 *image = CreateTestImage(imageSize, 5);
+
+		Texture *texture = new Texture(Texture::kType2D, Texture::kFormatLinearRgba, kTextureSize, kTextureSize, 1, kMipmapCount, nullptr);
+		GLuint textureObject = recorder.GetLastTexture();
+		manager->UploadTexture(texture, image, &CountRelease, &releaseCount);
+		texture->RequestDetail(0.0F);
+
+		bool success = true;
+
+		manager->ProcessUploads();
+		success &= Check((recorder.GetUploadCount() == 1) && (recorder.GetUploadRecord(0).mipmapIndex == 4), "the smallest mipmap is staged first");
+		success &= Check(!texture->GetReadyFlag(), "a texture isn't ready before its first fence is signaled");
+
+		manager->ProcessUploads();
+		success &= Check((recorder.GetUploadCount() == 2) && (!texture->GetReadyFlag()) && (recorder.GetBaseLevel(textureObject) == -1), "an unsignaled fence is not retired");
+		success &= Check(recorder.GetLiveFenceCount() == 2, "each frame that stages a mipmap inserts a fence");
+
+		// Only the first fence is signaled, so only the smallest mipmap becomes resident.
+
+		recorder.SignalFences(1);
+		manager->ProcessUploads();
+		success &= Check((texture->GetReadyFlag()) && (texture->GetResidentMipmap() == 4) && (recorder.GetBaseLevel(textureObject) == 4), "a signaled fence makes its mipmap resident");
+		success &= Check(recorder.GetLiveFenceCount() == 2, "a retired fence is deleted");
+
+		manager->ProcessUploads();
+		manager->ProcessUploads();
+		success &= Check(recorder.GetUploadCount() == kMipmapCount, "every mipmap is staged");
+		success &= Check(releaseCount == 1, "the image is released when the largest mipmap has been copied");
+		success &= Check(texture->GetResidentMipmap() == 4, "mipmaps don't become resident before their fences are signaled");
+
+		recorder.SignalAllFences();
+		manager->ProcessUploads();
+		success &= Check((texture->GetResidentMipmap() == 0) && (recorder.GetBaseLevel(textureObject) == 0), "the largest mipmap becomes resident when its fence is signaled");
+		success &= Check((!manager->UploadsPending()) && (recorder.GetLiveFenceCount() == 0), "every fence is retired");
+		success &= Check(texture->GetReferenceCount() == 1, "the upload manager releases the texture");
+
+		for (machine a = 0; a < recorder.GetUploadCount(); a++)
+		{
+			success &= CheckUploadData(recorder.GetUploadRecord(int32(a)), image, Texture::kFormatLinearRgba, kTextureSize, kTextureSize);
+		}
+
+		delete manager;
+
+		texture->Release();
+		delete[] image;
+
+		return (success);
+	}
+
+	bool TestDirectUpload(void)
+	{
+		enum
+		{
+			kTextureSize		= 16,
+			kMipmapCount		= 2,
+			kRingSize			= 256
+		};
+
+		GLRecorder		recorder;
+
+		// The largest mipmap occupies 1024 bytes, which doesn't fit in the ring, so it is uploaded
+		// directly from the image with no buffer bound. The smaller mipmap still goes through the ring.
+
+		UploadManager *manager = new UploadManager(kRingSize, 0x10000);
+		uint32 imageSize = TextureLayout::CalculateImageSize(TextureLayout::kType2D, TextureLayout::kFormatLinearRgba, kTextureSize, kTextureSize, 1, kMipmapCount);
+		uint8 *image = CreateTestImage(imageSize, 9);
+
+		Texture *texture = new Texture(Texture::kType2D, Texture::kFormatLinearRgba, kTextureSize, kTextureSize, 1, kMipmapCount, nullptr);
+		manager->UploadTexture(texture, image);
+		texture->RequestDetail(0.0F);
+
+		manager->ProcessUploads();
+
+		bool success = Check(recorder.GetUploadCount() == 2, "both mipmaps are uploaded in one frame");
+		if (success)
+		{
+			const GLRecorder::UploadRecord& small = recorder.GetUploadRecord(0);
+			const GLRecorder::UploadRecord& large = recorder.GetUploadRecord(1);
+
+			success &= Check((small.mipmapIndex == 1) && (small.unpackBuffer != 0) && (small.imageAddress == 0), "the small mipmap is staged in the ring");
+			success &= Check((large.mipmapIndex == 0) && (large.unpackBuffer == 0) && (large.imageAddress == GetPointerAddress(image)), "the large mipmap is uploaded from the image");
+			success &= CheckUploadData(small, image, Texture::kFormatLinearRgba, kTextureSize, kTextureSize);
+			success &= CheckUploadData(large, image, Texture::kFormatLinearRgba, kTextureSize, kTextureSize);
+		}
+
+		success &= Check(manager->GetRingUsedSize() == 256, "only the small mipmap occupies the ring");
+
+		recorder.SignalAllFences();
+		manager->ProcessUploads();
+		success &= Check(texture->GetResidentMipmap() == 0, "the directly uploaded mipmap becomes resident with its fence");
+
+		delete manager;
+
+		texture->Release();
+		delete[] image;
+
+		return (success);
+	}
+
+
+	bool TestSurfaceUpdate(void)
+	{
+		enum
+		{
+			kSurfaceSize		= 64
+		};
+
+		GLRecorder		recorder;
+
+		// The heights are changed inside a rectangle in the interior of the map and inside one in a
+		// corner, whose rebake footprint wraps around both edges. After both updates, the mipmaps
+		// kept by the surface and the contents of its textures must be identical to those of a
+		// surface baked in one piece from the edited heights. The first mipmap of each chain is
+		// the baked map itself.
+
+		int32 pixelCount = kSurfaceSize * kSurfaceSize;
+		Color4U *heightMap = new Color4U[pixelCount];
+		for (int32 a = 0; a < pixelCount; a++)
+		{
+			uint32 height = (a * 7 + (a >> 6) * 13 + ((a * a) >> 9)) & 0xFF;
+			heightMap[a].Set(height, height, height);
+		}
+
+		EditableSurface *surface = new EditableSurface(heightMap, kSurfaceSize, kSurfaceSize, 4.0F);
+		int32 mipmapCount = surface->GetMipmapCount();
+		int32 previousCount = recorder.GetUploadCount();
+
+		// The surface creates its normal texture and then its horizon texture, and the recorder
+		// names objects consecutively.
+
+		GLuint horizonObject = recorder.GetLastTexture();
+		GLuint normalObject = horizonObject - 1;
+
+		uint32 normalSize = CalculateMipmapImageSize(Integer3D(kSurfaceSize, kSurfaceSize, 1), sizeof(Color2S));
+		uint32 horizonSize = CalculateMipmapImageSize(Integer3D(kSurfaceSize, kSurfaceSize, 2), sizeof(Color4U));
+
+		char *originalNormalImage = new char[normalSize];
+		CopyMemory(surface->GetNormalMipmapImages(), originalNormalImage, normalSize);
+
+		const Rect editRect[2] = {Rect(20, 24, 30, 31), Rect(58, 1, 64, 7)};
+		Color4U *editMap = surface->GetHeightMap();
+
+		for (const Rect& rect : editRect)
+		{
+			for (int32 y = rect.min.y; y < rect.max.y; y++)
+			{
+				for (int32 x = rect.min.x; x < rect.max.x; x++)
+				{
+					uint32 height = 255 - ((x * 11 + y * 5) & 0x3F);
+					editMap[y * kSurfaceSize + x].Set(height, height, height);
+				}
+			}
+
+			surface->UpdateSurface(rect);
+		}
+
+		// The interior footprint lies inside the map, and the corner footprint is split into four
+		// rectangles. Each one updates every mipmap of both textures.
+
+		bool success = Check(recorder.GetUploadCount() - previousCount == (1 + 4) * 2 * mipmapCount, "each wrapped rectangle updates every mipmap of both textures");
+
+		EditableSurface *reference = new EditableSurface(editMap, kSurfaceSize, kSurfaceSize, 4.0F);
+		const Color2S *referenceNormalImage = reference->GetNormalMipmapImages();
+		const Color4U *referenceHorizonImage = reference->GetHorizonMipmapImages();
+
+		success &= Check(memcmp(originalNormalImage, referenceNormalImage, normalSize) != 0, "the edits change the normal map");
+		success &= Check(reference->GetMipmapCount() == mipmapCount, "the reference has the same number of mipmaps");
+		success &= Check(memcmp(surface->GetNormalMipmapImages(), referenceNormalImage, normalSize) == 0, "the rebaked normal mipmaps match a full bake");
+		success &= Check(memcmp(surface->GetHorizonMipmapImages(), referenceHorizonImage, horizonSize) == 0, "the rebaked horizon mipmaps match a full bake");
+
+		const void *normalImage = recorder.GetTextureImage(normalObject);
+		const void *horizonImage = recorder.GetTextureImage(horizonObject);
+		success &= Check((normalImage) && (memcmp(normalImage, referenceNormalImage, normalSize) == 0), "the normal texture matches a full bake");
+		success &= Check((horizonImage) && (memcmp(horizonImage, referenceHorizonImage, horizonSize) == 0), "the horizon texture matches a full bake");
+
+		delete reference;
+		delete surface;
+		delete[] originalNormalImage;
+		delete[] heightMap;
+
+		return (success);
+	}
+
+
+	const UploadTest uploadTestTable[] =
+	{
+		{"Budget splitting", &TestBudgetSplitting},
+		{"Ring wrap", &TestRingWrap},
+		{"Fence retirement", &TestFenceRetirement},
+		{"Direct upload", &TestDirectUpload},
+		{"Surface update", &TestSurfaceUpdate}
+	};
+}
+
+
+int32 Framework::RunUploadTests(void)
+{
+	int32 failureCount = 0;
+
+	for (const UploadTest& test : uploadTestTable)
+	{
+		bool success = (*test.testFunction)();
+		failureCount += !success;
+
+		String<> string(test.testName);
+		string += (success) ? ": passed\n" : ": FAILED\n";
+		fputs(string, stdout);
+	}
+
+	String<> string("Upload tests: ");
+	string += failureCount;
+	string += " failed\n";
+	fputs(string, stdout);
+
+	return (failureCount);
+}
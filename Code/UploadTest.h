@@ -0,0 +1,161 @@
+#ifndef UploadTest_h
+#define UploadTest_h
+
+
+#include "Graphics.h"
+
+
+namespace Framework
+{
+	// The GLRecorder class stands in for the GL driver so that textures and the UploadManager can
+	// be tested without a context. The constructor replaces the GL function pointers that they call
+	// with functions that record the calls, and the destructor restores the original pointers. Only
+	// one recorder can exist at a time.
+	//
+	// Buffer storage is ordinary memory, so mapping it returns a pointer that the UploadManager
+	// writes into as it would write into driver memory. Every texture upload is recorded with the
+	// unpack buffer bound at the time, the offset or pointer it was given, and a checksum of the
+	// bytes it would read. Fences are signaled in the order they were inserted, but only when the
+	// test calls SignalFences(), so a test decides how far the simulated GPU has progressed.
+	//
+	// The recorder also keeps the contents of uncompressed 2D and 2D array textures, so a test
+	// can compare what a series of partial uploads left in a texture with the image it should
+	// hold. The storage has the same layout as the image passed to the Texture constructor.
+
+	class GLRecorder
+	{
+		public:
+
+			struct UploadRecord
+			{
+				GLuint				textureObject;
+				int32				mipmapIndex;
+				GLuint				unpackBuffer;
+				machine_address		imageAddress;
+				uint32				imageSize;
+				uint64				imageChecksum;
+			};
+
+			struct BaseLevelRecord
+			{
+				GLuint				textureObject;
+				int32				baseLevel;
+			};
+
+			struct TextureImage
+			{
+				GLuint				textureObject;
+				int32				textureWidth;
+				int32				textureHeight;
+				int32				textureDepth;
+				int32				levelCount;
+				char				*imageStorage;
+			};
+
+		private:
+
+			GLuint					objectCount;
+			GLuint					lastTexture;
+			GLuint					unpackBuffer;
+
+			char					*bufferStorage;
+			uint32					bufferSize;
+
+			int32					fenceCount;
+			int32					signaledCount;
+			int32					liveFenceCount;
+
+			Array<UploadRecord>		uploadArray;
+			Array<BaseLevelRecord>	baseLevelArray;
+			Array<TextureImage>		textureImageArray;
+
+			const void *GetUploadData(const void *image) const;
+			TextureImage *FindTextureImage(GLuint texture);
+
+			void RecordUpload(GLuint texture, int32 mipmap, uint32 size, const void *image);
+			void StoreImage(GLuint texture, int32 level, int32 x, int32 y, int32 z, int32 width, int32 height, int32 depth, uint32 pixelSize, const void *image);
+
+			static void CreateBuffers(GLsizei count, GLuint *buffer);
+			static void CreateTextures(GLenum target, GLsizei count, GLuint *texture);
+			static void DeleteBuffers(GLsizei count, const GLuint *buffer);
+			static void BindBuffer(GLenum target, GLuint buffer);
+			static void NamedBufferStorage(GLuint buffer, GLsizeiptr size, const void *data, GLbitfield flags);
+			static void *MapNamedBufferRange(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access);
+			static GLboolean UnmapNamedBuffer(GLuint buffer);
+			static void TextureStorage2D(GLuint texture, GLsizei levels, GLenum format, GLsizei width, GLsizei height);
+			static void TextureStorage3D(GLuint texture, GLsizei levels, GLenum format, GLsizei width, GLsizei height, GLsizei depth);
+			static void TextureParameteri(GLuint texture, GLenum name, int param);
+			static void TextureParameterf(GLuint texture, GLenum name, float param);
+			static void TextureSubImage2D(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+			static void TextureSubImage3D(GLuint texture, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels);
+			static void CompressedTextureSubImage2D(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLsizei size, const void *data);
+			static void CompressedTextureSubImage3D(GLuint texture, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei size, const void *data);
+			static GLsync FenceSync(GLenum condition, GLbitfield flags);
+			static void DeleteSync(GLsync sync);
+			static GLenum ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout);
+
+		public:
+
+			GLRecorder();
+			~GLRecorder();
+
+			GLuint GetLastTexture(void) const
+			{
+				return (lastTexture);
+			}
+
+			int32 GetUploadCount(void) const
+			{
+				return (uploadArray.GetArrayElementCount());
+			}
+
+			const UploadRecord& GetUploadRecord(int32 index) const
+			{
+				return (uploadArray[index]);
+			}
+
+			int32 GetFenceCount(void) const
+			{
+				return (fenceCount);
+			}
+
+			int32 GetLiveFenceCount(void) const
+			{
+				return (liveFenceCount);
+			}
+
+			// GetBaseLevel() returns the last base level set for a texture object, or -1 if none
+			// has been set since the texture was created.
+
+			int32 GetBaseLevel(GLuint texture) const;
+
+			// GetTextureImage() returns the contents of all mipmaps of a texture object, or nullptr if
+			// the texture is compressed, isn't a 2D or 2D array texture, or hasn't received an upload.
+
+			const void *GetTextureImage(GLuint texture) const;
+
+			// SignalFences() signals the next count fences in the order they were inserted, and
+			// SignalAllFences() signals every fence inserted so far.
+
+			void SignalFences(int32 count);
+
+			void SignalAllFences(void)
+			{
+				signaledCount = fenceCount;
+			}
+
+			static uint64 CalculateChecksum(const void *data, uint32 size);
+	};
+
+
+	// The upload tests run the UploadManager against a GLRecorder and check how it splits uploads
+	// among frames, wraps around the ring, accounts for space skipped at the end of the ring, and
+	// retires fences. They also edit an EditableSurface and check that the rebaked maps, mipmaps,
+	// and texture contents match a full bake. They are built as their own console program, and
+	// RunUploadTests() returns the number of tests that failed.
+
+	int32 RunUploadTests(void);
+}
+
+
+#endif
@@ -0,0 +1,12 @@
+#include "UploadTest.h"
+
+
+using namespace Framework;
+
+
+int main(int argc, char **argv)
+{
+	// The exit code is nonzero if any upload test failed, so the tests can be run by scripts.
+
+	return ((RunUploadTests() == 0) ? 0 : 1);
+}
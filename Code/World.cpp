@@ -1,5 +1,7 @@
 ﻿#include "World.h"
 #include "OpenGEX.h"
+#include "Bake.h"
+#include "Encode.h"
 
 
 using namespace Framework;
@@ -360,6 +362,26 @@ bool GeometryNode::GeometryIlluminated(const PointLight *light) const
 	return (true);
 }
 
+float GeometryNode::CalculateNearestDistance(const Point3D& position) const
+{
+	return (0.0F);
+}
+
+float GeometryNode::GetTexcoordScale(void) const
+{
+	return (1.0F);
+}
+
+void GeometryNode::UpdateTextureDetail(const FrustumCamera *camera)
+{
+	// At a distance d, one pixel covers 2d / (gh) world units, where g is the projection distance
+	// and h is the viewport height in pixels. Distances are clamped to the near plane.
+
+	float distance = Fmax(CalculateNearestDistance(camera->GetWorldPosition()), camera->nearDepth);
+	float pixelSize = distance * 2.0F / (camera->projectionDistance * graphicsManager->GetViewportHeight());
+	RequestTextureDetail(pixelSize * GetTexcoordScale());
+}
+
 
 MeshGeometry::MeshGeometry(int32 vertexCount, int32 triangleCount, Vertex *vertexArray, Triangle *triangleArray) : GeometryNode(kGeometryMesh)
 {
@@ -499,6 +521,18 @@ bool SphereGeometry::GeometryIlluminated(const PointLight *light) const
 	return (light->SphereIlluminated(GetWorldPosition(), sphereRadius));
 }
 
+float SphereGeometry::CalculateNearestDistance(const Point3D& position) const
+{
+	return (Fmax(Magnitude(position - GetWorldPosition()) - sphereRadius, 0.0F));
+}
+
+float SphereGeometry::GetTexcoordScale(void) const
+{
+	// The texture repeats four times around the equator and twice from pole to pole.
+
+	return (4.0F / (Math::tau * sphereRadius));
+}
+
 
 BoxGeometry::BoxGeometry(const Vector3D& size) : GeometryNode(kGeometryBox)
 {
@@ -714,6 +748,13 @@ bool BoxGeometry::GeometryIlluminated(const PointLight *light) const
 	return (light->BoxIlluminated(GetWorldTransform(), boxSize));
 }
 
+float BoxGeometry::CalculateNearestDistance(const Point3D& position) const
+{
+	Point3D p = GetInverseWorldTransform() * position;
+	Point3D q(Clamp(p.x, 0.0F, boxSize.x), Clamp(p.y, 0.0F, boxSize.y), Clamp(p.z, 0.0F, boxSize.z));
+	return (Magnitude(p - q));
+}
+
 
 TextGeometry::TextGeometry(Font *font, float size, const char *text, const Color4U& color) : GeometryNode(kGeometryText)
 {
@@ -791,13 +832,26 @@ TextGeometry::TextGeometry(Font *font, float size, const char *text, const Color
 
 	Slug::GetShaderIndices(0, &vertexIndex, &fragmentIndex);
 
-	vertexStringArray[0] = fragmentStringArray[0] = "#version 450\n";
-	int32 vertexStringCount = Slug::GetVertexShaderSourceCode(vertexIndex, &vertexStringArray[1], Slug::kVertexShaderProlog);
-	int32 fragmentStringCount = Slug::GetFragmentShaderSourceCode(fragmentIndex, &fragmentStringArray[1], Slug::kFragmentShaderProlog);
-	vertexStringArray[vertexStringCount + 1] = vertexMain;
-	fragmentStringArray[fragmentStringCount + 1] = fragmentMain;
+	// All text geometries using the same shader indices share one program.
+
+	String<> programName("Slug ");
+	programName += int32(vertexIndex);
+	programName += " ";
+	programName += int32(fragmentIndex);
+
+	Program *program = resourceManager->FindProgram(programName);
+	if (!program)
+	{
+		vertexStringArray[0] = fragmentStringArray[0] = "#version 450\n";
+		int32 vertexStringCount = Slug::GetVertexShaderSourceCode(vertexIndex, &vertexStringArray[1], Slug::kVertexShaderProlog);
+		int32 fragmentStringCount = Slug::GetFragmentShaderSourceCode(fragmentIndex, &fragmentStringArray[1], Slug::kFragmentShaderProlog);
+		vertexStringArray[vertexStringCount + 1] = vertexMain;
+		fragmentStringArray[fragmentStringCount + 1] = fragmentMain;
+
+		program = new Program(vertexStringCount + 2, vertexStringArray, fragmentStringCount + 2, fragmentStringArray);
+		resourceManager->AddProgram(programName, program);
+	}
 
-	Program *program = new Program(vertexStringCount + 2, vertexStringArray, fragmentStringCount + 2, fragmentStringArray);
 	SetProgram(0, program);
 	program->Release();
 }
@@ -1085,6 +1139,7 @@ void WorldManager::RenderWorld(int32 *ambientDrawCount, int32 *lightDrawCount, i
 			{
 				visibleGeometryArray.AppendArrayElement(geometryNode);
 
+				geometryNode->UpdateTextureDetail(cameraNode);
 				geometryNode->PrepareToRender(viewProjectionMatrix);
 				geometryNode->Render(0);
 			}
@@ -1142,194 +1197,748 @@ void WorldManager::RenderOverlay(void)
 	}
 }
 
-void WorldManager::ConstructNormalMap(const Color4U *heightMap, Color2S *normalMap, int32 width, int32 height, float scale)
+void WorldManager::ConstructNormalMap(const Color4U *heightMap, Color2S *normalMap, int32 width, int32 height, float scale, int32 threadCount)
 {
-	for (int32 y = 0; y < height; y++)
+	SurfaceMapSet	mapSet;
+
+	mapSet.normalMap = normalMap;
+	mapSet.parallaxMap = nullptr;
+	mapSet.horizonMap = nullptr;
+	mapSet.ambientMap = nullptr;
+	mapSet.parallaxScale = 1.0F;
+	mapSet.ambientPower = 1.0F;
+
+	BakeSurfaceMaps(heightMap, &mapSet, width, height, scale, threadCount);
+}
+
+void WorldManager::ConstructParallaxMap(const Color4U *heightMap, Color1S *parallaxMap, Color1U *coneMap, int32 width, int32 height, float scale)
+{
+	// The parallax map holds heights multiplied by the scale, and the optional cone map holds
+	// the cone ratio for each texel so that a relief shader can take large steps where nothing
+	// is in the way.
+
+	SurfaceMapSet	mapSet;
+
+	mapSet.normalMap = nullptr;
+	mapSet.parallaxMap = parallaxMap;
+	mapSet.horizonMap = nullptr;
+	mapSet.ambientMap = nullptr;
+	mapSet.parallaxScale = scale;
+	mapSet.ambientPower = 1.0F;
+
+	BakeSurfaceMaps(heightMap, &mapSet, width, height, 1.0F, BAKE_THREAD_COUNT);
+
+	if (coneMap)
 	{
-		int32 ym1 = (y - 1) & (height - 1);
-		int32 yp1 = (y + 1) & (height - 1);
+		BakeConeMap(heightMap, coneMap, width, height, BAKE_THREAD_COUNT);
+	}
+}
+
+void WorldManager::ConstructHorizonMap(const Color4U *heightMap, Color4U *horizonMap, int32 width, int32 height, float scale)
+{
+	// Construct the two layers as two four-channel images stored one after the other.
+	// The brute-force reference always searches kHorizonRadius, and the faster modes
+	// search the larger HORIZON_SEARCH_RADIUS. Errors are reported against a brute-force
+	// bake over the same radius.
+
+	#if HORIZON_BAKE_MODE == 2
+
+		BakeHorizonMapPyramid(heightMap, horizonMap, width, height, scale, HORIZON_SEARCH_RADIUS, HORIZON_PYRAMID_ERROR, BAKE_THREAD_COUNT);
+
+	#elif HORIZON_BAKE_MODE == 1
+
+		BakeHorizonMapSweep(heightMap, horizonMap, width, height, scale, HORIZON_SEARCH_RADIUS, BAKE_THREAD_COUNT);
+
+	#else
+
+		BakeHorizonMap(heightMap, horizonMap, width, height, scale, BAKE_THREAD_COUNT);
+
+	#endif
+
+	#if REPORT_HORIZON_ERROR && (HORIZON_BAKE_MODE != 0)
+
+		HorizonErrorReport		report;
 
-		const Color4U *centerRow = heightMap + y * width;
-		const Color4U *upperRow = heightMap + ym1 * width;
-		const Color4U *lowerRow = heightMap + yp1 * width;
+		Color4U *exactMap = new Color4U[width * height * 2];
+		BakeHorizonMap(heightMap, exactMap, width, height, scale, BAKE_THREAD_COUNT, HORIZON_SEARCH_RADIUS);
+		CompareHorizonMaps(exactMap, horizonMap, width, height, &report);
+		OutputHorizonErrorReport("Horizon map", &report);
+		delete[] exactMap;
 
-		for (int32 x = 0; x < width; x++)
+	#endif
+}
+
+int32 WorldManager::ConstructNormalMipmaps(const Color4U *heightMap, const Integer2D& size, float scale, Color2S **image, int32 threadCount)
+{
+	#if USE_BAKE_CACHE
+
+		int32		mipmapCount;
+
+		uint64 key = CalculateBakeCacheKey(heightMap, size.x, size.y, kBakeMapNormal, scale);
+		void *cachedImage = LoadBakeCache(key, Integer3D(size, 1), sizeof(Color2S), &mipmapCount);
+		if (cachedImage)
 		{
-			int32 xm1 = (x - 1) & (width - 1);
-			int32 xp1 = (x + 1) & (width - 1);
+			*image = static_cast<Color2S *>(cachedImage);
+			return (mipmapCount);
+		}
+
+	#endif
+
+	Color2S *normalMap = new Color2S[size.x * size.y];
+	ConstructNormalMap(heightMap, normalMap, size.x, size.y, scale, threadCount);
+
+	int32 count = GenerateMipmapImages(Integer3D(size, 1), normalMap, image);
+	delete[] normalMap;
+
+	#if USE_BAKE_CACHE
+
+		StoreBakeCache(key, count, *image, CalculateMipmapImageSize(Integer3D(size, 1), sizeof(Color2S)));
+
+	#endif
+
+	return (count);
+}
+
+int32 WorldManager::ImportColorMipmaps(const char *name, Integer2D *size, Color4U **image, int32 threadCount)
+{
+	// The color map is decoded directly into level 0 of the mipmap chain, and the remaining
+	// levels are built in place. The chain must be released with ReleaseMipmapImages().
+
+	File file(name);
+	if (!GetTargaImageSize(file, size))
+	{
+		return (0);
+	}
+
+	Integer3D chainSize(*size, 1);
+	Color4U *pixelData = new Color4U[CalculateMipmapImageSize(chainSize, 1)];
+	DecodeTargaImage(file, pixelData);
+	*image = pixelData;
+
+	// Color maps are stored in the sRGB color space, so they are filtered in linear space.
+
+	#if USE_GAMMA_MIPMAPS
+
+		return (BuildGammaMipmapImages(chainSize, pixelData, GAMMA_MIPMAP_FILTER, threadCount));
 
-			// Calculate slopes.
-			float dx = float(centerRow[xp1].red - centerRow[xm1].red) * (0.5F / 255.0F) * scale;
-			float dy = float(lowerRow[x].red - upperRow[x].red) * (0.5F / 255.0F) * scale;
+	#else
 
-			// Normalize and clamp.
-			float nz = 1.0F / Sqrt(dx * dx + dy * dy + 1.0F);
-			float nx = Clamp(-dx * nz, -1.0F, 1.0F);
-			float ny = Clamp(-dy * nz, -1.0F, 1.0F);
+		return (BuildMipmapImages(chainSize, pixelData));
 
-			normalMap[x].red = int8(nx * 127.0F);
-			normalMap[x].green = int8(ny * 127.0F);
+	#endif
+}
+
+void WorldManager::GenerateHorizonCube(Color4U *texel)
+{
+	Framework::GenerateHorizonCube(texel);
+}
+
+namespace
+{
+	enum
+	{
+		kWorldTextureFloorDiffuse,
+		kWorldTextureFloorNormal,
+		kWorldTextureWallDiffuse,
+		kWorldTextureWallNormal,
+		kWorldTextureTrunkDiffuse,
+		kWorldTextureTrunkNormal,
+		kWorldTextureBranchDiffuse,
+		kWorldTextureBranchTransmission,
+		kWorldTextureBranchNormal,
+		kWorldTextureGoblinDiffuse,
+		kWorldTextureGoblinSpecular,
+		kWorldTextureGoblinNormal,
+		kWorldTextureCount
+	};
+
+
+	// The textures are listed in the order in which the world build binds them, so the
+	// first ones needed are the first ones prepared. A normal scale of zero marks a color map.
+
+	struct WorldTextureData
+	{
+		const char		*fileName;
+		float			normalScale;
+	};
+
+
+	const WorldTextureData worldTextureTable[kWorldTextureCount] =
+	{
+		{"Textures/StoneFloor-diff.tga", 0.0F},
+		{"Textures/StoneFloor-nrml.tga", 16.0F},
+		{"Textures/StoneWall-diff.tga", 0.0F},
+		{"Textures/StoneWall-nrml.tga", 16.0F},
+		{"Textures/Trunk-diff.tga", 0.0F},
+		{"Textures/Trunk-nrml.tga", 16.0F},
+		{"Textures/Branch-diff.tga", 0.0F},
+		{"Textures/Branch-xmit-spec.tga", 0.0F},
+		{"Textures/Branch-nrml.tga", 16.0F},
+		{"Textures/Goblin-diff.tga", 0.0F},
+		{"Textures/Goblin-spec.tga", 0.0F},
+		{"Textures/Goblin-nrml.tga", 16.0F}
+	};
+
+
+	void AddWorldTextures(TexturePipeline *pipeline)
+	{
+		static const int32 floorIndex[2] = {kWorldTextureFloorDiffuse, kWorldTextureFloorNormal};
+		static const int32 wallIndex[2] = {kWorldTextureWallDiffuse, kWorldTextureWallNormal};
+
+		for (machine a = 0; a < kWorldTextureCount; a++)
+		{
+			const WorldTextureData *data = &worldTextureTable[a];
+			if (data->normalScale == 0.0F)
+			{
+				pipeline->AddColorTexture(data->fileName);
+			}
+			else
+			{
+				pipeline->AddNormalTexture(data->fileName, data->normalScale);
+			}
+		}
+
+		// The stone textures are packed into array textures so that the walls, boxes, and spheres
+		// share texture bindings and select their images with a layer index in the third fragment
+		// parameter. Only textures of the same size can share an array, and the floor images are
+		// half the size of the wall images, so the floor has arrays of its own.
+
+		pipeline->PackTextureArray(2, floorIndex);
+		pipeline->PackTextureArray(2, wallIndex);
+	}
+
+
+	// The build key of a cooked texture is a checksum of everything besides the source image
+	// and the format that changes the texture built for a job.
+
+	struct TextureBuildParams
+	{
+		int32		jobType;
+		float		normalScale;
+		int32		mipmapFilter;
+		int32		encoderVersion;
+	};
+
+
+	bool CookedFormatMatches(int32 cookedFormat, int32 buildFormat)
+	{
+		// A color texture built in BC1 is stored in BC3 instead when its alpha channel is used.
+
+		return ((cookedFormat == buildFormat) || ((buildFormat == Texture::kFormatGammaBC1) && (cookedFormat == Texture::kFormatGammaBC3)));
+	}
+
+	uint64 CalculateTextureBuildKey(int32 jobType, float normalScale)
+	{
+		TextureBuildParams		params;
+
+		params.jobType = jobType;
+		params.normalScale = normalScale;
+
+		#if USE_GAMMA_MIPMAPS
+
+			params.mipmapFilter = GAMMA_MIPMAP_FILTER;
+
+		#else
+
+			params.mipmapFilter = -1;
+
+		#endif
+
+		params.encoderVersion = kTextureEncoderVersion;
+		return (CalculateBakeChecksum(&params, sizeof(TextureBuildParams)));
+	}
+
+	bool CookedStampMatches(const CookedTextureStamp& cookedStamp, const CookedTextureStamp& buildStamp, bool sourceFlag)
+	{
+		// When the source image is not a separate file, as when it is read from an asset pack,
+		// only the build key can be checked.
+
+		if (cookedStamp.buildKey != buildStamp.buildKey)
+		{
+			return (false);
+		}
+
+		return ((!sourceFlag) || ((cookedStamp.sourceSize == buildStamp.sourceSize) && (cookedStamp.sourceTime == buildStamp.sourceTime)));
+	}
+
+	bool OpaqueImage(const Color4U *image, int32 pixelCount)
+	{
+		for (machine a = 0; a < pixelCount; a++)
+		{
+			if (image[a].alpha != 255)
+			{
+				return (false);
+			}
 		}
 
-		normalMap += width;
+		return (true);
+	}
+
+	void ReleaseCookedTexture(void *cookie)
+	{
+		delete static_cast<CookedTexture *>(cookie);
 	}
 }
 
-void WorldManager::ConstructParallaxMap(const Color4U *heightMap, Color1S *parallaxMap, int32 width, int32 height, float scale)
+
+TexturePipeline::TexturePipeline(int32 threadCount)
 {
-	// #PARALLAX -- Add code here to construct a single-channel parallax map.
+	jobCount = 0;
+	nextJob = 0;
+	arraySetCount = 0;
+	finishedCount = 0;
+	createdCount = 0;
+
+	workerCount = (threadCount > 0) ? threadCount : GetProcessorCount();
+	workerThread = nullptr;
+	cookFlag = false;
+}
 
+TexturePipeline::~TexturePipeline()
+{
+	// Wait for the workers before releasing anything, since jobs may still be running
+	// if some textures were never requested.
 
+	if (workerThread)
+	{
+		for (int32 a = 0; a < workerCount; a++)
+		{
+			delete workerThread[a];
+		}
+
+		delete[] workerThread;
+	}
+
+	for (int32 a = 0; a < jobCount; a++)
+	{
+		const TextureJob *job = &jobTable[a];
+		if (job->texture)
+		{
+			job->texture->Release();
+		}
+		else if (job->mipmapImages)
+		{
+			ReleaseMipmapImages(job->mipmapImages);
+		}
+
+		delete job->cookedTexture;
+	}
 }
 
-void WorldManager::ConstructHorizonMap(const Color4U *heightMap, Color4U *horizonMap, int32 width, int32 height, float scale)
+int32 TexturePipeline::AddJob(const char *name, int32 type, float scale)
 {
-	// #HORIZON -- Add code here to construct an eight-channel horizon map.
-	// Construct the two layers as two four-channel images stored one after the other.
-	// LISTING  7.10 - main
-	constexpr int kAngleCount = 32; // Must be at least 16 and a power of 2.
-	constexpr float kAngleIndex = float(kAngleCount) / float(2*3.14519);
-	constexpr int kHorizonRadius = 16;
-	for (int32 y = 0; y < height; y++)
+	int32 index = jobCount++;
+	TextureJob *job = jobTable.AppendArrayElement();
+
+	job->fileName = name;
+	job->jobType = type;
+
+	#if COMPRESS_TEXTURES
+
+		job->textureFormat = (type == kTextureJobColor) ? Texture::kFormatGammaBC1 : Texture::kFormatSignedBC5;
+
+	#else
+
+		job->textureFormat = (type == kTextureJobColor) ? Texture::kFormatGammaRgba : Texture::kFormatSignedRedGreen;
+
+	#endif
+
+	job->normalScale = scale;
+	job->mipmapCount = 0;
+	job->mipmapImages = nullptr;
+	job->cookedTexture = nullptr;
+	job->arraySet = -1;
+	job->arrayLayer = 0;
+	job->createdFlag = false;
+	job->texture = nullptr;
+
+	// A texture that is already resident needs no work, and the workers skip its job.
+
+	if (resourceManager)
 	{
-		const Color4U* centerRow = heightMap + y * width;
-		for (int32 x = 0; x < width; x++)
+		Texture *texture = resourceManager->FindTexture(GetResourceName(job));
+		if (texture)
 		{
-			// Get central height. Initialize max squared tangent array to all zeros.
-			float h0 = centerRow[x].red;
-			float maxTan2[kAngleCount] = {};
-			// Search neighborhood for larger heights.
-			for (int32 j = -kHorizonRadius + 1; j < kHorizonRadius; j++)
+			job->texture = texture;
+			job->createdFlag = true;
+		}
+	}
+
+	return (index);
+}
+
+String<> TexturePipeline::GetResourceName(const TextureJob *job)
+{
+	// Normal maps are named by the scale as well as the file, since the scale changes the result.
+
+	String<> name(job->fileName);
+	if (job->jobType == kTextureJobNormal)
+	{
+		name += " normal ";
+		name += String<>(job->normalScale);
+	}
+
+	return (name);
+}
+
+int32 TexturePipeline::AddColorTexture(const char *name)
+{
+	return (AddJob(name, kTextureJobColor, 0.0F));
+}
+
+int32 TexturePipeline::AddNormalTexture(const char *name, float scale)
+{
+	return (AddJob(name, kTextureJobNormal, scale));
+}
+
+void TexturePipeline::PackTextureArray(int32 count, const int32 *index)
+{
+	int32 set = arraySetCount++;
+	for (int32 a = 0; a < count; a++)
+	{
+		TextureJob *job = &jobTable[index[a]];
+		job->arraySet = set;
+
+		// An array is built from the images, so a texture found in the resource manager
+		// has to be built again.
+
+		if (job->texture)
+		{
+			job->texture->Release();
+			job->texture = nullptr;
+			job->createdFlag = false;
+		}
+	}
+}
+
+void TexturePipeline::StartPipeline(void)
+{
+	// The finished list is allocated before the workers start so that it never moves while
+	// they are appending to it.
+
+	finishedJob.SetArrayElementCount(jobCount);
+
+	workerCount = Min(workerCount, jobCount);
+	workerThread = new Thread *[workerCount];
+	for (int32 a = 0; a < workerCount; a++)
+	{
+		workerThread[a] = new Thread(&WorkerThread, this);
+	}
+}
+
+void TexturePipeline::CookTextures(void)
+{
+	// The cooked files are written by the worker threads, and the destructor waits for them.
+
+	cookFlag = true;
+	StartPipeline();
+}
+
+void TexturePipeline::WorkerThread(void *cookie)
+{
+	TexturePipeline *pipeline = static_cast<TexturePipeline *>(cookie);
+
+	// Jobs are claimed one at a time in the order they were added, and the index of each
+	// finished job is appended to the list that GetTexture() works through. The pipeline already
+	// runs one job on every worker, so each job is built on a single thread.
+
+	for (;;)
+	{
+		int32 index = AtomicIncrement(&pipeline->nextJob) - 1;
+		if (index >= pipeline->jobCount)
+		{
+			break;
+		}
+
+		TextureJob *job = &pipeline->jobTable[index];
+		if (job->createdFlag)
+		{
+			continue;
+		}
+
+		String<> cookedName = GetCookedTextureName(job->fileName);
+
+		CookedTextureStamp		stamp;
+		bool sourceFlag = GetCookedTextureStamp(job->fileName, CalculateTextureBuildKey(job->jobType, job->normalScale), &stamp);
+
+		// A cooked file is only used if it holds the same type and format that would be
+		// built from the source image, it was built with the same parameters, and the source
+		// image has not changed since it was cooked. Otherwise, the source image is used.
+
+		if (!pipeline->cookFlag)
+		{
+			CookedTexture *cookedTexture = new CookedTexture;
+			if (cookedTexture->Open(cookedName))
 			{
-				const Color4U* row = heightMap + ((y + j) & (height - 1)) * width;
-				for (int32 i = -kHorizonRadius + 1; i < kHorizonRadius; i++)
+				const CookedTextureHeader *header = cookedTexture->GetHeader();
+				if ((header->textureType == Texture::kType2D) && (CookedFormatMatches(header->textureFormat, job->textureFormat)) && (CookedStampMatches(header->textureStamp, stamp, sourceFlag)))
 				{
-					int32 r2 = i * i + j * j;
-					if ((r2 < kHorizonRadius * kHorizonRadius) && (r2 != 0))
-					{
-						float dh = row[(x + i) & (width - 1)].red - h0;
-						if (dh > 0.0F)
-						{
-							// Larger height found. Apply to array entries.
-							float direction = atan2(float(j), float(i));
-							float delta = atan(0.7071F / sqrt(float(r2)));
-							int32 minIndex = int32(floor((direction - delta) * kAngleIndex));
-							int32 maxIndex = int32(ceil((direction + delta) * kAngleIndex));
-							// Calculate squared tangent with Equation (7.53). 
-							float t = dh * dh / float(r2);
-							for (int32 n = minIndex; n <= maxIndex; n++)
-							{
-								int32 m = n & (kAngleCount - 1);
-								maxTan2[m] = fmax(maxTan2[m], t);
-							}
-						}
-					}
+					job->cookedTexture = cookedTexture;
+				}
+			}
+
+			if (!job->cookedTexture)
+			{
+				delete cookedTexture;
+			}
+		}
+
+		if (!job->cookedTexture)
+		{
+			if (job->jobType == kTextureJobColor)
+			{
+				Color4U		*colorMipmapImages;
+
+				job->mipmapCount = WorldManager::ImportColorMipmaps(job->fileName, &job->imageSize, &colorMipmapImages, 1);
+				if (job->mipmapCount != 0)
+				{
+					job->mipmapImages = colorMipmapImages;
 				}
 			}
-		
-			// Generate eight channels of horizon map.
-			Color4U* layerData = horizonMap;
-			for (int32 layer = 0; layer < 2; layer++)
+			else
 			{
-				ColorRgba color(0.0F, 0.0F, 0.0F, 0.0F);
-				int32 firstIndex = kAngleCount / 16 + layer * (kAngleCount / 2);
-				int32 lastIndex = firstIndex + kAngleCount / 8;
-				for (int32 index = firstIndex; index <= lastIndex; index++)
+				Color4U		*textureImage;
+				Color2S		*normalMipmapImages;
+
+				if (ImportTargaImageFile(job->fileName, &textureImage, &job->imageSize))
 				{
-					float tr = maxTan2[(index - kAngleCount / 8) & (kAngleCount - 1)];
-					float tg = maxTan2[index];
-					float tb = maxTan2[index + kAngleCount / 8];
-					float ta = maxTan2[(index + kAngleCount / 4) & (kAngleCount - 1)];
-					color.red += sqrt(tr / (tr + 1.0F));
-					color.green += sqrt(tg / (tg + 1.0F));
-					color.blue += sqrt(tb / (tb + 1.0F));
-					color.alpha += sqrt(ta / (ta + 1.0F));
+					job->mipmapCount = WorldManager::ConstructNormalMipmaps(textureImage, job->imageSize, job->normalScale, &normalMipmapImages, 1);
+					job->mipmapImages = normalMipmapImages;
+					ReleaseTargaImageData(textureImage);
 				}
-				layerData[x] = color / float(kAngleCount / 8 + 1);
-				layerData += width * height;
 			}
-			// Generate ambient light factor.
-			float sum = 0.0F;
-			for (int32 k = 0; k < kAngleCount; k++) sum += 1.0F / sqrt(maxTan2[k] + 1.0F);
-			//ambientMap[x] = pow(sum * float(kAngleCount), ambientPower);
+
+			#if COMPRESS_TEXTURES
+
+				if (job->mipmapImages)
+				{
+					Integer3D size(job->imageSize, 1);
+
+					if ((job->jobType == kTextureJobColor) && (!OpaqueImage(static_cast<Color4U *>(job->mipmapImages), size.x * size.y)))
+					{
+						job->textureFormat = Texture::kFormatGammaBC3;
+					}
+
+					void *compressedImages = CompressTextureImage(size, job->mipmapCount, job->textureFormat, job->mipmapImages, 1);
+					ReleaseMipmapImages(job->mipmapImages);
+					job->mipmapImages = compressedImages;
+				}
+
+			#endif
+
+			if ((pipeline->cookFlag) && (job->mipmapImages))
+			{
+				WriteCookedTexture(cookedName, Texture::kType2D, job->textureFormat, job->imageSize.x, job->imageSize.y, 1, job->mipmapCount, job->mipmapImages, stamp);
+			}
 		}
-		horizonMap += width;
-		//ambientMap += width;
+
+		pipeline->finishedMutex.Acquire();
+		pipeline->finishedJob[pipeline->finishedCount++] = index;
+		pipeline->finishedMutex.Release();
+
+		pipeline->finishedCondition.Wake();
+	}
+}
+
+void TexturePipeline::CreateTexture(TextureJob *job)
+{
+	// A texture packed into an array keeps its image until GetArrayTexture() is called.
+
+	if (job->arraySet >= 0)
+	{
+		job->createdFlag = true;
+		return;
 	}
-	// listing 7.12 (implement horizon mapping)
 
+	// When there is an upload manager, the texture is created without an image, and the
+	// image is released after the upload manager has copied the last mipmap.
+
+	CookedTexture *cookedTexture = job->cookedTexture;
+	if (cookedTexture)
+	{
+		// The image is uploaded directly from the mapped file.
+
+		if (uploadManager)
+		{
+			const CookedTextureHeader *header = cookedTexture->GetHeader();
+			job->texture = new Texture(header->textureType, header->textureFormat, header->width, header->height, header->depth, header->mipmapCount, nullptr);
+			uploadManager->UploadTexture(job->texture, cookedTexture->GetImage(), &ReleaseCookedTexture, cookedTexture);
+		}
+		else
+		{
+			job->texture = cookedTexture->CreateTexture();
+			delete cookedTexture;
+		}
 
+		job->cookedTexture = nullptr;
+	}
+	else if (job->mipmapImages)
+	{
+		if (uploadManager)
+		{
+			job->texture = new Texture(Texture::kType2D, job->textureFormat, job->imageSize.x, job->imageSize.y, 1, job->mipmapCount, nullptr);
+			uploadManager->UploadTexture(job->texture, job->mipmapImages, &ReleaseMipmapImages, job->mipmapImages);
+		}
+		else
+		{
+			job->texture = new Texture(Texture::kType2D, job->textureFormat, job->imageSize.x, job->imageSize.y, 1, job->mipmapCount, job->mipmapImages);
+			ReleaseMipmapImages(job->mipmapImages);
+		}
+
+		job->mipmapImages = nullptr;
+	}
+
+	if ((job->texture) && (resourceManager))
+	{
+		resourceManager->AddTexture(GetResourceName(job), job->texture);
+	}
+
+	job->createdFlag = true;
+}
+
+void TexturePipeline::FinishJob(const TextureJob *job)
+{
+	while (!job->createdFlag)
+	{
+		finishedMutex.Acquire();
+
+		while (finishedCount == createdCount)
+		{
+			finishedCondition.Wait(&finishedMutex);
+		}
+
+		int32 count = finishedCount;
+		finishedMutex.Release();
+
+		while (createdCount < count)
+		{
+			CreateTexture(&jobTable[finishedJob[createdCount++]]);
+		}
+	}
 }
 
-void WorldManager::GenerateHorizonCube(Color4U* texel) {
-	for (int face = 0; face < 6; face++)
+void TexturePipeline::BuildArrayTextures(int32 set)
+{
+	for (int32 a = 0; a < jobCount; a++)
+	{
+		const TextureJob *job = &jobTable[a];
+		if (job->arraySet == set)
+		{
+			FinishJob(job);
+		}
+	}
+
+	// Each pass starts an array with the first texture not yet packed and adds every later
+	// texture in the set having the same layout. Textures that failed to load are skipped.
+
+	for (int32 a = 0; a < jobCount; a++)
 	{
-		for (float y = -0.9375F; y < 1.0F; y += 0.125F)
+		int32		format;
+		Integer2D	size;
+		int32		mipmapCount;
+
+		const TextureJob *firstJob = &jobTable[a];
+		if ((firstJob->arraySet != set) || (firstJob->texture) || (!GetJobImage(firstJob, &format, &size, &mipmapCount)))
+		{
+			continue;
+		}
+
+		TextureArrayBuilder							builder(format, size.x, size.y, mipmapCount);
+		Array<TextureJob *, kTextureJobBaseCount>	layerJob;
+
+		for (int32 b = a; b < jobCount; b++)
 		{
-			for (float x = -0.9375F; x < 1.0F; x += 0.125F)
+			TextureJob *job = &jobTable[b];
+			if ((job->arraySet == set) && (!job->texture))
 			{
-				Vector2D v;
-				float r = 1.0F / sqrt(1.0F + x * x + y * y);
-				switch (face)
+				const void *image = GetJobImage(job, &format, &size, &mipmapCount);
+				if ((image) && (builder.LayoutMatches(format, size.x, size.y, mipmapCount)))
 				{
-				case 0: v.Set(r, -y * r); break;
-				case 1: v.Set(-r, -y * r); break;
-				case 2: v.Set(x * r, r); break;
-				case 3: v.Set(x * r, -r); break;
-				case 4: v.Set(x * r, -y * r); break;
-				case 5: v.Set(-x * r, -y * r); break;
+					job->arrayLayer = builder.AddLayer(image);
+					layerJob.AppendArrayElement(job);
 				}
-				float t = atan2(v.y, v.x) / (3.14519/4);
-				float red = 0.0F;
-				float green = 0.0F;
-				float blue = 0.0F;
-				float alpha = 0.0F;
-				if (t < -3.0F) { red = t + 3.0F; green = -4.0F - t; }
-				else if (t < -2.0F) { green = t + 2.0F; blue = -3.0F - t; }
-				else if (t < -1.0F) { blue = t + 1.0F; alpha = -2.0F - t; }
-				else if (t < 0.0F) { alpha = t; red = t + 1.0F; }
-				else if (t < 1.0F) { red = 1.0F - t; green = t; }
-				else if (t < 2.0F) { green = 2.0F - t; blue = t - 1.0F; }
-				else if (t < 3.0F) { blue = 3.0F - t; alpha = t - 2.0F; }
-				else { alpha = 4.0F - t; red = 3.0F - t; }
-				texel->Set(red, green, blue, alpha);
-				texel++;
 			}
 		}
+
+		// Every texture packed into the array holds a reference to it, and the images are no
+		// longer needed once the array has been built.
+
+		Texture *texture = builder.BuildTexture();
+		for (TextureJob *job : layerJob)
+		{
+			job->texture = texture;
+			texture->Retain();
+
+			if (job->mipmapImages)
+			{
+				ReleaseMipmapImages(job->mipmapImages);
+				job->mipmapImages = nullptr;
+			}
+
+			delete job->cookedTexture;
+			job->cookedTexture = nullptr;
+		}
+
+		texture->Release();
 	}
 }
 
-void WorldManager::BuildFloor(Program *ambientProgram, Program *lightProgram)
+const void *TexturePipeline::GetJobImage(const TextureJob *job, int32 *format, Integer2D *size, int32 *mipmapCount)
 {
-	Color4U			*textureImage;
-	Color4U			*colorMipmapImages;
-	Color4U         *horizonMipmapImages;
-	Color2S			*normalMipmapImages;
-	Integer2D		imageSize;
+	const CookedTexture *cookedTexture = job->cookedTexture;
+	if (cookedTexture)
+	{
+		const CookedTextureHeader *header = cookedTexture->GetHeader();
+		*format = header->textureFormat;
+		size->Set(header->width, header->height);
+		*mipmapCount = header->mipmapCount;
+		return (cookedTexture->GetImage());
+	}
 
-	// Diffuse texture
+	*format = job->textureFormat;
+	*size = job->imageSize;
+	*mipmapCount = job->mipmapCount;
+	return (job->mipmapImages);
+}
 
-	ImportTargaImageFile("Textures/StoneFloor-diff.tga", &textureImage, &imageSize);
-	int32 mipmapCount = GenerateMipmapImages(Integer3D(imageSize, 1), textureImage, &colorMipmapImages);
+Texture *TexturePipeline::GetTexture(int32 index)
+{
+	const TextureJob *job = &jobTable[index];
+	FinishJob(job);
+	return (job->texture);
+}
 
-	Texture *floorDiffuseTexture = new Texture(Texture::kType2D, Texture::kFormatGammaRgba, imageSize.x, imageSize.y, 1, mipmapCount, colorMipmapImages);
+Texture *TexturePipeline::GetArrayTexture(int32 index, int32 *layer)
+{
+	const TextureJob *job = &jobTable[index];
+	if (job->arraySet < 0)
+	{
+		*layer = 0;
+		return (nullptr);
+	}
 
-	ReleaseMipmapImages(colorMipmapImages);
-	ReleaseTargaImageData(textureImage);
+	if (!job->texture)
+	{
+		BuildArrayTextures(job->arraySet);
+	}
 
-	// Normal texture
+	*layer = job->arrayLayer;
+	return (job->texture);
+}
 
-	ImportTargaImageFile("Textures/StoneFloor-nrml.tga", &textureImage, &imageSize);
-	Color2S *normalMap = new Color2S[imageSize.x * imageSize.y];
-	ConstructNormalMap(textureImage, normalMap, imageSize.x, imageSize.y, 16.0F);
 
-	mipmapCount = GenerateMipmapImages(Integer3D(imageSize, 1), normalMap, &normalMipmapImages);
-	delete[] normalMap;
+void WorldManager::CookWorldTextures(void)
+{
+	TexturePipeline		texturePipeline(BAKE_THREAD_COUNT);
+
+	AddWorldTextures(&texturePipeline);
+	texturePipeline.CookTextures();
+}
 
-	Texture *floorNormalTexture = new Texture(Texture::kType2D, Texture::kFormatSignedRedGreen, imageSize.x, imageSize.y, 1, mipmapCount, normalMipmapImages);
 
-	ReleaseMipmapImages(normalMipmapImages);
-	ReleaseTargaImageData(textureImage);
+void WorldManager::BuildFloor(Program *ambientProgram, Program *lightProgram, TexturePipeline *pipeline)
+{
+	Color4U         *horizonMipmapImages;
 
 	// horizon texture
 	//ConstructHorizonMap(heightMap, horizonMap, imageSize.x, imageSize.y, 1);
@@ -1345,8 +1954,10 @@ void WorldManager::BuildFloor(Program *ambientProgram, Program *lightProgram)
 	boxGeometry->nodeTransform.SetTranslation(Point3D(-50.0F, -50.0F, -1.0F));
 	rootNode->AppendSubnode(boxGeometry);
 
-	boxGeometry->SetTexture(0, floorDiffuseTexture);
-	boxGeometry->SetTexture(1, floorNormalTexture);
+	int32	diffuseLayer, normalLayer;
+
+	boxGeometry->SetTexture(0, pipeline->GetArrayTexture(kWorldTextureFloorDiffuse, &diffuseLayer));
+	boxGeometry->SetTexture(1, pipeline->GetArrayTexture(kWorldTextureFloorNormal, &normalLayer));
 	//boxGeometry->SetTexture(2, horizonTexture);
 	//boxGeometry->SetTexture(3, horizonCubeTexture);
 	boxGeometry->SetTextureCount(2);
@@ -1356,14 +1967,12 @@ void WorldManager::BuildFloor(Program *ambientProgram, Program *lightProgram)
 
 	boxGeometry->fragmentParam[0].Set(1.0F, 1.0F, 1.0F, 1.0F);
 	boxGeometry->fragmentParam[1].Set(0.2F, 0.2F, 0.2F, 150.0F);
+	boxGeometry->fragmentParam[2].Set(float(diffuseLayer), float(normalLayer), 0.0F, 0.0F);
 	boxGeometry->SetFragmentParamLocation(32);
-	boxGeometry->SetFragmentParamCount(2);
-
-	floorNormalTexture->Release();
-	floorDiffuseTexture->Release();
+	boxGeometry->SetFragmentParamCount(3);
 }
 
-void WorldManager::BuildWalls(Program *ambientProgram, Program *lightProgram, Texture *diffuseTexture, Texture *normalTexture)
+void WorldManager::BuildWalls(Program *ambientProgram, Program *lightProgram, Texture *diffuseTexture, Texture *normalTexture, const Vector4D& layerParam)
 {
 	// Negative y
 
@@ -1382,8 +1991,9 @@ void WorldManager::BuildWalls(Program *ambientProgram, Program *lightProgram, Te
 
 	boxGeometry->fragmentParam[0].Set(1.0F, 1.0F, 1.0F, 1.0F);
 	boxGeometry->fragmentParam[1].Set(0.05F, 0.05F, 0.05F, 150.0F);
+	boxGeometry->fragmentParam[2] = layerParam;
 	boxGeometry->SetFragmentParamLocation(32);
-	boxGeometry->SetFragmentParamCount(2);
+	boxGeometry->SetFragmentParamCount(3);
 
 	// Positive y
 
@@ -1402,8 +2012,9 @@ void WorldManager::BuildWalls(Program *ambientProgram, Program *lightProgram, Te
 
 	boxGeometry->fragmentParam[0].Set(1.0F, 1.0F, 1.0F, 1.0F);
 	boxGeometry->fragmentParam[1].Set(0.05F, 0.05F, 0.05F, 150.0F);
+	boxGeometry->fragmentParam[2] = layerParam;
 	boxGeometry->SetFragmentParamLocation(32);
-	boxGeometry->SetFragmentParamCount(2);
+	boxGeometry->SetFragmentParamCount(3);
 
 	// Negative x
 
@@ -1422,8 +2033,9 @@ void WorldManager::BuildWalls(Program *ambientProgram, Program *lightProgram, Te
 
 	boxGeometry->fragmentParam[0].Set(1.0F, 1.0F, 1.0F, 1.0F);
 	boxGeometry->fragmentParam[1].Set(0.05F, 0.05F, 0.05F, 150.0F);
+	boxGeometry->fragmentParam[2] = layerParam;
 	boxGeometry->SetFragmentParamLocation(32);
-	boxGeometry->SetFragmentParamCount(2);
+	boxGeometry->SetFragmentParamCount(3);
 
 	// Positive x
 
@@ -1442,101 +2054,28 @@ void WorldManager::BuildWalls(Program *ambientProgram, Program *lightProgram, Te
 
 	boxGeometry->fragmentParam[0].Set(1.0F, 1.0F, 1.0F, 1.0F);
 	boxGeometry->fragmentParam[1].Set(0.05F, 0.05F, 0.05F, 150.0F);
+	boxGeometry->fragmentParam[2] = layerParam;
 	boxGeometry->SetFragmentParamLocation(32);
-	boxGeometry->SetFragmentParamCount(2);
+	boxGeometry->SetFragmentParamCount(3);
 }
 
-void WorldManager::BuildTree(const Point3D& position)
+void WorldManager::BuildTree(const Point3D& position, TexturePipeline *pipeline, const File& modelFile)
 {
 	Array<MeshGeometry *>	meshArray;
-	Color4U					*textureImage;
-	Color4U					*colorMipmapImages;
-	Color2S					*normalMipmapImages;
-	Integer2D				imageSize;
-
-	// Trunk diffuse texture
-
-	ImportTargaImageFile("Textures/Trunk-diff.tga", &textureImage, &imageSize);
-	int32 mipmapCount = GenerateMipmapImages(Integer3D(imageSize, 1), textureImage, &colorMipmapImages);
-
-	Texture *trunkDiffuseTexture = new Texture(Texture::kType2D, Texture::kFormatGammaRgba, imageSize.x, imageSize.y, 1, mipmapCount, colorMipmapImages);
-
-	ReleaseMipmapImages(colorMipmapImages);
-	ReleaseTargaImageData(textureImage);
-
-	// Trunk normal texture
-
-	ImportTargaImageFile("Textures/Trunk-nrml.tga", &textureImage, &imageSize);
-	Color2S *normalMap = new Color2S[imageSize.x * imageSize.y];
-	ConstructNormalMap(textureImage, normalMap, imageSize.x, imageSize.y, 16.0F);
-
-	mipmapCount = GenerateMipmapImages(Integer3D(imageSize, 1), normalMap, &normalMipmapImages);
-	delete[] normalMap;
-
-	Texture *trunkNormalTexture = new Texture(Texture::kType2D, Texture::kFormatSignedRedGreen, imageSize.x, imageSize.y, 1, mipmapCount, normalMipmapImages);
-
-	ReleaseMipmapImages(normalMipmapImages);
-	ReleaseTargaImageData(textureImage);
-
-	// Branch diffuse texture
-
-	ImportTargaImageFile("Textures/Branch-diff.tga", &textureImage, &imageSize);
-	mipmapCount = GenerateMipmapImages(Integer3D(imageSize, 1), textureImage, &colorMipmapImages);
-
-	Texture *branchDiffuseTexture = new Texture(Texture::kType2D, Texture::kFormatGammaRgba, imageSize.x, imageSize.y, 1, mipmapCount, colorMipmapImages);
-
-	ReleaseMipmapImages(colorMipmapImages);
-	ReleaseTargaImageData(textureImage);
-
-	// Branch transmission-specular texture
-
-	ImportTargaImageFile("Textures/Branch-xmit-spec.tga", &textureImage, &imageSize);
-	mipmapCount = GenerateMipmapImages(Integer3D(imageSize, 1), textureImage, &colorMipmapImages);
-
-	Texture *branchTransmissionTexture = new Texture(Texture::kType2D, Texture::kFormatGammaRgba, imageSize.x, imageSize.y, 1, mipmapCount, colorMipmapImages);
-
-	ReleaseMipmapImages(colorMipmapImages);
-	ReleaseTargaImageData(textureImage);
-
-	// Branch normal texture
-
-	ImportTargaImageFile("Textures/Branch-nrml.tga", &textureImage, &imageSize);
-	normalMap = new Color2S[imageSize.x * imageSize.y];
-	ConstructNormalMap(textureImage, normalMap, imageSize.x, imageSize.y, 16.0F);
-
-	mipmapCount = GenerateMipmapImages(Integer3D(imageSize, 1), normalMap, &normalMipmapImages);
-	delete[] normalMap;
-
-	Texture *branchNormalTexture = new Texture(Texture::kType2D, Texture::kFormatSignedRedGreen, imageSize.x, imageSize.y, 1, mipmapCount, normalMipmapImages);
-
-	ReleaseMipmapImages(normalMipmapImages);
-	ReleaseTargaImageData(textureImage);
 
 	// Trunk shader
 
-	File vertexShader("Shaders/Vertex.glsl");
-	File trunkAmbientFragmentShader("Shaders/Trunk-Ambient.glsl");
-	File trunkLightFragmentShader("Shaders/Trunk-Light.glsl");
-
-	const char *vertexString = vertexShader.GetData();
-	const char *ambientFragmentString = trunkAmbientFragmentShader.GetData();
-	const char *lightFragmentString = trunkLightFragmentShader.GetData();
-	Program *trunkAmbientProgram = new Program(1, &vertexString, 1, &ambientFragmentString);
-	Program *trunkLightProgram = new Program(1, &vertexString, 1, &lightFragmentString);
+	Program *trunkAmbientProgram = resourceManager->GetProgram("Shaders/Vertex.glsl", "Shaders/Trunk-Ambient.glsl");
+	Program *trunkLightProgram = resourceManager->GetProgram("Shaders/Vertex.glsl", "Shaders/Trunk-Light.glsl");
 
 	// Branch shader
 
-	File branchAmbientFragmentShader("Shaders/Branch-Ambient.glsl");
-	File branchLightFragmentShader("Shaders/Branch-Light.glsl");
-
-	ambientFragmentString = branchAmbientFragmentShader.GetData();
-	lightFragmentString = branchLightFragmentShader.GetData();
-	Program *branchAmbientProgram = new Program(1, &vertexString, 1, &ambientFragmentString);
-	Program *branchLightProgram = new Program(1, &vertexString, 1, &lightFragmentString);
+	Program *branchAmbientProgram = resourceManager->GetProgram("Shaders/Vertex.glsl", "Shaders/Branch-Ambient.glsl");
+	Program *branchLightProgram = resourceManager->GetProgram("Shaders/Vertex.glsl", "Shaders/Branch-Light.glsl");
 
 	// Geometry
 
-	Node *modelNode = OpenGexDataDescription::ImportGeometry("Models/Redwood.ogex", meshArray);
+	Node *modelNode = OpenGexDataDescription::ImportGeometry(modelFile, meshArray);
 	if (modelNode)
 	{
 		modelNode->nodeTransform.SetTranslation(position);
@@ -1547,8 +2086,8 @@ void WorldManager::BuildTree(const Point3D& position)
 		{
 			if (geometryIndex == 0)
 			{
-				meshGeometry->SetTexture(0, trunkDiffuseTexture);
-				meshGeometry->SetTexture(1, trunkNormalTexture);
+				meshGeometry->SetTexture(0, pipeline->GetTexture(kWorldTextureTrunkDiffuse));
+				meshGeometry->SetTexture(1, pipeline->GetTexture(kWorldTextureTrunkNormal));
 				meshGeometry->SetTextureCount(2);
 
 				meshGeometry->SetProgram(0, trunkAmbientProgram);
@@ -1558,9 +2097,9 @@ void WorldManager::BuildTree(const Point3D& position)
 			{
 				meshGeometry->SetCullFaceFlag(false);
 
-				meshGeometry->SetTexture(0, branchDiffuseTexture);
-				meshGeometry->SetTexture(1, branchTransmissionTexture);
-				meshGeometry->SetTexture(2, branchNormalTexture);
+				meshGeometry->SetTexture(0, pipeline->GetTexture(kWorldTextureBranchDiffuse));
+				meshGeometry->SetTexture(1, pipeline->GetTexture(kWorldTextureBranchTransmission));
+				meshGeometry->SetTexture(2, pipeline->GetTexture(kWorldTextureBranchNormal));
 				meshGeometry->SetTextureCount(3);
 
 				meshGeometry->SetProgram(0, branchAmbientProgram);
@@ -1575,78 +2114,23 @@ void WorldManager::BuildTree(const Point3D& position)
 	branchAmbientProgram->Release();
 	trunkLightProgram->Release();
 	trunkAmbientProgram->Release();
-	branchNormalTexture->Release();
-	branchTransmissionTexture->Release();
-	branchDiffuseTexture->Release();
-	trunkNormalTexture->Release();
-	trunkDiffuseTexture->Release();
 }
 
-void WorldManager::BuildGoblin(const Point3D& position)
+void WorldManager::BuildGoblin(const Point3D& position, TexturePipeline *pipeline, const File& modelFile)
 {
 	Array<MeshGeometry *>	meshArray;
-	Color4U					*textureImage;
-	Color4U					*colorMipmapImages;
-	Color2S					*normalMipmapImages;
-	Integer2D				imageSize;
-
-	// Diffuse texture
-
-	ImportTargaImageFile("Textures/Goblin-diff.tga", &textureImage, &imageSize);
-	int32 mipmapCount = GenerateMipmapImages(Integer3D(imageSize, 1), textureImage, &colorMipmapImages);
-
-	Texture *goblinDiffuseTexture = new Texture(Texture::kType2D, Texture::kFormatGammaRgba, imageSize.x, imageSize.y, 1, mipmapCount, colorMipmapImages);
-
-	ReleaseMipmapImages(colorMipmapImages);
-	ReleaseTargaImageData(textureImage);
-
-	// Specular texture
-
-	ImportTargaImageFile("Textures/Goblin-spec.tga", &textureImage, &imageSize);
-	mipmapCount = GenerateMipmapImages(Integer3D(imageSize, 1), textureImage, &colorMipmapImages);
-
-	Texture *goblinSpecularTexture = new Texture(Texture::kType2D, Texture::kFormatGammaRgba, imageSize.x, imageSize.y, 1, mipmapCount, colorMipmapImages);
-
-	ReleaseMipmapImages(colorMipmapImages);
-	ReleaseTargaImageData(textureImage);
-
-	// Normal texture
-
-	ImportTargaImageFile("Textures/Goblin-nrml.tga", &textureImage, &imageSize);
-	Color2S *normalMap = new Color2S[imageSize.x * imageSize.y];
-	ConstructNormalMap(textureImage, normalMap, imageSize.x, imageSize.y, 16.0F);
-
-	mipmapCount = GenerateMipmapImages(Integer3D(imageSize, 1), normalMap, &normalMipmapImages);
-	delete[] normalMap;
-
-	Texture *goblinNormalTexture = new Texture(Texture::kType2D, Texture::kFormatSignedRedGreen, imageSize.x, imageSize.y, 1, mipmapCount, normalMipmapImages);
-
-	ReleaseMipmapImages(normalMipmapImages);
-	ReleaseTargaImageData(textureImage);
 
 	// Shaders
 
-	File vertexShader("Shaders/Vertex.glsl");
-	File ambientFragmentShader("Shaders/Goblin-Ambient.glsl");
-	File lightFragmentShader("Shaders/Goblin-Light.glsl");
-
-	const char *vertexString = vertexShader.GetData();
-	const char *ambientFragmentString = ambientFragmentShader.GetData();
-	const char *lightFragmentString = lightFragmentShader.GetData();
-	Program *ambientProgram = new Program(1, &vertexString, 1, &ambientFragmentString);
-	Program *lightProgram = new Program(1, &vertexString, 1, &lightFragmentString);
-
-	File eyeAmbientFragmentShader("Shaders/Eye-Ambient.glsl");
-	File eyeLightFragmentShader("Shaders/Eye-Light.glsl");
+	Program *ambientProgram = resourceManager->GetProgram("Shaders/Vertex.glsl", "Shaders/Goblin-Ambient.glsl");
+	Program *lightProgram = resourceManager->GetProgram("Shaders/Vertex.glsl", "Shaders/Goblin-Light.glsl");
 
-	ambientFragmentString = eyeAmbientFragmentShader.GetData();
-	lightFragmentString = eyeLightFragmentShader.GetData();
-	Program *eyeAmbientProgram = new Program(1, &vertexString, 1, &ambientFragmentString);
-	Program *eyeLightProgram = new Program(1, &vertexString, 1, &lightFragmentString);
+	Program *eyeAmbientProgram = resourceManager->GetProgram("Shaders/Vertex.glsl", "Shaders/Eye-Ambient.glsl");
+	Program *eyeLightProgram = resourceManager->GetProgram("Shaders/Vertex.glsl", "Shaders/Eye-Light.glsl");
 
 	// Geometry
 
-	Node *modelNode = OpenGexDataDescription::ImportGeometry("Models/Goblin.ogex", meshArray);
+	Node *modelNode = OpenGexDataDescription::ImportGeometry(modelFile, meshArray);
 	if (modelNode)
 	{
 		modelNode->nodeTransform.SetTranslation(position);
@@ -1661,9 +2145,9 @@ void WorldManager::BuildGoblin(const Point3D& position)
 		{
 			if (geometryIndex == 0)
 			{
-				meshGeometry->SetTexture(0, goblinDiffuseTexture);
-				meshGeometry->SetTexture(1, goblinSpecularTexture);
-				meshGeometry->SetTexture(2, goblinNormalTexture);
+				meshGeometry->SetTexture(0, pipeline->GetTexture(kWorldTextureGoblinDiffuse));
+				meshGeometry->SetTexture(1, pipeline->GetTexture(kWorldTextureGoblinSpecular));
+				meshGeometry->SetTexture(2, pipeline->GetTexture(kWorldTextureGoblinNormal));
 				meshGeometry->SetTextureCount(3);
 
 				meshGeometry->SetProgram(0, ambientProgram);
@@ -1701,44 +2185,28 @@ void WorldManager::BuildGoblin(const Point3D& position)
 	eyeAmbientProgram->Release();
 	lightProgram->Release();
 	ambientProgram->Release();
-	goblinNormalTexture->Release();
-	goblinSpecularTexture->Release();
-	goblinDiffuseTexture->Release();
 }
 
 void WorldManager::BuildWorld(void)
 {
-	Color4U			*textureImage;
-	Color4U			*colorMipmapImages;
 	Color4U         *horizonMipmapImages;
-	Color2S			*normalMipmapImages;
-	Integer2D		imageSize;
 
+	// Start preparing every texture in the world on worker threads. The Texture objects are
+	// created here on the main thread when each one is first bound to a geometry.
 
+	TexturePipeline		texturePipeline(BAKE_THREAD_COUNT);
 
-	// Load the stone wall texture, create its mipmaps, and create a Texture object for it.
+	AddWorldTextures(&texturePipeline);
+	texturePipeline.StartPipeline();
 
-	ImportTargaImageFile("Textures/StoneWall-diff.tga", &textureImage, &imageSize);
-	int32 mipmapCount = GenerateMipmapImages(Integer3D(imageSize, 1), textureImage, &colorMipmapImages);
+	// Start reading the models on the loader threads so that the disk reads overlap the work
+	// done below. They are copied into memory instead of being mapped so that the parser
+	// doesn't fault the pages in on the main thread.
 
-	Texture *wallDiffuseTexture = new Texture(Texture::kType2D, Texture::kFormatGammaRgba, imageSize.x, imageSize.y, 1, mipmapCount, colorMipmapImages);
-
-	ReleaseMipmapImages(colorMipmapImages);
-	ReleaseTargaImageData(textureImage);
-
-	// Load the height map for the stone wall.
-
-	ImportTargaImageFile("Textures/StoneWall-nrml.tga", &textureImage, &imageSize);
-	Color2S *normalMap = new Color2S[imageSize.x * imageSize.y];
-	ConstructNormalMap(textureImage, normalMap, imageSize.x, imageSize.y, 16.0F);
-
-	mipmapCount = GenerateMipmapImages(Integer3D(imageSize, 1), normalMap, &normalMipmapImages);
-	delete[] normalMap;
-
-	Texture *wallNormalTexture = new Texture(Texture::kType2D, Texture::kFormatSignedRedGreen, imageSize.x, imageSize.y, 1, mipmapCount, normalMipmapImages);
-
-	ReleaseMipmapImages(normalMipmapImages);
-	ReleaseTargaImageData(textureImage);
+	LoadRequest *treeRequest = new LoadRequest("Models/Redwood.ogex");
+	LoadRequest *goblinRequest = new LoadRequest("Models/Goblin.ogex");
+	fileLoader->LoadFile(treeRequest);
+	fileLoader->LoadFile(goblinRequest);
 
 	//horizon map according to listing 7.11
 	Color4U* texel = new Color4U[1536];
@@ -1746,22 +2214,22 @@ void WorldManager::BuildWorld(void)
 	
 
 
-	// Load the source for the vertex and fragment shaders, and create Program objects for them.
-
-	File vertexShader("Shaders/Vertex.glsl");
-	File ambientFragmentShader("Shaders/Stone-Ambient.glsl");
-	File lightFragmentShader("Shaders/Stone-Light.glsl");
+	// Get Program objects for the vertex and fragment shaders. Each one is loaded and compiled
+	// only the first time it is requested.
 
-	const char *vertexString = vertexShader.GetData();
-	const char *ambientFragmentString = ambientFragmentShader.GetData();
-	const char *lightFragmentString = lightFragmentShader.GetData();
-	Program *ambientProgram = new Program(1, &vertexString, 1, &ambientFragmentString);
-	Program *lightProgram = new Program(1, &vertexString, 1, &lightFragmentString);
+	Program *ambientProgram = resourceManager->GetProgram("Shaders/Vertex.glsl", "Shaders/Stone-Ambient.glsl");
+	Program *lightProgram = resourceManager->GetProgram("Shaders/Vertex.glsl", "Shaders/Stone-Light.glsl");
 
 	// Create the room
 
-	BuildFloor(ambientProgram, lightProgram);
-	BuildWalls(ambientProgram, lightProgram, wallDiffuseTexture, wallNormalTexture);
+	BuildFloor(ambientProgram, lightProgram, &texturePipeline);
+
+	int32	wallDiffuseLayer, wallNormalLayer;
+
+	Texture *wallDiffuseTexture = texturePipeline.GetArrayTexture(kWorldTextureWallDiffuse, &wallDiffuseLayer);
+	Texture *wallNormalTexture = texturePipeline.GetArrayTexture(kWorldTextureWallNormal, &wallNormalLayer);
+	Vector4D wallLayerParam(float(wallDiffuseLayer), float(wallNormalLayer), 0.0F, 0.0F);
+	BuildWalls(ambientProgram, lightProgram, wallDiffuseTexture, wallNormalTexture, wallLayerParam);
 
 	// Create 200 geometries at random locations inside a 50m distance from the origin.
 	// The texture and programs created above are assigned to each geometry.
@@ -1782,8 +2250,9 @@ void WorldManager::BuildWorld(void)
 
 		boxGeometry->fragmentParam[0].Set(RandomFloat(0.875F) + 0.125F, RandomFloat(0.875F) + 0.125F, RandomFloat(0.875F) + 0.125F, 1.0F);
 		boxGeometry->fragmentParam[1].Set(1.0F, 1.0F, 1.0F, 100.0F);
+		boxGeometry->fragmentParam[2] = wallLayerParam;
 		boxGeometry->SetFragmentParamLocation(32);
-		boxGeometry->SetFragmentParamCount(2);
+		boxGeometry->SetFragmentParamCount(3);
 	}
 
 	for (int32 k = 0; k < 10; k++)
@@ -1802,28 +2271,31 @@ void WorldManager::BuildWorld(void)
 
 		sphereGeometry->fragmentParam[0].Set(RandomFloat(0.875F) + 0.125F, RandomFloat(0.875F) + 0.125F, RandomFloat(0.875F) + 0.125F, 1.0F);
 		sphereGeometry->fragmentParam[1].Set(1.0F, 1.0F, 1.0F, 100.0F);
+		sphereGeometry->fragmentParam[2] = wallLayerParam;
 		sphereGeometry->SetFragmentParamLocation(32);
-		sphereGeometry->SetFragmentParamCount(2);
+		sphereGeometry->SetFragmentParamCount(3);
 	}
 
-	BuildTree(Point3D(5.0F, 5.0F, 0.0F));
-	BuildGoblin(Point3D(5.0F, -5.0F, 0.0F));
+	fileLoader->WaitForLoad(treeRequest);
+	BuildTree(Point3D(5.0F, 5.0F, 0.0F), &texturePipeline, treeRequest->GetFile());
+	treeRequest->Release();
+
+	fileLoader->WaitForLoad(goblinRequest);
+	BuildGoblin(Point3D(5.0F, -5.0F, 0.0F), &texturePipeline, goblinRequest->GetFile());
+	goblinRequest->Release();
 
-	// We can release our local references to the textures and programs here because they are
-	// still referenced by all of the geometries and will not be deleted.
+	// We can release our local references to the programs here because they are still referenced
+	// by all of the geometries and will not be deleted. The texture pipeline releases its own
+	// references to the textures when it goes out of scope.
 
 	lightProgram->Release();
 	ambientProgram->Release();
-	wallNormalTexture->Release();
-	wallDiffuseTexture->Release();
 
 	// Set the ambient light color and add some point lights to the world.
 
 	ambientColor.Set(0.0625F, 0.0625F, 0.0625F, 0.0F);
 
-	File constantFragmentShader("Shaders/Constant.glsl");
-	const char *constantFragmentString = constantFragmentShader.GetData();
-	Program *constantProgram = new Program(1, &vertexString, 1, &constantFragmentString);
+	Program *constantProgram = resourceManager->GetProgram("Shaders/Vertex.glsl", "Shaders/Constant.glsl");
 
 	// Stationary light
 
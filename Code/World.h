@@ -2,7 +2,9 @@
 #define World_h
 
 
-#include "Graphics.h"
+#include "Cook.h"
+#include "Loader.h"
+#include "Pack.h"
 
 
 namespace Framework
@@ -275,6 +277,15 @@ namespace Framework
 			virtual bool GeometryVisible(const FrustumCamera *camera) const;
 			virtual bool GeometryOccluded(const OccluderNode *occluder) const;
 			virtual bool GeometryIlluminated(const PointLight *light) const;
+
+			// The texture detail needed by a geometry depends on the distance from the camera to its
+			// nearest point and on the number of texture coordinate units per world unit. The default
+			// distance of zero always requests the largest mipmap.
+
+			virtual float CalculateNearestDistance(const Point3D& position) const;
+			virtual float GetTexcoordScale(void) const;
+
+			void UpdateTextureDetail(const FrustumCamera *camera);
 	};
 
 
@@ -318,6 +329,9 @@ namespace Framework
 			bool GeometryVisible(const FrustumCamera *camera) const override;
 			bool GeometryOccluded(const OccluderNode *occluder) const override;
 			bool GeometryIlluminated(const PointLight *light) const override;
+
+			float CalculateNearestDistance(const Point3D& position) const override;
+			float GetTexcoordScale(void) const override;
 	};
 
 
@@ -338,6 +352,8 @@ namespace Framework
 			bool GeometryVisible(const FrustumCamera *camera) const override;
 			bool GeometryOccluded(const OccluderNode *occluder) const override;
 			bool GeometryIlluminated(const PointLight *light) const override;
+
+			float CalculateNearestDistance(const Point3D& position) const override;
 	};
 
 
@@ -423,6 +439,105 @@ namespace Framework
 	};
 
 
+	// The TexturePipeline class loads the images for a set of textures, builds their normal maps
+	// and mipmaps on worker threads, and creates the Texture objects on the thread that owns the
+	// OpenGL context. Any number of textures may be added, but all of them are added before
+	// StartPipeline() is called. The workers run in parallel, so each one builds its texture on a
+	// single thread. GetTexture() waits only until the requested texture is ready, and it creates
+	// the Texture objects for every job finished so far in the order in which they finished. The
+	// pipeline holds a reference to each texture that it creates and releases it when the
+	// pipeline is destroyed.
+	//
+	// A texture with a cooked file is mapped from that file instead of being built from its
+	// source image. CookTextures() is called in place of StartPipeline() to build every texture
+	// from its source image and write its cooked file without creating any Texture objects.
+	//
+	// When a resource manager exists, a texture already resident in it is returned without being
+	// built again, and every texture that the pipeline creates is registered with it.
+	//
+	// PackTextureArray() marks a set of textures to be packed into 2D array textures instead of
+	// being created individually. Textures in the set with the same format, size, and mipmap count
+	// share one array, and GetArrayTexture() returns the array holding a texture together with its
+	// layer index. Array textures are not registered with the resource manager.
+
+	class TexturePipeline
+	{
+		private:
+
+			enum
+			{
+				kTextureJobBaseCount	= 32
+			};
+
+			enum
+			{
+				kTextureJobColor,
+				kTextureJobNormal
+			};
+
+			struct TextureJob
+			{
+				const char		*fileName;
+				int32			jobType;
+				int32			textureFormat;
+				float			normalScale;
+
+				Integer2D		imageSize;
+				int32			mipmapCount;
+				void			*mipmapImages;
+				CookedTexture	*cookedTexture;
+
+				int32			arraySet;
+				int32			arrayLayer;
+
+				bool			createdFlag;
+				Texture			*texture;
+			};
+
+			int32					jobCount;
+			Array<TextureJob, kTextureJobBaseCount>		jobTable;
+			int32					arraySetCount;
+
+			volatile int32			nextJob;
+			int32					finishedCount;
+			int32					createdCount;
+			Array<int32, kTextureJobBaseCount>		finishedJob;
+
+			Mutex					finishedMutex;
+			Condition				finishedCondition;
+
+			int32					workerCount;
+			Thread					**workerThread;
+			bool					cookFlag;
+
+			int32 AddJob(const char *name, int32 type, float scale);
+			void CreateTexture(TextureJob *job);
+			void FinishJob(const TextureJob *job);
+			void BuildArrayTextures(int32 set);
+
+			static String<> GetResourceName(const TextureJob *job);
+			static const void *GetJobImage(const TextureJob *job, int32 *format, Integer2D *size, int32 *mipmapCount);
+
+			static void WorkerThread(void *cookie);
+
+		public:
+
+			TexturePipeline(int32 threadCount = 0);
+			~TexturePipeline();
+
+			int32 AddColorTexture(const char *name);
+			int32 AddNormalTexture(const char *name, float scale);
+
+			void StartPipeline(void);
+			void CookTextures(void);
+
+			void PackTextureArray(int32 count, const int32 *index);
+
+			Texture *GetTexture(int32 index);
+			Texture *GetArrayTexture(int32 index, int32 *layer);
+	};
+
+
 	class WorldManager
 	{
 		private:
@@ -440,24 +555,29 @@ namespace Framework
 			CameraNode				*overlayCameraNode;
 			List<GeometryNode>		overlayGeometryList;
 
-			static void ConstructNormalMap(const Color4U *heightMap, Color2S *normalMap, int32 width, int32 height, float scale);
-			static void ConstructParallaxMap(const Color4U *heightMap, Color1S *parallaxMap, int32 width, int32 height, float scale);
-			static void ConstructHorizonMap(const Color4U *heightMap, Color4U *horizonMap, int32 width, int32 height, float scale);
-
-			void GenerateHorizonCube(Color4U* texel);
 			//void BuildFloor(Program *ambientProgram, Program *lightProgram, Texture *horizonTexture, Texture *horizonCubeTexture);
-			void BuildFloor(Program* ambientProgram, Program* lightProgram);
+			void BuildFloor(Program* ambientProgram, Program* lightProgram, TexturePipeline *pipeline);
 
 			//void BuildWalls(Program *ambientProgram, Program *lightProgram, Texture *diffuseTexture, Texture *normalTexture, Texture *horizonTexture, Texture *horizonCubeTexture);
-			void BuildWalls(Program* ambientProgram, Program* lightProgram, Texture* diffuseTexture, Texture* normalTexture);
-			void BuildTree(const Point3D& position);
-			void BuildGoblin(const Point3D& position);
+			void BuildWalls(Program* ambientProgram, Program* lightProgram, Texture* diffuseTexture, Texture* normalTexture, const Vector4D& layerParam);
+			void BuildTree(const Point3D& position, TexturePipeline *pipeline, const File& modelFile);
+			void BuildGoblin(const Point3D& position, TexturePipeline *pipeline, const File& modelFile);
 
 		public:
 
 			WorldManager();
 			~WorldManager();
 
+			static void ConstructNormalMap(const Color4U *heightMap, Color2S *normalMap, int32 width, int32 height, float scale, int32 threadCount = BAKE_THREAD_COUNT);
+			static void ConstructParallaxMap(const Color4U *heightMap, Color1S *parallaxMap, Color1U *coneMap, int32 width, int32 height, float scale);
+			static void ConstructHorizonMap(const Color4U *heightMap, Color4U *horizonMap, int32 width, int32 height, float scale);
+
+			static int32 ConstructNormalMipmaps(const Color4U *heightMap, const Integer2D& size, float scale, Color2S **image, int32 threadCount = BAKE_THREAD_COUNT);
+			static int32 ImportColorMipmaps(const char *name, Integer2D *size, Color4U **image, int32 threadCount = BAKE_THREAD_COUNT);
+
+			static void GenerateHorizonCube(Color4U *texel);
+			static void CookWorldTextures(void);
+
 			Node *GetRootNode(void) const
 			{
 				return (rootNode);
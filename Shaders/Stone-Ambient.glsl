@@ -19,9 +19,9 @@ layout(std140) uniform universal
 	vec4	fogParams;				// The fog density in x. The value of m from Equation (8.116) in y. The value dot(f, c) in z. The value sgn(dot(f, c)) in w.
 };
 
-layout(binding = 0) uniform sampler2D diffuseTexture;
+layout(binding = 0) uniform sampler2DArray diffuseTexture;
 
-layout(location = 32) uniform vec4 fparam[2];
+layout(location = 32) uniform vec4 fparam[3];
 
 out vec4 fragmentColor;
 
@@ -31,6 +31,6 @@ void main()
 
 	// Multiply texture color by ambient light color.
 
-	fragmentColor.xyz = texture(diffuseTexture, vertexTexcoord).xyz * diffuseColor * ambientColor.xyz;
+	fragmentColor.xyz = texture(diffuseTexture, vec3(vertexTexcoord, fparam[2].x)).xyz * diffuseColor * ambientColor.xyz;
 	fragmentColor.w = 0.0;
 }
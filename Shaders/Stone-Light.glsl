@@ -19,8 +19,8 @@ layout(std140) uniform universal
 	vec4	fogParams;				// The fog density in x. The value of m from Equation (8.116) in y. The value dot(f, c) in z. The value sgn(dot(f, c)) in w.
 };
 
-layout(binding = 0) uniform sampler2D diffuseTexture;
-layout(binding = 1) uniform sampler2D normalTexture;
+layout(binding = 0) uniform sampler2DArray diffuseTexture;
+layout(binding = 1) uniform sampler2DArray normalTexture;
 layout(binding = 2) uniform sampler2DArray horizonMap;
 layout(binding = 3) uniform samplerCubeArray weightCube;
 
@@ -30,7 +30,7 @@ layout(binding = 3) uniform samplerCubeArray weightCube;
 // and bind it to slot 3. You need to sample this with a vec3 instead of a 
 // vec2 as shown in the book (but replace float3 with vec3 in the code).
 
-layout(location = 32) uniform vec4 fparam[2];
+layout(location = 32) uniform vec4 fparam[3];
 
 out vec4 fragmentColor;				// The final output color. Set the alpha component (w coordinate) to zero.
 
@@ -38,12 +38,12 @@ void main()
 {
 	vec3	m;
 
-	m.xy = texture(normalTexture, vertexTexcoord).xy;
+	m.xy = texture(normalTexture, vec3(vertexTexcoord, fparam[2].y)).xy;
 	m.z = sqrt(1.0F - m.x * m.x - m.y * m.y);
 
 	// These are the material properties provided by the C++ code plus texturing.
 
-	vec3 diffuseColor = fparam[0].xyz * texture(diffuseTexture, vertexTexcoord).xyz;
+	vec3 diffuseColor = fparam[0].xyz * texture(diffuseTexture, vec3(vertexTexcoord, fparam[2].x)).xyz;
 	vec3 specularColor = fparam[1].xyz;
 	float specularPower = fparam[1].w;
 
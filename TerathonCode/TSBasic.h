@@ -24,6 +24,9 @@
 	{
 		unsigned char _BitScanReverse(unsigned long *, unsigned long);
 		#pragma intrinsic(_BitScanReverse)
+
+		unsigned char _BitScanForward(unsigned long *, unsigned long);
+		#pragma intrinsic(_BitScanForward)
 	}
 
 #endif
@@ -153,6 +156,27 @@ namespace Terathon
 	}
 
 
+	inline int32 Cnttz(uint32 n)
+	{
+		#if defined(_MSC_VER)
+
+			unsigned long	x;
+
+			if (_BitScanForward(&x, n) == 0)
+			{
+				return (32);
+			}
+
+			return (x);
+
+		#else
+
+			return ((n != 0) ? __builtin_ctz(n) : 32);
+
+		#endif
+	}
+
+
 	inline int32 IntLog2(uint32 n)
 	{
 		return (31 - Cntlz(n));
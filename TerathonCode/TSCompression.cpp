@@ -584,3 +584,144 @@ void Compression::DecompressData(const uint8 *restrict code, uint32 codeSize, vo
 		}
 	}
 }
+
+uint32 Compression::DecompressData(const uint8 *restrict code, uint32 codeSize, void *output, uint32 outputSize)
+{
+	// This version never reads past the end of the code or writes past the end of the output
+	// buffer. It returns the number of bytes decoded, or zero if the code is malformed or
+	// would decode to more than outputSize bytes.
+
+	uint8 *data = static_cast<uint8 *>(output);
+	const uint8 *dataEnd = data + outputSize;
+
+	const uint8 *restrict end = code + codeSize;
+	while (code < end)
+	{
+		uint32		length;
+
+		uint32 control = code[0];
+		uint32 type = control >> 5;
+		uint32 available = uint32(end - code);
+
+		if (type <= kUncompressedStandardLength)
+		{
+			if (type == kUncompressedTinyLength)
+			{
+				length = (control & 0x1F) + 1;
+				code++;
+			}
+			else
+			{
+				if ((control & 0x1F) != 0)
+				{
+					if (available < 3)
+					{
+						return (0);
+					}
+
+					length = ((code[1] << 8) | code[2]) + 289;
+					code += 3;
+				}
+				else
+				{
+					if (available < 2)
+					{
+						return (0);
+					}
+
+					length = code[1] + 33;
+					code += 2;
+				}
+			}
+
+			if ((length > uint32(end - code)) || (length > uint32(dataEnd - data)))
+			{
+				return (0);
+			}
+
+			CopyMemory(code, data, length);
+			data += length;
+			code += length;
+		}
+		else if (type <= kCompressedStandardLengthLongDistance)
+		{
+			uint32		distance;
+
+			static const uint8 headerSize[4][2] = {{2, 2}, {3, 4}, {3, 3}, {4, 5}};
+			if (available < headerSize[type - kCompressedTinyLengthShortDistance][(control & 0x1F) != 0])
+			{
+				return (0);
+			}
+
+			if (type <= kCompressedStandardLengthShortDistance)
+			{
+				if (type == kCompressedTinyLengthShortDistance)
+				{
+					length = (control & 0x1F) + kMinMatchCount;
+					distance = code[1] + 1;
+					code += 2;
+				}
+				else
+				{
+					if ((control & 0x1F) != 0)
+					{
+						length = ((code[1] << 8) | code[2]) + (kMaxShortLength + 1);
+						distance = code[3] + 1;
+						code += 4;
+					}
+					else
+					{
+						length = code[1] + (kMaxTinyLength + 1);
+						distance = code[2] + 1;
+						code += 3;
+					}
+				}
+			}
+			else
+			{
+				if (type == kCompressedTinyLengthLongDistance)
+				{
+					length = (control & 0x1F) + kMinMatchCount;
+					distance = ((code[1] << 8) | code[2]) + 1;
+					code += 3;
+				}
+				else
+				{
+					if ((control & 0x1F) != 0)
+					{
+						length = ((code[1] << 8) | code[2]) + (kMaxShortLength + 1);
+						distance = ((code[3] << 8) | code[4]) + 1;
+						code += 5;
+					}
+					else
+					{
+						length = code[1] + (kMaxTinyLength + 1);
+						distance = ((code[2] << 8) | code[3]) + 1;
+						code += 4;
+					}
+				}
+			}
+
+			if ((distance > uint32(data - static_cast<uint8 *>(output))) || (length > uint32(dataEnd - data)))
+			{
+				return (0);
+			}
+
+			const uint8 *source = data - distance;
+			do
+			{
+				*data++ = *source++;
+			} while (--length != 0);
+		}
+		else if (type == kCompressionInvalid)
+		{
+			return (0);
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	return (uint32(data - static_cast<uint8 *>(output)));
+}
@@ -27,6 +27,7 @@ namespace Terathon
 	{
 		TERATHON_API uint32 CompressData(const void *input, uint32 dataSize, uint8 *restrict code);
 		TERATHON_API void DecompressData(const uint8 *restrict code, uint32 codeSize, void *output);
+		TERATHON_API uint32 DecompressData(const uint8 *restrict code, uint32 codeSize, void *output, uint32 outputSize);
 	}
 }
 
@@ -169,6 +169,9 @@ namespace Terathon
 
 		template <typename type>
 		TERATHON_API DataResult ReadFloatLiteral(const char *text, int32 *textLength, type *value);
+
+		template <typename type>
+		TERATHON_API DataResult ParseFloatList(const char *& text, int32 count, type *value, int32 *valueCount);
 	}
 
 
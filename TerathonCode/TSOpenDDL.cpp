@@ -250,6 +250,77 @@ namespace Terathon
 	namespace Data
 	{
 		bool ParseSign(const char *& text);
+
+
+		// ValueList<type>::Parse() reads up to count comma-separated values, stopping early if a
+		// value is not followed by a comma. The floating-point types read a whole list with one call
+		// to ParseFloatList(), and space is made for a block of them at a time when the size of a
+		// list isn't known in advance.
+
+		template <class type>
+		struct ValueList
+		{
+			enum
+			{
+				kBlockSize = 1
+			};
+
+			static DataResult Parse(const char *& text, int32 count, typename type::PrimType *value, int32 *valueCount)
+			{
+				int32 index = 0;
+				for (;;)
+				{
+					DataResult result = type::ParseValue(text, &value[index]);
+					if (result != kDataOkay)
+					{
+						*valueCount = index;
+						return (result);
+					}
+
+					text += GetWhitespaceLength(text);
+
+					if ((++index == count) || (text[0] != ','))
+					{
+						break;
+					}
+
+					text++;
+					text += GetWhitespaceLength(text);
+				}
+
+				*valueCount = index;
+				return (kDataOkay);
+			}
+		};
+
+		template <class type>
+		struct FloatValueList
+		{
+			enum
+			{
+				kBlockSize = 256
+			};
+
+			static DataResult Parse(const char *& text, int32 count, typename type::PrimType *value, int32 *valueCount)
+			{
+				return (ParseFloatList(text, count, value, valueCount));
+			}
+		};
+
+		template <>
+		struct ValueList<HalfDataType> : FloatValueList<HalfDataType>
+		{
+		};
+
+		template <>
+		struct ValueList<FloatDataType> : FloatValueList<FloatDataType>
+		{
+		};
+
+		template <>
+		struct ValueList<DoubleDataType> : FloatValueList<DoubleDataType>
+		{
+		};
 	}
 }
 
@@ -404,24 +475,26 @@ DataResult DataStructure<type>::ParseData(const char *& text)
 	uint32 arraySize = GetArraySize();
 	if (arraySize == 0)
 	{
+		const int32 blockSize = Data::ValueList<type>::kBlockSize;
 		for (;;)
 		{
-			dataArray.SetArrayElementCount(count + 1);
+			int32	valueCount;
+
+			dataArray.SetArrayElementCount(count + blockSize);
+
+			DataResult result = Data::ValueList<type>::Parse(text, blockSize, &dataArray[count], &valueCount);
+			count += valueCount;
+			dataArray.SetArrayElementCount(count);
 
-			DataResult result = type::ParseValue(text, &dataArray[count]);
 			if (result != kDataOkay)
 			{
 				return (result);
 			}
 
-			text += Data::GetWhitespaceLength(text);
-
-			if (text[0] == ',')
+			if ((valueCount == blockSize) && (text[0] == ','))
 			{
 				text++;
 				text += Data::GetWhitespaceLength(text);
-
-				count++;
 				continue;
 			}
 
@@ -470,26 +543,17 @@ DataResult DataStructure<type>::ParseData(const char *& text)
 				stateArray.AppendArrayElement(stateValue);
 			}
 
-			for (umachine index = 0; index < arraySize; index++)
-			{
-				if (index != 0)
-				{
-					if (text[0] != ',')
-					{
-						return (kDataPrimitiveArrayUnderSize);
-					}
+			int32	valueCount;
 
-					text++;
-					text += Data::GetWhitespaceLength(text);
-				}
-
-				DataResult result = type::ParseValue(text, &dataArray[count * arraySize + index]);
-				if (result != kDataOkay)
-				{
-					return (result);
-				}
+			DataResult result = Data::ValueList<type>::Parse(text, arraySize, &dataArray[count * arraySize], &valueCount);
+			if (result != kDataOkay)
+			{
+				return (result);
+			}
 
-				text += Data::GetWhitespaceLength(text);
+			if (uint32(valueCount) < arraySize)
+			{
+				return (kDataPrimitiveArrayUnderSize);
 			}
 
 			char c = text[0];
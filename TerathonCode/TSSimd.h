@@ -124,6 +124,14 @@
 			extern __m128i _mm_unpackhi_epi16(__m128i, __m128i);
 			extern __m128i _mm_cmplt_epi8(__m128i, __m128i);
 			extern __m128i _mm_cmplt_epi16(__m128i, __m128i);
+			extern __m128i _mm_cmpeq_epi8(__m128i, __m128i);
+			extern __m128i _mm_set1_epi8(char);
+			extern __m128i _mm_sub_epi8(__m128i, __m128i);
+			extern __m128i _mm_min_epu8(__m128i, __m128i);
+			extern __m128i _mm_and_si128(__m128i, __m128i);
+			extern __m128i _mm_andnot_si128(__m128i, __m128i);
+			extern __m128i _mm_or_si128(__m128i, __m128i);
+			extern int _mm_movemask_epi8(__m128i);
 			extern __m128 _mm_cvtepi32_ps(__m128i);
 			extern __m128i _mm_cvtps_epi32(__m128);
 			extern __m128i _mm_add_epi32(__m128i, __m128i);
@@ -25,6 +25,20 @@
 #define TERATHON_TOOLS 1
 
 
+#if defined(_MSC_VER)
+
+	extern "C"
+	{
+		long _InterlockedIncrement(long volatile *);
+		#pragma intrinsic(_InterlockedIncrement)
+
+		long _InterlockedDecrement(long volatile *);
+		#pragma intrinsic(_InterlockedDecrement)
+	}
+
+#endif
+
+
 namespace Terathon
 {
 	#ifdef TERATHON_DEBUG
@@ -368,7 +382,8 @@ namespace Terathon
 	//
 	//# \desc
 	//# The $Shared$ class encapsulates a reference count for objects that can be shared.
-	//# Upon construction, the object's reference count is initialized to 1.
+	//# Upon construction, the object's reference count is initialized to 1. The reference count
+	//# is changed atomically, so a shared object may be retained and released on different threads.
 	//
 	//# \important
 	//# The destructor of the $Shared$ class does not have public access, and the destructors
@@ -421,7 +436,7 @@ namespace Terathon
 	{
 		private:
 
-			int32		referenceCount = 1;
+			volatile int32		referenceCount = 1;
 
 			Shared(const Shared&) = delete;
 			Shared& operator =(const Shared&) = delete;
@@ -440,12 +455,29 @@ namespace Terathon
 
 			int32 Retain(void)
 			{
-				return (++referenceCount);
+				#if defined(_MSC_VER)
+
+					return (_InterlockedIncrement(reinterpret_cast<volatile long *>(&referenceCount)));
+
+				#else
+
+					return (__atomic_add_fetch(&referenceCount, 1, __ATOMIC_RELAXED));
+
+				#endif
 			}
 
 			virtual int32 Release(void)
 			{
-				int32 count = --referenceCount;
+				#if defined(_MSC_VER)
+
+					int32 count = _InterlockedDecrement(reinterpret_cast<volatile long *>(&referenceCount));
+
+				#else
+
+					int32 count = __atomic_sub_fetch(&referenceCount, 1, __ATOMIC_ACQ_REL);
+
+				#endif
+
 				if (count == 0)
 				{
 					delete this;